@@ -80,4 +80,6 @@ struct AppInfo
   std::vector<bool> deployer_is_case_invariant{};
   /*! \brief Steam app id. Or -1 if not a Steam app. */
   long steam_app_id;
+  /*! \brief If true: Identical files of installed mods are stored only once. */
+  bool uses_content_store = false;
 };
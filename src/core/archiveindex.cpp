@@ -0,0 +1,226 @@
+#include "archiveindex.h"
+#include "binaryio.h"
+#include "compressionerror.h"
+#include "hashutils.h"
+#include <algorithm>
+#include <archive.h>
+#include <archive_entry.h>
+#include <format>
+#include <functional>
+#include <thread>
+
+namespace sfs = std::filesystem;
+
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndex::get(const sfs::path& archive_path,
+                                                      const sfs::path& cache_dir)
+{
+  return find(archive_path, cache_dir, true);
+}
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndex::getCached(const sfs::path& archive_path,
+                                                            const sfs::path& cache_dir)
+{
+  return find(archive_path, cache_dir, false);
+}
+
+int ArchiveIndex::pruneCache(const sfs::path& cache_dir)
+{
+  if(!sfs::is_directory(cache_dir))
+    return 0;
+  int num_removed = 0;
+  for(const auto& dir_entry : sfs::directory_iterator(cache_dir))
+  {
+    // temporary files may still be written by other threads
+    if(!dir_entry.is_regular_file() || dir_entry.path().extension() != FILE_EXTENSION)
+      continue;
+    bool is_valid = false;
+    try
+    {
+      BinaryReader reader(dir_entry.path());
+      is_valid = reader.read<uint32_t>() == MAGIC_NUMBER &&
+                 reader.read<uint32_t>() == FILE_VERSION && sfs::exists(reader.readString());
+    }
+    catch(std::runtime_error&)
+    {}
+    std::error_code error;
+    if(!is_valid && sfs::remove(dir_entry.path(), error))
+      num_removed++;
+  }
+  return num_removed;
+}
+
+const std::vector<ArchiveIndex::Entry>& ArchiveIndex::entries() const
+{
+  return entries_;
+}
+
+int ArchiveIndex::format() const
+{
+  return format_;
+}
+
+int ArchiveIndex::filter() const
+{
+  return filter_;
+}
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndex::find(const sfs::path& archive_path,
+                                                       const sfs::path& cache_dir,
+                                                       bool read_archive)
+{
+  const std::string path = sfs::absolute(archive_path).lexically_normal().string();
+  std::error_code error;
+  FileState state{ sfs::file_size(path, error), 0 };
+  if(!error)
+    state.time = sfs::last_write_time(path, error).time_since_epoch().count();
+  if(error)
+    throw CompressionError("Could not open archive file.");
+
+  {
+    std::scoped_lock lock(mutex_);
+    auto iter = indices_.find(path);
+    if(iter != indices_.end() && iter->second.state == state)
+    {
+      iter->second.last_use = ++use_counter_;
+      return iter->second.index;
+    }
+  }
+
+  std::shared_ptr<ArchiveIndex> index;
+  std::string sample_hash;
+  sfs::path index_path;
+  if(!cache_dir.empty())
+  {
+    sample_hash = hash_utils::hashFileSample(path);
+    index_path = cache_dir / (hash_utils::hashString(path) + FILE_EXTENSION);
+    index = readIndexFile(index_path, path, state, sample_hash);
+  }
+  if(!index)
+  {
+    if(!read_archive)
+      return nullptr;
+    index = readArchive(path);
+    if(!cache_dir.empty())
+    {
+      // the index can always be read from the archive again
+      try
+      {
+        writeIndexFile(index_path, path, state, sample_hash, *index);
+        pruneCache(cache_dir);
+      }
+      catch(std::exception&)
+      {}
+    }
+  }
+
+  std::scoped_lock lock(mutex_);
+  indices_[path] = { state, index, ++use_counter_ };
+  if(indices_.size() > MAX_CACHED_INDICES)
+    indices_.erase(std::ranges::min_element(
+      indices_, {}, [](const auto& pair) { return pair.second.last_use; }));
+  return index;
+}
+
+std::shared_ptr<ArchiveIndex> ArchiveIndex::readArchive(const sfs::path& archive_path)
+{
+  std::unique_ptr<struct archive, decltype(&archive_read_free)> source(archive_read_new(),
+                                                                       archive_read_free);
+  archive_read_support_filter_all(source.get());
+  archive_read_support_format_all(source.get());
+  if(archive_read_open_filename(source.get(), archive_path.c_str(), 10240) != ARCHIVE_OK)
+    throw CompressionError("Could not open archive file.");
+
+  auto index = std::make_shared<ArchiveIndex>();
+  struct archive_entry* entry;
+  while(true)
+  {
+    const int return_code = archive_read_next_header(source.get(), &entry);
+    if(return_code == ARCHIVE_EOF)
+      break;
+    const char* path = archive_entry_pathname(entry);
+    if(return_code < ARCHIVE_WARN || !path)
+      throw CompressionError("Parsing of archive failed.");
+    if(index->entries_.empty())
+    {
+      index->format_ = archive_format(source.get());
+      index->filter_ = archive_filter_code(source.get(), 0);
+    }
+    const char* hardlink = archive_entry_hardlink(entry);
+    index->entries_.emplace_back(path,
+                                 hardlink ? hardlink : "",
+                                 archive_entry_filetype(entry),
+                                 std::max<int64_t>(archive_entry_size(entry), 0),
+                                 archive_entry_is_encrypted(entry) != 0);
+  }
+  return index;
+}
+
+std::shared_ptr<ArchiveIndex> ArchiveIndex::readIndexFile(const sfs::path& index_path,
+                                                          const std::string& archive_path,
+                                                          const FileState& state,
+                                                          const std::string& sample_hash)
+{
+  if(!sfs::exists(index_path))
+    return nullptr;
+  try
+  {
+    BinaryReader reader(index_path);
+    if(reader.read<uint32_t>() != MAGIC_NUMBER || reader.read<uint32_t>() != FILE_VERSION ||
+       reader.readString() != archive_path || reader.read<uint64_t>() != state.size ||
+       reader.read<int64_t>() != state.time || reader.readString() != sample_hash)
+      return nullptr;
+    auto index = std::make_shared<ArchiveIndex>();
+    index->format_ = reader.read<int32_t>();
+    index->filter_ = reader.read<int32_t>();
+    const auto num_entries = reader.read<uint64_t>();
+    for(uint64_t i = 0; i < num_entries; i++)
+    {
+      Entry& entry = index->entries_.emplace_back();
+      entry.path = reader.readString();
+      entry.hardlink = reader.readString();
+      entry.type = reader.read<uint32_t>();
+      entry.size = reader.read<uint64_t>();
+      entry.is_encrypted = reader.read<uint8_t>() != 0;
+    }
+    return index;
+  }
+  catch(std::runtime_error&)
+  {
+    return nullptr;
+  }
+}
+
+void ArchiveIndex::writeIndexFile(const sfs::path& index_path,
+                                  const std::string& archive_path,
+                                  const FileState& state,
+                                  const std::string& sample_hash,
+                                  const ArchiveIndex& index)
+{
+  sfs::create_directories(index_path.parent_path());
+  sfs::path temp_path = index_path;
+  // the same archive may be indexed by multiple threads at once
+  temp_path += std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    BinaryWriter writer(temp_path);
+    writer.write<uint32_t>(MAGIC_NUMBER);
+    writer.write<uint32_t>(FILE_VERSION);
+    writer.writeString(archive_path);
+    writer.write<uint64_t>(state.size);
+    writer.write<int64_t>(state.time);
+    writer.writeString(sample_hash);
+    writer.write<int32_t>(index.format_);
+    writer.write<int32_t>(index.filter_);
+    writer.write<uint64_t>(index.entries_.size());
+    for(const auto& entry : index.entries_)
+    {
+      writer.writeString(entry.path);
+      writer.writeString(entry.hardlink);
+      writer.write<uint32_t>(entry.type);
+      writer.write<uint64_t>(entry.size);
+      writer.write<uint8_t>(entry.is_encrypted);
+    }
+    writer.flush();
+  }
+  sfs::rename(temp_path, index_path);
+}
@@ -0,0 +1,181 @@
+/*!
+ * \file archiveindex.h
+ * \brief Header for the ArchiveIndex class.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*!
+ * \brief Lists all entries of an archive, as read from the archives headers.
+ *
+ * Listings are cached in memory and, if a cache directory is given, on disk. A cached
+ * listing is only used while the size and modification time of the archive still match.
+ * Listings read from disk must also match a hash of the first and last bytes of the archive.
+ * The memory cache holds at most \ref MAX_CACHED_INDICES listings.
+ */
+class ArchiveIndex
+{
+public:
+  /*! \brief One entry of an archive. */
+  struct Entry
+  {
+    /*! \brief Path of the entry inside of the archive. */
+    std::string path;
+    /*! \brief Path of the hardlink target inside of the archive, or empty. */
+    std::string hardlink;
+    /*! \brief File type bits of the entries mode, e.g. AE_IFREG. */
+    uint32_t type;
+    /*! \brief Size of the entries data in bytes. */
+    uint64_t size;
+    /*! \brief If true: The entries data is encrypted. */
+    bool is_encrypted;
+  };
+
+  /*!
+   * \brief Returns the index of the given archive. Reads all headers of the archive, unless
+   * a valid cached index exists.
+   * \param archive_path Path to the archive.
+   * \param cache_dir Directory used to store indices on disk. If empty, the index is only cached
+   * in memory.
+   * \return The index.
+   * \throws CompressionError When the archive can not be read.
+   */
+  static std::shared_ptr<const ArchiveIndex> get(const std::filesystem::path& archive_path,
+                                                 const std::filesystem::path& cache_dir = {});
+  /*!
+   * \brief Returns the index of the given archive, if a valid cached index exists in memory or
+   * on disk. Never reads the archives headers.
+   * \param archive_path Path to the archive.
+   * \param cache_dir Directory used to store indices on disk. If empty, only the memory cache is
+   * checked.
+   * \return The index, or a null pointer if no cached index exists.
+   * \throws CompressionError When the archive can not be accessed.
+   */
+  static std::shared_ptr<const ArchiveIndex> getCached(
+    const std::filesystem::path& archive_path,
+    const std::filesystem::path& cache_dir = {});
+  /*!
+   * \brief Removes all index files from the given cache directory whose archive no longer
+   * exists or which can not be read. This is also done whenever a new index file is written.
+   * \param cache_dir Directory used to store indices on disk.
+   * \return The number of removed index files.
+   */
+  static int pruneCache(const std::filesystem::path& cache_dir);
+
+  /*!
+   * \brief Getter for all entries, in archive order.
+   * \return The entries.
+   */
+  const std::vector<Entry>& entries() const;
+  /*!
+   * \brief Getter for the libarchive format code of the archive.
+   * \return The format code.
+   */
+  int format() const;
+  /*!
+   * \brief Getter for the libarchive code of the outermost compression filter.
+   * \return The filter code.
+   */
+  int filter() const;
+
+private:
+  /*! \brief Identifies the archive file from which an index was read. */
+  struct FileState
+  {
+    /*! \brief Size of the archive. */
+    uint64_t size;
+    /*! \brief Modification time of the archive, in ticks of its clock. */
+    int64_t time;
+
+    bool operator==(const FileState&) const = default;
+  };
+
+  /*! \brief Identifies index files. */
+  static constexpr uint32_t MAGIC_NUMBER = 0x58444941;
+  /*! \brief Version of the index file format. */
+  static constexpr uint32_t FILE_VERSION = 2;
+  /*! \brief Extension used for index files. */
+  static inline const std::string FILE_EXTENSION = ".index";
+
+  /*! \brief Maximum number of indices kept in memory. */
+  static constexpr std::size_t MAX_CACHED_INDICES = 64;
+
+  /*! \brief An index kept in memory. */
+  struct CachedIndex
+  {
+    /*! \brief State of the archive file when the index was read. */
+    FileState state;
+    /*! \brief The index. */
+    std::shared_ptr<const ArchiveIndex> index;
+    /*! \brief Value of \ref use_counter_ when the index was last used. */
+    uint64_t last_use;
+  };
+
+  /*! \brief Guards all static members. */
+  static inline std::mutex mutex_;
+  /*! \brief Maps absolute archive paths to their cached index. */
+  static inline std::unordered_map<std::string, CachedIndex> indices_;
+  /*! \brief Incremented whenever a cached index is used. */
+  static inline uint64_t use_counter_ = 0;
+
+  /*! \brief All entries, in archive order. */
+  std::vector<Entry> entries_;
+  /*! \brief Libarchive format code. */
+  int format_ = 0;
+  /*! \brief Libarchive code of the outermost compression filter. */
+  int filter_ = 0;
+
+  /*!
+   * \brief Returns the cached index of the given archive, if one exists.
+   * \param archive_path Path to the archive.
+   * \param cache_dir Directory used to store indices on disk, or empty.
+   * \param read_archive If true: Reads the archives headers, if no cached index exists.
+   * \return The index, or a null pointer if no cached index exists and read_archive is false.
+   * \throws CompressionError When the archive can not be read.
+   */
+  static std::shared_ptr<const ArchiveIndex> find(const std::filesystem::path& archive_path,
+                                                  const std::filesystem::path& cache_dir,
+                                                  bool read_archive);
+  /*!
+   * \brief Reads all headers of the given archive.
+   * \param archive_path Path to the archive.
+   * \return The index.
+   * \throws CompressionError When the archive can not be read.
+   */
+  static std::shared_ptr<ArchiveIndex> readArchive(const std::filesystem::path& archive_path);
+  /*!
+   * \brief Reads an index file written by \ref writeIndexFile.
+   * \param index_path Path to the index file.
+   * \param archive_path Absolute path to the archive.
+   * \param state Current state of the archive file.
+   * \param sample_hash Current value of hash_utils::hashFileSample for the archive.
+   * \return The index, or a null pointer if the file does not exist or does not match the
+   * archive.
+   */
+  static std::shared_ptr<ArchiveIndex> readIndexFile(const std::filesystem::path& index_path,
+                                                     const std::string& archive_path,
+                                                     const FileState& state,
+                                                     const std::string& sample_hash);
+  /*!
+   * \brief Writes the given index to disk.
+   * \param index_path Path to the index file.
+   * \param archive_path Absolute path to the archive.
+   * \param state State of the archive file.
+   * \param sample_hash Value of hash_utils::hashFileSample for the archive.
+   * \param index Index to be written.
+   */
+  static void writeIndexFile(const std::filesystem::path& index_path,
+                             const std::string& archive_path,
+                             const FileState& state,
+                             const std::string& sample_hash,
+                             const ArchiveIndex& index);
+};
@@ -1,10 +1,12 @@
 #include "bg3deployer.h"
 #include "pathutils.h"
+#include "threadpool.h"
 #include <algorithm>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <ranges>
+#include <unordered_set>
 
 namespace sfs = std::filesystem;
 namespace str = std::ranges;
@@ -17,8 +19,8 @@ Bg3Deployer::Bg3Deployer(const std::filesystem::path& source_path,
 {
   type_ = "Baldurs Gate 3 Deployer";
   is_autonomous_ = true;
-  plugin_regex_ = R"(.*\.[pP][aA][kK])";
-  plugin_file_line_regex_ = R"(^\s*(\*?)([^#]*)(\r?))";
+  plugin_extensions_ = { ".pak" };
+  plugin_file_lines_require_extension_ = false;
   plugin_file_name_ = ".loadorder";
   config_file_name_ = ".pak_files.json";
   source_mods_file_name_ = ".plugin_mod_sources";
@@ -44,6 +46,7 @@ void Bg3Deployer::unDeploy(std::optional<ProgressNode*> progress_node)
   plugins_.clear();
   uuid_map_.clear();
   pak_files_.clear();
+  pak_file_index_is_valid_ = false;
   writePlugins();
   saveSettings();
 }
@@ -71,14 +74,31 @@ std::unordered_set<int> Bg3Deployer::getModConflicts(int mod_id,
   std::unordered_set<int> conflicts{ mod_id };
   if(progress_node)
     (*progress_node)->setTotalSteps(plugins_.size());
-  const std::string plugin_uuid = plugins_[mod_id].first;
-  auto file = pak_files_[uuid_map_[plugin_uuid]];
+  updatePakFileIndex();
+  auto get_pak_id = [this](const std::string& uuid)
+  {
+    auto iter = str::lower_bound(indexed_pak_files_, uuid_map_[uuid]);
+    if(iter == indexed_pak_files_.end() || *iter != uuid_map_[uuid])
+      return -1;
+    return static_cast<int>(iter - indexed_pak_files_.begin());
+  };
+
+  std::vector<bool> conflicting_paks(indexed_pak_files_.size(), false);
+  const int pak_id = get_pak_id(plugins_[mod_id].first);
+  if(pak_id >= 0)
+  {
+    for(const auto& file : pak_files_[indexed_pak_files_[pak_id]].getFileList())
+    {
+      for(int other_id : pak_file_index_[file.native()])
+        conflicting_paks[other_id] = true;
+    }
+  }
   for(const auto& [i, pair] : str::enumerate_view(plugins_))
   {
     if(i == mod_id)
       continue;
-    const auto& [uuid, enabled] = pair;
-    if(file.conflictsWith(pak_files_[uuid_map_[uuid]]))
+    const int other_id = get_pak_id(pair.first);
+    if(other_id >= 0 && conflicting_paks[other_id])
       conflicts.insert(i);
     if(progress_node)
       (*progress_node)->advance();
@@ -184,15 +204,15 @@ void Bg3Deployer::updateSourceMods()
     log_(Log::LOG_ERROR,
          std::format("Deployer '{}': Could not find deployed files at '{}'",
                      name_,
-                     deployed_source_path->string()));
+                     source_path_.string()));
     return;
   }
-  auto deployed_files = loadDeployedFiles({}, *deployed_source_path);
+  const auto deployed_files = getDeployedFiles(*deployed_source_path);
   const sfs::path relative_path(pu::getRelativePath(source_path_, *deployed_source_path));
   for(const auto& [uuid, _] : plugins_)
   {
-    auto iter = deployed_files.find(relative_path / uuid_map_[uuid]);
-    if(iter != deployed_files.end())
+    auto iter = deployed_files->find(relative_path / uuid_map_[uuid]);
+    if(iter != deployed_files->end())
       source_mods_[uuid] = iter->second;
   }
   writeSourceMods();
@@ -202,141 +222,151 @@ void Bg3Deployer::updatePluginTags() {}
 
 void Bg3Deployer::updatePluginsPrivate()
 {
+  pak_file_index_is_valid_ = false;
   std::vector<sfs::path> pak_file_paths;
   for(const auto& dir_entry : sfs::directory_iterator(source_path_))
   {
     if(dir_entry.is_directory())
       continue;
     const std::string file_name = dir_entry.path().filename().string();
-    if(std::regex_match(file_name, plugin_regex_) && !NON_PLUGIN_ARCHIVES.contains(file_name))
+    if(isPluginFile(file_name) && !NON_PLUGIN_ARCHIVES.contains(file_name))
       pak_file_paths.push_back(pu::getRelativePath(dir_entry.path(), source_path_));
   }
+  // directory order is unspecified, sort to keep the resulting load order deterministic
+  str::sort(pak_file_paths);
+
+  std::unordered_set<std::string> plugin_uuids;
+  plugin_uuids.reserve(plugins_.size());
+  for(const auto& [uuid, enabled] : plugins_)
+    plugin_uuids.insert(uuid);
+  auto remove_plugins = [this, &plugin_uuids](const std::unordered_set<std::string>& uuids)
+  {
+    if(uuids.empty())
+      return;
+    std::erase_if(plugins_, [&uuids](const auto& pair) { return uuids.contains(pair.first); });
+    for(const auto& uuid : uuids)
+      plugin_uuids.erase(uuid);
+  };
+
   // remove missing files
-  std::vector<std::filesystem::path> files_to_remove;
-  for(const auto& [path, file] : pak_files_)
+  const std::unordered_set<sfs::path> available_paths(pak_file_paths.begin(),
+                                                      pak_file_paths.end());
+  std::unordered_set<std::string> uuids_to_remove;
+  for(auto iter = pak_files_.begin(); iter != pak_files_.end();)
+  {
+    if(available_paths.contains(iter->first))
+    {
+      iter++;
+      continue;
+    }
+    for(const auto& plugin : iter->second.getPlugins())
+      uuids_to_remove.insert(plugin.getUuid());
+    iter = pak_files_.erase(iter);
+  }
+  remove_plugins(uuids_to_remove);
+
+  // parse new and modified files in parallel
+  std::vector<sfs::path> paths_to_parse;
+  for(const auto& path : pak_file_paths)
   {
-    if(str::find(pak_file_paths, path) == pak_file_paths.end())
-      files_to_remove.push_back(path);
+    auto file_iter = pak_files_.find(path);
+    if(file_iter == pak_files_.end() || !file_iter->second.timestampsMatch())
+      paths_to_parse.push_back(path);
   }
-  for(const auto& path : files_to_remove)
+  std::vector<std::optional<Bg3PakFile>> parsed_files(paths_to_parse.size());
+  std::vector<std::string> errors(paths_to_parse.size());
   {
-    std::vector<int> plugins_to_remove;
-    for(const auto& plugin : pak_files_[path].getPlugins())
+    ThreadPool pool;
+    std::vector<std::future<void>> results;
+    results.reserve(paths_to_parse.size());
+    for(int i = 0; i < paths_to_parse.size(); i++)
     {
-      auto iter = str::find_if(
-        plugins_, [&plugin](const auto& pair) { return pair.first == plugin.getUuid(); });
-      if(iter != plugins_.end())
-        plugins_to_remove.push_back(iter - plugins_.begin());
+      results.push_back(pool.submit(
+        [this, &paths_to_parse, &parsed_files, &errors, i]()
+        {
+          const sfs::path& path = paths_to_parse[i];
+          try
+          {
+            parsed_files[i] = Bg3PakFile(path, source_path_);
+          }
+          catch(std::runtime_error& error)
+          {
+            errors[i] = std::format("Failed to parse '{}':\n{}", path.string(), error.what());
+          }
+          catch(...)
+          {
+            errors[i] = std::format("Failed to parse '{}'.", path.string());
+          }
+        }));
     }
-    str::sort(plugins_to_remove);
-    for(int i : str::reverse_view(plugins_to_remove))
-      plugins_.erase(plugins_.begin() + i);
-    pak_files_.erase(path);
+    for(auto& result : results)
+      result.get();
   }
+
   // add new files and update modified files
-  for(const auto& path : pak_file_paths)
+  for(int i = 0; i < paths_to_parse.size(); i++)
   {
-    if(pak_files_.contains(path))
+    const sfs::path& path = paths_to_parse[i];
+    if(!parsed_files[i])
     {
-      if(pak_files_[path].timestampsMatch())
-        continue;
-
-      Bg3PakFile new_file;
-      try
-      {
-        new_file = Bg3PakFile(path, source_path_);
-      }
-      catch(std::runtime_error& error)
-      {
-        log_(Log::LOG_WARNING,
-             std::format("Failed to parse '{}':\n{}", path.string(), error.what()));
-        continue;
-      }
-      catch(...)
-      {
-        log_(Log::LOG_WARNING, std::format("Failed to parse '{}'.", path.string()));
-        continue;
-      }
+      log_(Log::LOG_WARNING, errors[i]);
+      continue;
+    }
+    Bg3PakFile& new_file = *parsed_files[i];
+    auto file_iter = pak_files_.find(path);
 
-      std::vector<int> plugins_to_remove;
-      for(const auto& old_plugin : pak_files_[path].getPlugins())
+    if(file_iter != pak_files_.end())
+    {
+      std::unordered_set<std::string> new_uuids;
+      for(const auto& plugin : new_file.getPlugins())
+        new_uuids.insert(plugin.getUuid());
+      uuids_to_remove.clear();
+      for(const auto& old_plugin : file_iter->second.getPlugins())
       {
-        if(str::none_of(new_file.getPlugins(),
-                        [&old_plugin](const auto& plugin)
-                        { return old_plugin.getUuid() == plugin.getUuid(); }))
+        if(!new_uuids.contains(old_plugin.getUuid()))
         {
           uuid_map_.erase(old_plugin.getUuid());
-          auto iter = str::find_if(plugins_,
-                                   [&old_plugin](const auto& pair)
-                                   { return pair.first == old_plugin.getUuid(); });
-          if(iter != plugins_.end())
-            plugins_to_remove.push_back(iter - plugins_.begin());
+          uuids_to_remove.insert(old_plugin.getUuid());
         }
       }
-      str::sort(plugins_to_remove);
-      for(int i : str::reverse_view(plugins_to_remove))
-        plugins_.erase(plugins_.begin() + i);
+      remove_plugins(uuids_to_remove);
 
       for(const auto& new_plugin : new_file.getPlugins())
       {
-        auto iter = str::find_if(
-          plugins_, [&new_plugin](const auto& pair) { return pair.first == new_plugin.getUuid(); });
-        if(iter == plugins_.end())
+        if(plugin_uuids.insert(new_plugin.getUuid()).second)
         {
           plugins_.emplace_back(new_plugin.getUuid(), true);
           uuid_map_[new_plugin.getUuid()] = path;
         }
       }
-      pak_files_[path] = new_file;
+      file_iter->second = std::move(new_file);
+      continue;
+    }
+
+    if(new_file.getPlugins().empty())
+    {
+      log_(Log::LOG_WARNING, std::format("Archive '{}' contains no plugins.", path.string()));
+      continue;
     }
-    else
+    const auto& added_file = pak_files_[path] = std::move(new_file);
+    for(const auto& plugin : added_file.getPlugins())
     {
-      Bg3PakFile new_file;
-      try
+      const std::string& uuid = plugin.getUuid();
+      if(plugin_uuids.insert(uuid).second)
       {
-        new_file = Bg3PakFile(path, source_path_);
+        plugins_.emplace_back(uuid, true);
+        uuid_map_[uuid] = path;
       }
-      catch(std::runtime_error& error)
+      else if(!uuid_map_.contains(uuid))
+        uuid_map_[uuid] = path;
+      else
       {
         log_(Log::LOG_WARNING,
-             std::format("Failed to parse '{}':\n{}", path.string(), error.what()));
-        continue;
-      }
-      catch(...)
-      {
-        log_(Log::LOG_WARNING, std::format("Failed to parse '{}'.", path.string()));
-        continue;
-      }
-
-      if(new_file.getPlugins().empty())
-      {
-        log_(Log::LOG_WARNING, std::format("Archive '{}' contains no plugins.", path.string()));
-        continue;
-      }
-      pak_files_[path] = new_file;
-      for(const auto& plugin : pak_files_[path].getPlugins())
-      {
-        auto iter = str::find_if(
-          plugins_, [&plugin](const auto& pair) { return pair.first == plugin.getUuid(); });
-        if(iter != plugins_.end())
-        {
-          if(!uuid_map_.contains(iter->first))
-            uuid_map_[plugin.getUuid()] = path;
-          else
-          {
-            log_(Log::LOG_WARNING,
-                 std::format("Pak files '{}' and '{}' contain identical mods with UUID '{}'.\n",
-                             path.filename().string(),
-                             uuid_map_[iter->first].filename().string(),
-                             iter->first) +
-                   std::format("Ignoring version in '{}'.", path.filename().string()));
-          }
-        }
-        else
-        {
-          plugins_.emplace_back(plugin.getUuid(), true);
-          uuid_map_[plugin.getUuid()] = path;
-        }
+             std::format("Pak files '{}' and '{}' contain identical mods with UUID '{}'.\n",
+                         path.filename().string(),
+                         uuid_map_[uuid].filename().string(),
+                         uuid) +
+               std::format("Ignoring version in '{}'.", path.filename().string()));
       }
     }
   }
@@ -369,6 +399,7 @@ void Bg3Deployer::loadSettingsPrivate()
   num_profiles_ = settings["num_profiles"].asInt();
   current_profile_ = settings["current_profile"].asInt();
   pak_files_.clear();
+  pak_file_index_is_valid_ = false;
   uuid_map_.clear();
   for(int i = 0; i < settings["pak_files"].size(); i++)
   {
@@ -459,3 +490,23 @@ void Bg3Deployer::saveSettingsPrivate() const
   file << settings;
   file.close();
 }
+
+void Bg3Deployer::updatePakFileIndex()
+{
+  if(pak_file_index_is_valid_)
+    return;
+  indexed_pak_files_.clear();
+  pak_file_index_.clear();
+  for(const auto& [path, pak_file] : pak_files_)
+  {
+    const int pak_id = indexed_pak_files_.size();
+    indexed_pak_files_.push_back(path);
+    for(const auto& file : pak_file.getFileList())
+    {
+      auto& pak_ids = pak_file_index_[file.native()];
+      if(pak_ids.empty() || pak_ids.back() != pak_id)
+        pak_ids.push_back(pak_id);
+    }
+  }
+  pak_file_index_is_valid_ = true;
+}
@@ -8,6 +8,8 @@
 #include "bg3pakfile.h"
 #include "plugindeployer.h"
 #include <map>
+#include <string_view>
+#include <unordered_map>
 
 
 /*!
@@ -62,6 +64,18 @@ protected:
   std::map<std::string, std::filesystem::path> uuid_map_;
   /*! \brief Maps pak file paths to the object containing that files plugin data. */
   std::map<std::filesystem::path, Bg3PakFile> pak_files_;
+  /*!
+   * \brief Paths of all pak files in \ref pak_files_ when \ref pak_file_index_ was built.
+   * Pak files are identified by their index in this vector.
+   */
+  std::vector<std::filesystem::path> indexed_pak_files_;
+  /*!
+   * \brief Maps every file contained in a pak file to the ids of all pak files containing it.
+   * Keys refer to the file lists stored in \ref pak_files_.
+   */
+  std::unordered_map<std::string_view, std::vector<int>> pak_file_index_;
+  /*! \brief If false: \ref pak_file_index_ has to be rebuilt before it can be used. */
+  bool pak_file_index_is_valid_ = false;
 
   /*! \brief Wrapper for \ref updatePluginsPrivate. */
   virtual void updatePlugins() override;
@@ -91,4 +105,6 @@ private:
   void loadSettingsPrivate();
   /*! \brief Writes plugins to modsettings.lsx. */
   void writePluginsPrivate() const;
+  /*! \brief Rebuilds \ref pak_file_index_ from \ref pak_files_, if it is not valid. */
+  void updatePakFileIndex();
 };
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <chrono>
 #include <ranges>
+#include <unordered_set>
 
 namespace sfs = std::filesystem;
 namespace str = std::ranges;
@@ -49,6 +50,11 @@ Json::Value Bg3PakFile::toJson() const
   return json_value;
 }
 
+const std::vector<sfs::path>& Bg3PakFile::getFileList() const
+{
+  return file_list_;
+}
+
 std::filesystem::path Bg3PakFile::getSourceFile() const
 {
   return source_file_;
@@ -80,34 +86,29 @@ bool Bg3PakFile::pluginConflictsWith(const std::string& plugin_uuid,
     str::find_if(plugins_, [&plugin_uuid](auto plugin) { return plugin_uuid == plugin.getUuid(); });
   if(iter == plugins_.end())
     return false;
-  const auto other_plugins = other_file.getPlugins();
+  const auto& other_plugins = other_file.getPlugins();
   auto other_iter = str::find_if(other_plugins,
                                  [&other_plugin_uuid](auto plugin)
                                  { return other_plugin_uuid == plugin.getUuid(); });
   if(other_iter == other_plugins.end())
     return false;
 
-  const auto dir = iter->getDirectory();
-  const auto other_dir = other_iter->getDirectory();
-  std::vector<std::string> plugin_files;
-  std::string prefix = "Mods/" + dir;
-  for(const auto& file : file_list_)
-  {
-    if(file.string().starts_with(prefix))
-      plugin_files.push_back(pu::getRelativePath(file, prefix));
-  }
-  std::vector<std::string> other_plugin_files;
-  prefix = "Mods/" + other_dir;
+  const std::string prefix = "Mods/" + iter->getDirectory();
+  const std::string other_prefix = "Mods/" + other_iter->getDirectory();
+  std::unordered_set<std::string> other_plugin_files;
   for(const auto& file : other_file.file_list_)
   {
-    if(file.string().starts_with(prefix))
-      other_plugin_files.push_back(pu::getRelativePath(file, prefix));
+    if(file.string().starts_with(other_prefix))
+      other_plugin_files.insert(pu::getRelativePath(file, other_prefix));
   }
 
-  for(const auto& file : plugin_files)
+  for(const auto& file : file_list_)
   {
-    if(file != "meta.lsx" && file != "meta.lsf" &&
-       str::find(other_plugin_files, file) != other_plugin_files.end())
+    if(!file.string().starts_with(prefix))
+      continue;
+    const std::string relative_path = pu::getRelativePath(file, prefix);
+    if(relative_path != "meta.lsx" && relative_path != "meta.lsf" &&
+       other_plugin_files.contains(relative_path))
       return true;
   }
   return false;
@@ -115,12 +116,10 @@ bool Bg3PakFile::pluginConflictsWith(const std::string& plugin_uuid,
 
 bool Bg3PakFile::conflictsWith(const Bg3PakFile& other)
 {
-  for(const auto& file : file_list_)
-  {
-    if(str::find(other.file_list_, file) != other.file_list_.end())
-      return true;
-  }
-  return false;
+  const std::unordered_set<sfs::path> other_files(other.file_list_.begin(),
+                                                  other.file_list_.end());
+  return str::any_of(file_list_, [&other_files](const auto& file)
+                     { return other_files.contains(file); });
 }
 
 time_t Bg3PakFile::getTimestamp(const sfs::path& file)
@@ -39,6 +39,11 @@ public:
    * \return Json object containing serialized data.
    */
   Json::Value toJson() const;
+  /*!
+   * \brief Returns paths to all files contained in the source file.
+   * \return The paths.
+   */
+  const std::vector<std::filesystem::path>& getFileList() const;
   /*!
    * \brief Returns the path to this object's source file.
    * \return The path.
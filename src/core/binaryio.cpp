@@ -0,0 +1,78 @@
+#include "binaryio.h"
+
+namespace sfs = std::filesystem;
+
+
+BinaryWriter::BinaryWriter(const sfs::path& path, bool append) :
+  path_(path), file_(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc))
+{
+  if(!file_.is_open())
+    throw std::runtime_error("Could not write to \"" + path.string() + "\".");
+}
+
+void BinaryWriter::writeString(const std::string& value)
+{
+  write<uint32_t>(value.size());
+  writeBytes(value.data(), value.size());
+}
+
+void BinaryWriter::writeBits(const std::vector<bool>& bits)
+{
+  write<uint32_t>(bits.size());
+  std::vector<char> bytes((bits.size() + 7) / 8, 0);
+  for(std::size_t i = 0; i < bits.size(); i++)
+  {
+    if(bits[i])
+      bytes[i / 8] |= 1 << (i % 8);
+  }
+  writeBytes(bytes.data(), bytes.size());
+}
+
+void BinaryWriter::writeBytes(const char* data, std::size_t size)
+{
+  file_.write(data, size);
+}
+
+void BinaryWriter::flush()
+{
+  file_.flush();
+  if(!file_)
+    throw std::runtime_error("Could not write to \"" + path_.string() + "\".");
+}
+
+BinaryReader::BinaryReader(const sfs::path& path) : path_(path), file_(path, std::ios::binary)
+{
+  if(!file_.is_open())
+    throw std::runtime_error("Could not read \"" + path.string() + "\".");
+}
+
+std::string BinaryReader::readString()
+{
+  const auto size = read<uint32_t>();
+  std::string value(size, '\0');
+  readBytes(value.data(), size);
+  return value;
+}
+
+std::vector<bool> BinaryReader::readBits()
+{
+  const auto num_bits = read<uint32_t>();
+  std::vector<char> bytes((num_bits + 7) / 8);
+  readBytes(bytes.data(), bytes.size());
+  std::vector<bool> bits(num_bits);
+  for(std::size_t i = 0; i < num_bits; i++)
+    bits[i] = bytes[i / 8] & (1 << (i % 8));
+  return bits;
+}
+
+void BinaryReader::readBytes(char* data, std::size_t size)
+{
+  file_.read(data, size);
+  if(file_.gcount() != size)
+    throw ParseError("Unexpected end of file in \"" + path_.string() + "\".");
+}
+
+bool BinaryReader::atEnd()
+{
+  return file_.peek() == std::ifstream::traits_type::eof();
+}
@@ -0,0 +1,127 @@
+/*!
+ * \file binaryio.h
+ * \brief Header for the BinaryWriter and BinaryReader classes.
+ */
+
+#pragma once
+
+#include "parseerror.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+/*!
+ * \brief Writes values to a binary file. Integers are stored in host byte order.
+ */
+class BinaryWriter
+{
+public:
+  /*!
+   * \brief Opens the given file for writing.
+   * \param path Path to the file.
+   * \param append If true: Append to the file, else: Replace it.
+   * \throws std::runtime_error When the file cannot be opened.
+   */
+  BinaryWriter(const std::filesystem::path& path, bool append = false);
+
+  /*!
+   * \brief Writes the given value.
+   * \param value Value to be written.
+   */
+  template<typename T>
+    requires std::is_trivially_copyable_v<T>
+  void write(const T& value)
+  {
+    file_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  /*!
+   * \brief Writes the given string, prefixed by its length.
+   * \param value String to be written.
+   */
+  void writeString(const std::string& value);
+  /*!
+   * \brief Writes the given flags packed into bytes, prefixed by their number.
+   * \param bits Flags to be written.
+   */
+  void writeBits(const std::vector<bool>& bits);
+  /*!
+   * \brief Writes the given raw bytes.
+   * \param data Data to be written.
+   * \param size Number of bytes to write.
+   */
+  void writeBytes(const char* data, std::size_t size);
+  /*!
+   * \brief Flushes all data to disk.
+   * \throws std::runtime_error When writing failed.
+   */
+  void flush();
+
+private:
+  /*! \brief Path to the target file. */
+  std::filesystem::path path_;
+  /*! \brief The target file. */
+  std::ofstream file_;
+};
+
+
+/*!
+ * \brief Reads values written by a BinaryWriter.
+ */
+class BinaryReader
+{
+public:
+  /*!
+   * \brief Opens the given file for reading.
+   * \param path Path to the file.
+   * \throws std::runtime_error When the file cannot be opened.
+   */
+  BinaryReader(const std::filesystem::path& path);
+
+  /*!
+   * \brief Reads a value.
+   * \return The value.
+   * \throws ParseError When the end of the file has been reached.
+   */
+  template<typename T>
+    requires std::is_trivially_copyable_v<T>
+  T read()
+  {
+    T value;
+    readBytes(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+  }
+  /*!
+   * \brief Reads a string written by BinaryWriter::writeString.
+   * \return The string.
+   * \throws ParseError When the end of the file has been reached.
+   */
+  std::string readString();
+  /*!
+   * \brief Reads flags written by BinaryWriter::writeBits.
+   * \return The flags.
+   * \throws ParseError When the end of the file has been reached.
+   */
+  std::vector<bool> readBits();
+  /*!
+   * \brief Reads the given number of raw bytes.
+   * \param data Target buffer.
+   * \param size Number of bytes to read.
+   * \throws ParseError When the end of the file has been reached.
+   */
+  void readBytes(char* data, std::size_t size);
+  /*!
+   * \brief Checks if all data has been read.
+   * \return True if no data is left.
+   */
+  bool atEnd();
+
+private:
+  /*! \brief Path to the source file. */
+  std::filesystem::path path_;
+  /*! \brief The source file. */
+  std::ifstream file_;
+};
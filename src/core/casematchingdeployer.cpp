@@ -32,7 +32,8 @@ std::map<int, unsigned long> CaseMatchingDeployer::deploy(
 
 void CaseMatchingDeployer::updateDeployedFilesForMod(
   int mod_id,
-  std::optional<ProgressNode*> progress_node) const
+  std::optional<ProgressNode*> progress_node,
+  const std::optional<std::set<sfs::path>>& changed_files) const
 {
   std::map<sfs::path, int> deployed_files = loadDeployedFiles(progress_node);
   for(const auto& [path, id] : deployed_files)
@@ -41,7 +42,7 @@ void CaseMatchingDeployer::updateDeployedFilesForMod(
       continue;
     const sfs::path dest_path = dest_path_ / path;
     auto actual_path = pu::pathExists(path, source_path_ / std::to_string(mod_id));
-    if(!actual_path)
+    if(!actual_path || changed_files && !changed_files->contains(*actual_path))
       continue;
     const sfs::path source_path = source_path_ / std::to_string(mod_id) / *actual_path;
 
@@ -42,10 +42,13 @@ public:
    * \brief Updates the deployed files for one mod to match those in the mod's source directory.
    * \param mod_id Target mod.
    * \param progress_node Used to inform about progress.
+   * \param changed_files If set: Only update deployed files with these paths, relative to the
+   * mod's source directory.
    */
   virtual void updateDeployedFilesForMod(
     int mod_id,
-    std::optional<ProgressNode*> progress_node = {}) const override;
+    std::optional<ProgressNode*> progress_node = {},
+    const std::optional<std::set<std::filesystem::path>>& changed_files = {}) const override;
   /*!
    * \brief Returns whether or not this deployer types is case invariant.
    * \return True.
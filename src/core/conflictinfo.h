@@ -20,4 +20,6 @@ struct ConflictInfo
   std::vector<int> mod_ids;
   /*! \brief Name of the conflicts winning mod. */
   std::vector<std::string> mod_names;
+  /*! \brief If true: All mods contain identical versions of the file. */
+  bool is_identical = false;
 };
@@ -0,0 +1,156 @@
+#include "contentstore.h"
+#include "hashutils.h"
+#include <fcntl.h>
+#include <fstream>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace sfs = std::filesystem;
+
+
+ContentStore::ContentStore(const sfs::path& store_path) : store_path_(store_path) {}
+
+std::string ContentStore::addFile(const sfs::path& path)
+{
+  const std::string hash = hash_utils::hashFile(path);
+  const sfs::path stored_path = getStoredFilePath(hash);
+  // stored files are read only, but can still be changed or damaged outside of this class
+  if(sfs::exists(stored_path) && hash_utils::hashFile(stored_path) != hash)
+    sfs::remove(stored_path);
+  if(sfs::exists(stored_path))
+  {
+    createLink(stored_path, path);
+    return hash;
+  }
+  // the file keeps its inode, so that existing hard links to it remain valid
+  sfs::create_directories(stored_path.parent_path());
+  sfs::path temp_path = stored_path;
+  temp_path += ".lmmtmp";
+  sfs::remove(temp_path);
+  if(!supportsReflinks() || !createReflink(path, temp_path))
+    sfs::copy_file(path, temp_path);
+  sfs::permissions(temp_path,
+                   sfs::perms::owner_write | sfs::perms::group_write | sfs::perms::others_write,
+                   sfs::perm_options::remove);
+  sfs::rename(temp_path, stored_path);
+  return hash;
+}
+
+bool ContentStore::linkFile(const std::string& hash, const sfs::path& destination)
+{
+  const sfs::path stored_path = getStoredFilePath(hash);
+  if(!sfs::exists(stored_path))
+    return false;
+  if(destination.has_parent_path())
+    sfs::create_directories(destination.parent_path());
+  createLink(stored_path, destination);
+  return true;
+}
+
+bool ContentStore::isLinked(const sfs::path& path, const std::string& hash) const
+{
+  const sfs::path stored_path = getStoredFilePath(hash);
+  if(!sfs::is_regular_file(path) || !sfs::exists(stored_path))
+    return false;
+  // linked files can be edited in place without changing their size or modification time
+  return sfs::file_size(path) == sfs::file_size(stored_path) && hash_utils::hashFile(path) == hash;
+}
+
+bool ContentStore::contains(const std::string& hash) const
+{
+  return sfs::exists(getStoredFilePath(hash));
+}
+
+sfs::path ContentStore::getStoredFilePath(const std::string& hash) const
+{
+  return store_path_ / hash.substr(0, 2) / hash;
+}
+
+int ContentStore::collectGarbage(const std::unordered_set<std::string>& referenced_hashes) const
+{
+  if(!sfs::exists(store_path_))
+    return 0;
+
+  int num_deleted_files = 0;
+  for(const auto& dir_entry : sfs::directory_iterator(store_path_))
+  {
+    if(!dir_entry.is_directory())
+      continue;
+    bool dir_is_empty = true;
+    for(const auto& file_entry : sfs::directory_iterator(dir_entry.path()))
+    {
+      if(referenced_hashes.contains(file_entry.path().filename().string()))
+      {
+        dir_is_empty = false;
+        continue;
+      }
+      sfs::remove(file_entry.path());
+      num_deleted_files++;
+    }
+    if(dir_is_empty)
+      sfs::remove(dir_entry.path());
+  }
+  return num_deleted_files;
+}
+
+void ContentStore::clear() const
+{
+  sfs::remove_all(store_path_);
+}
+
+bool ContentStore::supportsReflinks()
+{
+  if(reflinks_supported_)
+    return *reflinks_supported_;
+
+  sfs::create_directories(store_path_);
+  const sfs::path probe_path = store_path_ / ".reflink_probe";
+  const sfs::path clone_path = store_path_ / ".reflink_probe_clone";
+  sfs::remove(probe_path);
+  sfs::remove(clone_path);
+  std::ofstream(probe_path) << "probe";
+  reflinks_supported_ = createReflink(probe_path, clone_path);
+  sfs::remove(clone_path);
+  sfs::remove(probe_path);
+  return *reflinks_supported_;
+}
+
+const sfs::path& ContentStore::storePath() const
+{
+  return store_path_;
+}
+
+void ContentStore::createLink(const sfs::path& source, const sfs::path& destination)
+{
+  sfs::path temp_path = destination;
+  temp_path += ".lmmtmp";
+  sfs::remove(temp_path);
+
+  if(supportsReflinks() && createReflink(source, temp_path))
+    sfs::last_write_time(temp_path, sfs::last_write_time(source));
+  else
+    sfs::copy_file(source, temp_path, sfs::copy_options::copy_symlinks);
+  // stored files are read only, links must remain editable
+  sfs::permissions(temp_path, sfs::status(source).permissions() | sfs::perms::owner_write);
+  sfs::rename(temp_path, destination);
+}
+
+bool ContentStore::createReflink(const sfs::path& source, const sfs::path& destination) const
+{
+  const int source_fd = open(source.c_str(), O_RDONLY);
+  if(source_fd < 0)
+    return false;
+  const int dest_fd = open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if(dest_fd < 0)
+  {
+    close(source_fd);
+    return false;
+  }
+  const bool success = ioctl(dest_fd, FICLONE, source_fd) == 0;
+  close(dest_fd);
+  close(source_fd);
+  if(!success)
+    sfs::remove(destination);
+  return success;
+}
@@ -0,0 +1,110 @@
+/*!
+ * \file contentstore.h
+ * \brief Header for the ContentStore class.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+
+/*!
+ * \brief Stores files by their content hash. Identical files are stored only once and
+ * linked to every location at which they are used.
+ *
+ * Files are linked using reflinks (copy on write clones), if the file system supports them.
+ * Otherwise files are copied, since shared inodes would allow an in place edit of one location
+ * to change every other location. Callers should check \ref supportsReflinks before adding
+ * files, as the store only saves space when reflinks are available. Stored files are read only.
+ */
+class ContentStore
+{
+public:
+  /*!
+   * \brief Constructor.
+   * \param store_path Directory in which stored files are kept. Must be on the same file
+   * system as all files which are to be added.
+   */
+  ContentStore(const std::filesystem::path& store_path);
+
+  /*!
+   * \brief Adds a clone of the given file to the store, if no identical file is stored yet.
+   * Otherwise replaces the file with a link to the stored file. A stored file whose content no
+   * longer matches its hash is replaced.
+   * \param path File to be added.
+   * \return The content hash of the file.
+   */
+  std::string addFile(const std::filesystem::path& path);
+  /*!
+   * \brief Creates a link to the stored file with the given hash at the given destination.
+   * Replaces the destination if it exists.
+   * \param hash Hash of the stored file.
+   * \param destination Path at which to create the link.
+   * \return True if the file has been linked, false if no file with the given hash is stored.
+   */
+  bool linkFile(const std::string& hash, const std::filesystem::path& destination);
+  /*!
+   * \brief Checks if the given file is still identical to the stored file with the given hash.
+   * This requires hashing the file, unless its size differs.
+   * \param path File to check.
+   * \param hash Hash of the stored file.
+   * \return True if the file has the given hash and the stored file exists.
+   */
+  bool isLinked(const std::filesystem::path& path, const std::string& hash) const;
+  /*!
+   * \brief Checks if a file with the given hash is stored.
+   * \param hash Hash to check.
+   * \return True if the file exists.
+   */
+  bool contains(const std::string& hash) const;
+  /*!
+   * \brief Returns the path to the stored file with the given hash.
+   * \param hash Target hash.
+   * \return The path.
+   */
+  std::filesystem::path getStoredFilePath(const std::string& hash) const;
+  /*!
+   * \brief Deletes all stored files whose hash is not contained in the given set.
+   * \param referenced_hashes Hashes of all files which are still in use.
+   * \return The number of deleted files.
+   */
+  int collectGarbage(const std::unordered_set<std::string>& referenced_hashes) const;
+  /*! \brief Deletes the store directory and all stored files. */
+  void clear() const;
+  /*!
+   * \brief Checks if the file system containing the store supports reflinks.
+   * The result is determined once by cloning a small probe file and then cached.
+   * \return True if reflinks can be created.
+   */
+  bool supportsReflinks();
+  /*!
+   * \brief Getter for the store directory.
+   * \return The path.
+   */
+  const std::filesystem::path& storePath() const;
+
+private:
+  /*! \brief Directory in which stored files are kept. */
+  std::filesystem::path store_path_;
+  /*! \brief Whether or not reflinks are supported. Empty until \ref supportsReflinks is called. */
+  std::optional<bool> reflinks_supported_;
+
+  /*!
+   * \brief Links source to destination, using a reflink if possible. Otherwise copies
+   * source. Replaces the destination if it exists.
+   * \param source Stored file.
+   * \param destination Target path.
+   */
+  void createLink(const std::filesystem::path& source, const std::filesystem::path& destination);
+  /*!
+   * \brief Tries to create a reflink of source at destination.
+   * \param source Source file.
+   * \param destination Target path. Must not exist.
+   * \return True on success.
+   */
+  bool createReflink(const std::filesystem::path& source,
+                     const std::filesystem::path& destination) const;
+};
@@ -0,0 +1,53 @@
+#include "deployedfilesregistry.h"
+
+namespace sfs = std::filesystem;
+
+
+std::shared_ptr<const DeployedFilesRegistry::DeployedFiles> DeployedFilesRegistry::get(
+  const sfs::path& manifest_path)
+{
+  const sfs::path key = manifest_path.lexically_normal();
+  std::scoped_lock lock(mutex_);
+  auto iter = entries_.find(key);
+  if(iter == entries_.end())
+    return nullptr;
+
+  std::error_code error;
+  const auto size = sfs::file_size(key, error);
+  const auto time = error ? sfs::file_time_type{} : sfs::last_write_time(key, error);
+  if(error || size != iter->second.size || time != iter->second.time)
+  {
+    entries_.erase(iter);
+    return nullptr;
+  }
+  return iter->second.files;
+}
+
+std::shared_ptr<const DeployedFilesRegistry::DeployedFiles> DeployedFilesRegistry::set(
+  const sfs::path& manifest_path,
+  DeployedFiles deployed_files)
+{
+  const sfs::path key = manifest_path.lexically_normal();
+  auto files = std::make_shared<const DeployedFiles>(std::move(deployed_files));
+  std::error_code error;
+  const auto size = sfs::file_size(key, error);
+  const auto time = error ? sfs::file_time_type{} : sfs::last_write_time(key, error);
+  std::scoped_lock lock(mutex_);
+  if(error)
+    entries_.erase(key);
+  else
+    entries_[key] = { size, time, files };
+  return files;
+}
+
+void DeployedFilesRegistry::remove(const sfs::path& manifest_path)
+{
+  std::scoped_lock lock(mutex_);
+  entries_.erase(manifest_path.lexically_normal());
+}
+
+void DeployedFilesRegistry::clear()
+{
+  std::scoped_lock lock(mutex_);
+  entries_.clear();
+}
@@ -0,0 +1,69 @@
+/*!
+ * \file deployedfilesregistry.h
+ * \brief Header for the DeployedFilesRegistry class.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+
+
+/*!
+ * \brief Keeps the deployed files of every Deployer of one application in memory, so that
+ * deployers can look up files deployed by other deployers without parsing their manifests.
+ *
+ * Entries are keyed by the path of the manifest file in which a deployer stores its deployed
+ * files. Every entry remembers the size and modification time of that file and is discarded
+ * as soon as the file on disk no longer matches.
+ */
+class DeployedFilesRegistry
+{
+public:
+  /*! \brief Maps paths of deployed files, relative to the target directory, to mod ids. */
+  using DeployedFiles = std::map<std::filesystem::path, int>;
+
+  /*!
+   * \brief Returns the deployed files stored in the given manifest.
+   * \param manifest_path Path to the manifest.
+   * \return The deployed files, or a null pointer if the manifest is not registered or has
+   * been modified since it was registered.
+   */
+  std::shared_ptr<const DeployedFiles> get(const std::filesystem::path& manifest_path);
+  /*!
+   * \brief Registers the given files for the given manifest. The manifest must already have
+   * been written to disk.
+   * \param manifest_path Path to the manifest.
+   * \param deployed_files Files stored in the manifest.
+   * \return The registered files.
+   */
+  std::shared_ptr<const DeployedFiles> set(const std::filesystem::path& manifest_path,
+                                           DeployedFiles deployed_files);
+  /*!
+   * \brief Removes the entry for the given manifest, if it exists.
+   * \param manifest_path Path to the manifest.
+   */
+  void remove(const std::filesystem::path& manifest_path);
+  /*! \brief Removes all entries. */
+  void clear();
+
+private:
+  /*! \brief Deployed files of one manifest and the state of the manifest file. */
+  struct Entry
+  {
+    /*! \brief Size of the manifest file. */
+    std::uintmax_t size;
+    /*! \brief Modification time of the manifest file. */
+    std::filesystem::file_time_type time;
+    /*! \brief Files stored in the manifest. */
+    std::shared_ptr<const DeployedFiles> files;
+  };
+
+  /*! \brief Maps normalized manifest paths to their entries. */
+  std::map<std::filesystem::path, Entry> entries_;
+  /*! \brief Synchronizes access to \ref entries_. */
+  std::mutex mutex_;
+};
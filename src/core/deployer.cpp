@@ -587,6 +587,13 @@ void Deployer::deployFiles(const std::map<sfs::path, int>& source_files,
 
 std::map<sfs::path, int> Deployer::loadDeployedFiles(std::optional<ProgressNode*> progress_node,
                                                      sfs::path dest_path) const
+{
+  return *getDeployedFiles(dest_path, progress_node);
+}
+
+std::shared_ptr<const std::map<sfs::path, int>> Deployer::getDeployedFiles(
+  sfs::path dest_path,
+  std::optional<ProgressNode*> progress_node) const
 {
   if(dest_path == "")
     dest_path = dest_path_;
@@ -595,10 +602,22 @@ std::map<sfs::path, int> Deployer::loadDeployedFiles(std::optional<ProgressNode*
     (*progress_node)->addChildren({ 1, 2 });
     (*progress_node)->child(0).setTotalSteps(1);
   }
-  std::map<sfs::path, int> deployed_files;
   sfs::path deployed_files_path = dest_path / deployed_files_name_;
+  if(deployed_files_registry_)
+  {
+    if(auto deployed_files = deployed_files_registry_->get(deployed_files_path))
+    {
+      if(progress_node)
+      {
+        (*progress_node)->child(0).advance();
+        (*progress_node)->child(1).setTotalSteps(1);
+        (*progress_node)->child(1).advance();
+      }
+      return deployed_files;
+    }
+  }
   if(!sfs::exists(deployed_files_path))
-    return deployed_files;
+    return std::make_shared<const std::map<sfs::path, int>>();
   std::ifstream file(deployed_files_path, std::fstream::binary);
   if(!file.is_open())
     throw std::runtime_error("Could not read \"" + deployed_files_path.string() + "\"");
@@ -609,6 +628,7 @@ std::map<sfs::path, int> Deployer::loadDeployedFiles(std::optional<ProgressNode*
     (*progress_node)->child(0).advance();
     (*progress_node)->child(1).setTotalSteps(json_object["files"].size());
   }
+  std::map<sfs::path, int> deployed_files;
   for(int i = 0; i < json_object["files"].size(); i++)
   {
     deployed_files[json_object["files"][i]["path"].asString()] =
@@ -616,7 +636,9 @@ std::map<sfs::path, int> Deployer::loadDeployedFiles(std::optional<ProgressNode*
     if(progress_node)
       (*progress_node)->child(1).advance();
   }
-  return deployed_files;
+  if(deployed_files_registry_)
+    return deployed_files_registry_->set(deployed_files_path, std::move(deployed_files));
+  return std::make_shared<const std::map<sfs::path, int>>(std::move(deployed_files));
 }
 
 void Deployer::saveDeployedFiles(const std::map<sfs::path, int>& deployed_files,
@@ -644,6 +666,8 @@ void Deployer::saveDeployedFiles(const std::map<sfs::path, int>& deployed_files,
   }
   file << json_object;
   file.close();
+  if(deployed_files_registry_)
+    deployed_files_registry_->set(deployed_files_path, deployed_files);
   if(progress_node)
     (*progress_node)->child(1).advance();
 }
@@ -772,10 +796,17 @@ void Deployer::setLog(const std::function<void(Log::LogLevel, const std::string&
   log_ = newLog;
 }
 
+void Deployer::setDeployedFilesRegistry(std::shared_ptr<DeployedFilesRegistry> registry)
+{
+  deployed_files_registry_ = std::move(registry);
+}
+
 void Deployer::cleanup()
 {
   deploy(std::vector<int>{});
   sfs::remove(dest_path_ / deployed_files_name_);
+  if(deployed_files_registry_)
+    deployed_files_registry_->remove(dest_path_ / deployed_files_name_);
 }
 
 bool Deployer::autoUpdateConflictGroups() const
@@ -887,13 +918,15 @@ void Deployer::keepOrRevertFileModifications(const FileChangeChoices& changes_to
   }
 }
 
-void Deployer::updateDeployedFilesForMod(int mod_id,
-                                         std::optional<ProgressNode*> progress_node) const
+void Deployer::updateDeployedFilesForMod(
+  int mod_id,
+  std::optional<ProgressNode*> progress_node,
+  const std::optional<std::set<sfs::path>>& changed_files) const
 {
   std::map<sfs::path, int> deployed_files = loadDeployedFiles(progress_node);
   for(const auto& [path, id] : deployed_files)
   {
-    if(id != mod_id)
+    if(id != mod_id || changed_files && !changed_files->contains(path))
       continue;
     const sfs::path dest_path = dest_path_ / path;
     const sfs::path source_path = source_path_ / std::to_string(mod_id) / path;
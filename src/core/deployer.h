@@ -6,6 +6,7 @@
 #pragma once
 
 #include "conflictinfo.h"
+#include "deployedfilesregistry.h"
 #include "deployerentry.hpp"
 #include "treeitem.h"
 #include "filechangechoices.h"
@@ -14,6 +15,7 @@
 #include <filesystem>
 #include <map>
 #include <optional>
+#include <set>
 #include <unordered_set>
 #include <vector>
 
@@ -258,6 +260,12 @@ public:
    * \param newLog New log callback
    */
   void setLog(const std::function<void(Log::LogLevel, const std::string&)>& newLog);
+  /*!
+   * \brief Setter for the registry used to share deployed files with other deployers.
+   * \param registry The new registry. If this is a null pointer, deployed files are always
+   * read from disk.
+   */
+  void setDeployedFilesRegistry(std::shared_ptr<DeployedFilesRegistry> registry);
   /*!
    * \brief Removes all deployed mods from the target directory and deletes the file
    * which stores the state of this deployer.
@@ -314,9 +322,13 @@ public:
    * \brief Updates the deployed files for one mod to match those in the mod's source directory.
    * \param mod_id Target mod.
    * \param progress_node Used to inform about progress.
+   * \param changed_files If set: Only update deployed files with these paths, relative to the
+   * mod's source directory.
    */
-  virtual void updateDeployedFilesForMod(int mod_id,
-                                         std::optional<ProgressNode*> progress_node = {}) const;
+  virtual void updateDeployedFilesForMod(
+    int mod_id,
+    std::optional<ProgressNode*> progress_node = {},
+    const std::optional<std::set<std::filesystem::path>>& changed_files = {}) const;
   /*! \brief If using hard_link deploy mode and links cannot be created: Switch to sym links. */
   virtual void fixInvalidLinkDeployMode();
   /*!
@@ -429,6 +441,8 @@ protected:
   bool auto_update_conflict_groups_ = false;
   /*! \brief Determines whether sorting mods can affect overwrite behavior. */
   bool enable_unsafe_sorting_ = false;
+  /*! \brief Shares deployed files with all other deployers of the same application. */
+  std::shared_ptr<DeployedFilesRegistry> deployed_files_registry_;
 
   /*!
    * \brief Creates a pair of maps. One maps relative file paths to the mod id from which that
@@ -462,6 +476,16 @@ protected:
    */
   std::map<std::filesystem::path, int> loadDeployedFiles(
     std::optional<ProgressNode*> progress_node = {}, std::filesystem::path dest_path = "") const;
+  /*!
+   * \brief Returns the files currently deployed to the given directory. Uses the registry
+   * if it contains the files, otherwise reads them from disk and adds them to the registry.
+   * \param dest_path Directory containing the file in which deployed file names are stored.
+   * If empty: Use the location in dest_path_ instead.
+   * \param progress_node Used to inform about the current progress.
+   * \return Maps deployed files to their source mods.
+   */
+  std::shared_ptr<const std::map<std::filesystem::path, int>> getDeployedFiles(
+    std::filesystem::path dest_path = "", std::optional<ProgressNode*> progress_node = {}) const;
   /*!
    * \brief Creates a file containing information about currently deployed files.
    * \param deployed_files The currently deployed files.
@@ -0,0 +1,128 @@
+#include "downloadindex.h"
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <json/json.h>
+#include <ranges>
+
+namespace sfs = std::filesystem;
+namespace str = std::ranges;
+
+
+DownloadIndex::DownloadIndex(const sfs::path& download_dir) : download_dir_(download_dir)
+{
+  readIndex();
+}
+
+std::optional<sfs::path> DownloadIndex::findRemoteFile(long remote_mod_id,
+                                                       long remote_file_id) const
+{
+  if(remote_mod_id < 0 || remote_file_id < 0)
+    return {};
+  for(const auto& archive : archives_)
+  {
+    if(str::find(archive.remote_files, std::pair{ remote_mod_id, remote_file_id }) !=
+         archive.remote_files.end() &&
+       isValid(archive))
+      return download_dir_ / archive.file_name;
+  }
+  return {};
+}
+
+std::optional<sfs::path> DownloadIndex::findHash(const std::string& hash) const
+{
+  for(const auto& archive : archives_)
+  {
+    if(archive.hash == hash && isValid(archive))
+      return download_dir_ / archive.file_name;
+  }
+  return {};
+}
+
+void DownloadIndex::addArchive(const sfs::path& archive_path,
+                               const std::string& hash,
+                               const std::string& md5,
+                               long remote_mod_id,
+                               long remote_file_id)
+{
+  auto iter = str::find_if(archives_,
+                           [this, &hash](const Archive& archive)
+                           { return archive.hash == hash && isValid(archive); });
+  if(iter == archives_.end())
+  {
+    archives_.push_back(
+      { archive_path.filename().string(), sfs::file_size(archive_path), hash, md5, {} });
+    iter = std::prev(archives_.end());
+  }
+  const std::pair remote_file{ remote_mod_id, remote_file_id };
+  if(remote_mod_id >= 0 && remote_file_id >= 0 &&
+     str::find(iter->remote_files, remote_file) == iter->remote_files.end())
+    iter->remote_files.push_back(remote_file);
+  writeIndex();
+}
+
+bool DownloadIndex::isValid(const Archive& archive) const
+{
+  const sfs::path path = download_dir_ / archive.file_name;
+  return sfs::is_regular_file(path) && sfs::file_size(path) == archive.size;
+}
+
+void DownloadIndex::readIndex()
+{
+  archives_.clear();
+  std::ifstream file(download_dir_ / INDEX_FILE_NAME, std::fstream::binary);
+  if(!file.is_open())
+    return;
+  Json::Value json;
+  try
+  {
+    file >> json;
+  }
+  catch(Json::Exception&)
+  {
+    return;
+  }
+  for(const auto& json_archive : json["archives"])
+  {
+    Archive archive{ json_archive["file_name"].asString(),
+                     json_archive["size"].asUInt64(),
+                     json_archive["hash"].asString(),
+                     json_archive["md5"].asString(),
+                     {} };
+    for(const auto& remote_file : json_archive["remote_files"])
+      archive.remote_files.emplace_back(remote_file[0].asInt64(), remote_file[1].asInt64());
+    archives_.push_back(archive);
+  }
+}
+
+void DownloadIndex::writeIndex() const
+{
+  Json::Value json;
+  json["archives"] = Json::arrayValue;
+  for(const auto& archive : archives_)
+  {
+    if(!isValid(archive))
+      continue;
+    Json::Value json_archive;
+    json_archive["file_name"] = archive.file_name;
+    json_archive["size"] = Json::UInt64(archive.size);
+    json_archive["hash"] = archive.hash;
+    json_archive["md5"] = archive.md5;
+    json_archive["remote_files"] = Json::arrayValue;
+    for(const auto& [mod_id, file_id] : archive.remote_files)
+    {
+      Json::Value remote_file;
+      remote_file[0] = Json::Int64(mod_id);
+      remote_file[1] = Json::Int64(file_id);
+      json_archive["remote_files"].append(remote_file);
+    }
+    json["archives"].append(json_archive);
+  }
+  const sfs::path tmp_path = download_dir_ / (INDEX_FILE_NAME + ".tmp");
+  std::ofstream file(tmp_path, std::fstream::binary);
+  if(!file.is_open())
+    throw std::runtime_error(std::format("Could not write to '{}'.", tmp_path.string()));
+  file << json;
+  file.close();
+  sfs::rename(tmp_path, download_dir_ / INDEX_FILE_NAME);
+}
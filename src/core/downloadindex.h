@@ -0,0 +1,95 @@
+/*!
+ * \file downloadindex.h
+ * \brief Header for the DownloadIndex class.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/*!
+ * \brief Keeps track of downloaded archives by content hash and by remote file.
+ *
+ * The index is stored as a JSON file inside the download directory. Archives which have been
+ * deleted or whose size has changed since they were added are ignored.
+ */
+class DownloadIndex
+{
+public:
+  /*! \brief Name of the index file inside the download directory. */
+  static inline const std::string INDEX_FILE_NAME = ".download_index.json";
+
+  /*!
+   * \brief Reads the index of the given download directory, if it exists.
+   * \param download_dir The download directory.
+   */
+  DownloadIndex(const std::filesystem::path& download_dir);
+
+  /*!
+   * \brief Searches for an archive which was downloaded from the given remote file.
+   * \param remote_mod_id Remote id of the mod.
+   * \param remote_file_id Remote id of the file.
+   * \return The path to the archive, if one exists.
+   */
+  std::optional<std::filesystem::path> findRemoteFile(long remote_mod_id,
+                                                      long remote_file_id) const;
+  /*!
+   * \brief Searches for an archive with the given content hash.
+   * \param hash XXH3 hash of the archive, as computed by hash_utils::hashFile.
+   * \return The path to the archive, if one exists.
+   */
+  std::optional<std::filesystem::path> findHash(const std::string& hash) const;
+  /*!
+   * \brief Adds the given archive to the index and writes the index. If an archive with the
+   * same hash exists, the remote file is added to that archive instead.
+   * \param archive_path Path to the archive inside the download directory.
+   * \param hash XXH3 hash of the archive, as computed by hash_utils::hashFile.
+   * \param md5 MD5 hash of the archive.
+   * \param remote_mod_id Remote id of the mod, or -1.
+   * \param remote_file_id Remote id of the file, or -1.
+   * \throws std::runtime_error When the index can not be written.
+   */
+  void addArchive(const std::filesystem::path& archive_path,
+                  const std::string& hash,
+                  const std::string& md5,
+                  long remote_mod_id,
+                  long remote_file_id);
+
+private:
+  /*! \brief One downloaded archive. */
+  struct Archive
+  {
+    /*! \brief Name of the archive inside the download directory. */
+    std::string file_name;
+    /*! \brief Size of the archive when it was added. */
+    uint64_t size;
+    /*! \brief XXH3 hash of the archive. */
+    std::string hash;
+    /*! \brief MD5 hash of the archive. */
+    std::string md5;
+    /*! \brief Pairs of remote mod and file ids from which the archive was downloaded. */
+    std::vector<std::pair<long, long>> remote_files;
+  };
+
+  /*! \brief The download directory. */
+  std::filesystem::path download_dir_;
+  /*! \brief All archives in the index. */
+  std::vector<Archive> archives_;
+
+  /*!
+   * \brief Checks if the given archive still exists with the size it had when it was added.
+   * \param archive Archive to check.
+   * \return True if the archive is valid.
+   */
+  bool isValid(const Archive& archive) const;
+  /*! \brief Reads the index file. Invalid files are ignored. */
+  void readIndex();
+  /*! \brief Writes all valid archives to the index file. */
+  void writeIndex() const;
+};
@@ -38,4 +38,9 @@ struct EditApplicationInfo
   std::string app_version;
   /*! \brief Steam app id of the added application. */
   long steam_app_id;
+  /*!
+   * \brief When editing an application, this indicates whether identical files of installed
+   * mods should be stored only once.
+   */
+  bool use_content_store = false;
 };
@@ -0,0 +1,58 @@
+#include "growingfilereader.h"
+#include <algorithm>
+
+namespace sfs = std::filesystem;
+
+
+GrowingFileReader::GrowingFileReader(const sfs::path& path) : path_(path) {}
+
+void GrowingFileReader::setAvailable(uint64_t available_bytes)
+{
+  {
+    std::lock_guard lock(mutex_);
+    if(available_bytes <= available_bytes_)
+      return;
+    // the file may be renamed after writing has finished, so it is opened as soon as possible
+    if(!is_open_)
+    {
+      file_.open(path_, std::ios::binary);
+      is_open_ = file_.is_open();
+    }
+    available_bytes_ = available_bytes;
+  }
+  condition_.notify_one();
+}
+
+void GrowingFileReader::finish(bool success)
+{
+  {
+    std::lock_guard lock(mutex_);
+    is_finished_ = true;
+    has_failed_ = !success;
+  }
+  condition_.notify_one();
+}
+
+int64_t GrowingFileReader::read(char* buffer, size_t size)
+{
+  uint64_t available_bytes;
+  bool is_open;
+  {
+    std::unique_lock lock(mutex_);
+    condition_.wait(lock, [this]() { return is_finished_ || available_bytes_ > position_; });
+    if(has_failed_)
+      return -1;
+    available_bytes = available_bytes_;
+    is_open = is_open_;
+  }
+  if(available_bytes == position_)
+    return 0;
+  if(!is_open)
+    return -1;
+  const uint64_t read_size = std::min<uint64_t>(size, available_bytes - position_);
+  file_.read(buffer, read_size);
+  if(file_.gcount() != read_size)
+    return -1;
+  position_ += read_size;
+  return read_size;
+}
@@ -0,0 +1,72 @@
+/*!
+ * \file growingfilereader.h
+ * \brief Header for the GrowingFileReader class.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+
+/*!
+ * \brief Sequentially reads a file while it is being written by another thread.
+ *
+ * The writer announces how many bytes at the beginning of the file have been written. Reads
+ * block until more data is available or the writer has finished.
+ */
+class GrowingFileReader
+{
+public:
+  /*!
+   * \brief Constructor.
+   * \param path Path to the file. The file is opened once data is first announced.
+   */
+  GrowingFileReader(const std::filesystem::path& path);
+
+  /*!
+   * \brief Announces that the first bytes of the file have been written.
+   * \param available_bytes Number of bytes at the beginning of the file which can be read.
+   * Smaller values than previously announced are ignored.
+   */
+  void setAvailable(uint64_t available_bytes);
+  /*!
+   * \brief Announces that no more data will be written.
+   * \param success If false: All further reads fail.
+   */
+  void finish(bool success);
+  /*!
+   * \brief Reads the next part of the file. Blocks until data is available.
+   * \param buffer Target buffer.
+   * \param size Size of the target buffer.
+   * \return The number of bytes read, 0 at the end of the file or -1 if the writer failed or
+   * the file could not be read.
+   */
+  int64_t read(char* buffer, size_t size);
+
+private:
+  /*! \brief Path to the file. */
+  std::filesystem::path path_;
+  /*!
+   * \brief Used for reading. Opened by the writing thread while holding mutex_, afterwards
+   * only accessed by the reading thread.
+   */
+  std::ifstream file_;
+  /*! \brief If true: file_ has been opened and is no longer accessed by the writing thread. */
+  bool is_open_ = false;
+  /*! \brief Number of bytes which can be read. */
+  uint64_t available_bytes_ = 0;
+  /*! \brief Number of bytes read so far. Only accessed by the reading thread. */
+  uint64_t position_ = 0;
+  /*! \brief If true: No more data will be written. */
+  bool is_finished_ = false;
+  /*! \brief If true: The writer failed. */
+  bool has_failed_ = false;
+  /*! \brief Guards all members except file_ and position_. */
+  std::mutex mutex_;
+  /*! \brief Notifies the reader about new data. */
+  std::condition_variable condition_;
+};
@@ -0,0 +1,118 @@
+#include "hashutils.h"
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <openssl/evp.h>
+#include <xxhash.h>
+
+namespace sfs = std::filesystem;
+
+
+namespace hash_utils
+{
+std::string hashFile(const sfs::path& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if(!file.is_open())
+    throw std::runtime_error("Could not read \"" + path.string() + "\".");
+
+  std::unique_ptr<XXH3_state_t, decltype(&XXH3_freeState)> state(XXH3_createState(),
+                                                                   XXH3_freeState);
+  if(!state || XXH3_128bits_reset(state.get()) == XXH_ERROR)
+    throw std::runtime_error("Failed to initialize hash state.");
+
+  constexpr std::streamsize buffer_size = 1 << 20;
+  auto buffer = std::make_unique<char[]>(buffer_size);
+  while(file)
+  {
+    file.read(buffer.get(), buffer_size);
+    XXH3_128bits_update(state.get(), buffer.get(), file.gcount());
+  }
+  if(file.bad())
+    throw std::runtime_error("Could not read \"" + path.string() + "\".");
+
+  const XXH128_hash_t hash = XXH3_128bits_digest(state.get());
+  return std::format("{:016x}{:016x}", hash.high64, hash.low64);
+}
+
+std::string hashFileSample(const sfs::path& path, std::size_t sample_size)
+{
+  std::ifstream file(path, std::ios::binary);
+  if(!file.is_open())
+    throw std::runtime_error("Could not read \"" + path.string() + "\".");
+  const uint64_t size = sfs::file_size(path);
+
+  std::unique_ptr<XXH3_state_t, decltype(&XXH3_freeState)> state(XXH3_createState(),
+                                                                   XXH3_freeState);
+  if(!state || XXH3_128bits_reset(state.get()) == XXH_ERROR)
+    throw std::runtime_error("Failed to initialize hash state.");
+  XXH3_128bits_update(state.get(), &size, sizeof(size));
+
+  auto buffer = std::make_unique<char[]>(sample_size);
+  file.read(buffer.get(), sample_size);
+  XXH3_128bits_update(state.get(), buffer.get(), file.gcount());
+  if(size > sample_size)
+  {
+    file.clear();
+    file.seekg(size - std::min<uint64_t>(sample_size, size - sample_size));
+    file.read(buffer.get(), sample_size);
+    XXH3_128bits_update(state.get(), buffer.get(), file.gcount());
+  }
+  if(file.bad())
+    throw std::runtime_error("Could not read \"" + path.string() + "\".");
+
+  const XXH128_hash_t hash = XXH3_128bits_digest(state.get());
+  return std::format("{:016x}{:016x}", hash.high64, hash.low64);
+}
+
+std::string hashString(const std::string& value)
+{
+  return std::format("{:016x}", XXH3_64bits(value.data(), value.size()));
+}
+
+StreamHash::StreamHash() : xxh3_state_(XXH3_createState()), md5_state_(EVP_MD_CTX_new())
+{
+  if(!xxh3_state_ || !md5_state_ || XXH3_128bits_reset(xxh3_state_) == XXH_ERROR ||
+     EVP_DigestInit_ex(md5_state_, EVP_md5(), nullptr) != 1)
+  {
+    XXH3_freeState(xxh3_state_);
+    EVP_MD_CTX_free(md5_state_);
+    throw std::runtime_error("Failed to initialize hash state.");
+  }
+}
+
+StreamHash::~StreamHash()
+{
+  XXH3_freeState(xxh3_state_);
+  EVP_MD_CTX_free(md5_state_);
+}
+
+void StreamHash::update(const char* data, std::size_t size)
+{
+  XXH3_128bits_update(xxh3_state_, data, size);
+  EVP_DigestUpdate(md5_state_, data, size);
+}
+
+std::string StreamHash::xxh3() const
+{
+  const XXH128_hash_t hash = XXH3_128bits_digest(xxh3_state_);
+  return std::format("{:016x}{:016x}", hash.high64, hash.low64);
+}
+
+std::string StreamHash::md5() const
+{
+  // finalizing consumes the state, so a copy is finalized instead
+  std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(),
+                                                                  EVP_MD_CTX_free);
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int size = 0;
+  if(!context || EVP_MD_CTX_copy_ex(context.get(), md5_state_) != 1 ||
+     EVP_DigestFinal_ex(context.get(), digest, &size) != 1)
+    throw std::runtime_error("Failed to compute MD5 hash.");
+  std::string hash;
+  for(unsigned int i = 0; i < size; i++)
+    hash += std::format("{:02x}", digest[i]);
+  return hash;
+}
+}
@@ -0,0 +1,83 @@
+/*!
+ * \file hashutils.h
+ * \brief Header for the hash_utils namespace.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+struct XXH3_state_s;
+struct evp_md_ctx_st;
+
+
+/*!
+ * \brief Contains utility functions for computing content hashes of files.
+ */
+namespace hash_utils
+{
+/*!
+ * \brief Computes the 128 bit XXH3 hash of the given file.
+ * \param path Path to the file to be hashed.
+ * \return The hash as a hexadecimal string.
+ * \throws std::runtime_error When the file cannot be read.
+ */
+std::string hashFile(const std::filesystem::path& path);
+/*!
+ * \brief Computes the 128 bit XXH3 hash of the size and the first and last bytes of the
+ * given file. This identifies large files without reading them completely.
+ * \param path Path to the file to be hashed.
+ * \param sample_size Number of bytes hashed at the start and at the end of the file.
+ * \return The hash as a hexadecimal string.
+ * \throws std::runtime_error When the file cannot be read.
+ */
+std::string hashFileSample(const std::filesystem::path& path, std::size_t sample_size = 1 << 16);
+/*!
+ * \brief Computes the 64 bit XXH3 hash of the given string.
+ * \param value String to be hashed.
+ * \return The hash as a hexadecimal string.
+ */
+std::string hashString(const std::string& value);
+
+/*!
+ * \brief Incrementally computes the 128 bit XXH3 hash used by \ref hashFile and the MD5 hash
+ * of data received in multiple parts.
+ */
+class StreamHash
+{
+public:
+  /*!
+   * \brief Initializes both hash states.
+   * \throws std::runtime_error When a hash state cannot be initialized.
+   */
+  StreamHash();
+  /*! \brief Frees both hash states. */
+  ~StreamHash();
+  StreamHash(const StreamHash&) = delete;
+  StreamHash& operator=(const StreamHash&) = delete;
+
+  /*!
+   * \brief Adds the given data to both hashes.
+   * \param data Data to add.
+   * \param size Size of the data.
+   */
+  void update(const char* data, std::size_t size);
+  /*!
+   * \brief Computes the XXH3 hash of all data added so far.
+   * \return The hash as a hexadecimal string.
+   */
+  std::string xxh3() const;
+  /*!
+   * \brief Computes the MD5 hash of all data added so far.
+   * \return The hash as a hexadecimal string.
+   */
+  std::string md5() const;
+
+private:
+  /*! \brief XXH3 state. */
+  XXH3_state_s* xxh3_state_;
+  /*! \brief MD5 state. */
+  evp_md_ctx_st* md5_state_;
+};
+}
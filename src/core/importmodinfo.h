@@ -69,6 +69,16 @@ struct ImportModInfo
   std::filesystem::path target_path;
   /*! \brief Current location of the mod on disk. */
   std::filesystem::path current_path;
+  /*!
+   * \brief If true: current_path only contains the mods fomod installer and empty placeholders
+   * for all other files. The mod has to be installed from local_source.
+   */
+  bool is_fomod_preview = false;
+  /*!
+   * \brief If not empty: Directory to which the archive has already been extracted while it
+   * was being downloaded.
+   */
+  std::filesystem::path streamed_extraction_path;
   /*! \brief Time at which this object was added to the queue. Used for sorting. */
   std::chrono::time_point<std::chrono::high_resolution_clock> queue_time =
     std::chrono::high_resolution_clock::now();
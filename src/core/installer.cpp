@@ -1,21 +1,31 @@
 #include "installer.h"
+#include "archiveindex.h"
 #include "compressionerror.h"
+#include "hashutils.h"
 #include "pathutils.h"
+#include "threadpool.h"
 #include <archive.h>
 #include <archive_entry.h>
+#include <algorithm>
+#include <cerrno>
 #include <filesystem>
+#include <fstream>
+#include <mutex>
 #include <ranges>
 #include <regex>
+#include <unordered_map>
 #define _UNIX
 #include <dll.hpp>
 
 namespace sfs = std::filesystem;
 namespace pu = path_utils;
+namespace str = std::ranges;
 
 
-void Installer::extract(const sfs::path& source_path,
-                        const sfs::path& dest_path,
-                        std::optional<ProgressNode*> progress_node)
+unsigned long Installer::extract(const sfs::path& source_path,
+                                 const sfs::path& dest_path,
+                                 std::optional<ProgressNode*> progress_node,
+                                 const sfs::path& index_cache_dir)
 {
   log(Log::LOG_DEBUG, "Beginning extraction");
 
@@ -26,36 +36,10 @@ void Installer::extract(const sfs::path& source_path,
       sfs::rename(source_path, dest_path);
     else
       sfs::copy(source_path, dest_path, sfs::copy_options::recursive);
-    return;
+    return setExtractedPermissions(dest_path);
   }
 
-  try
-  {
-    extractWithProgress(source_path, dest_path, progress_node);
-  }
-  catch(CompressionError& error)
-  {
-    std::string extension = source_path.extension().string();
-    std::transform(extension.begin(),
-                   extension.end(),
-                   extension.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
-    if(extension == ".rar")
-    {
-      sfs::remove_all(dest_path);
-      extractRarArchive(source_path, dest_path);
-    }
-    else
-      throw error;
-  }
-  for(const auto& dir_entry : sfs::recursive_directory_iterator(dest_path))
-  {
-    auto permissions = sfs::perms::owner_read | sfs::perms::owner_write | sfs::perms::group_read |
-                       sfs::perms::group_write | sfs::perms::others_read;
-    if(dir_entry.is_directory())
-      permissions |= sfs::perms::owner_exec | sfs::perms::group_exec | sfs::perms::others_exec;
-    sfs::permissions(dir_entry.path(), permissions);
-  }
+  return extractArchive(source_path, dest_path, progress_node, preserve_case, 0, index_cache_dir);
 }
 
 unsigned long Installer::install(const sfs::path& source,
@@ -63,22 +47,62 @@ unsigned long Installer::install(const sfs::path& source,
                                  int options,
                                  const std::string& type,
                                  int root_level,
-                                 const std::vector<std::pair<sfs::path, sfs::path>> fomod_files)
+                                 const std::vector<std::pair<sfs::path, sfs::path>> fomod_files,
+                                 const sfs::path& index_cache_dir)
 {
   log(Log::LOG_DEBUG, "Beginning mod installation");
 
   if(type != SIMPLEINSTALLER && type != FOMODINSTALLER)
     throw std::runtime_error("Error: Unknown Installer type \"" + type + "\"!");
+  if(type == SIMPLEINSTALLER && !sfs::is_directory(source))
+  {
+    // all options are applied to the entry paths, which avoids a temporary directory
+    try
+    {
+      return extractArchive(source, destination, {}, options, root_level, index_cache_dir);
+    }
+    catch(...)
+    {
+      sfs::remove_all(destination);
+      throw;
+    }
+  }
+  if(type == FOMODINSTALLER && !fomod_files.empty() && !sfs::is_directory(source))
+  {
+    // avoids extracting unused options, which can make up most of the archive
+    try
+    {
+      const auto size =
+        extractFomodFiles(source, destination, root_level, fomod_files, index_cache_dir);
+      if(size)
+        return *size;
+    }
+    catch(CompressionError& error)
+    {
+      sfs::remove_all(destination);
+      if(!isRarArchive(source))
+        throw error;
+    }
+    catch(...)
+    {
+      sfs::remove_all(destination);
+      throw;
+    }
+  }
+
   unsigned tmp_id = 0;
   sfs::path tmp_dir;
+  // the directory is claimed by creating it, since other installations may run concurrently
   do
     tmp_dir = destination.parent_path() / (EXTRACT_TMP_DIR + std::to_string(tmp_id));
-  while(pu::exists(tmp_dir) && tmp_id++ < std::numeric_limits<unsigned>::max());
+  while((pu::exists(tmp_dir) || !sfs::create_directory(tmp_dir)) &&
+        tmp_id++ < std::numeric_limits<unsigned>::max());
   if(tmp_id == std::numeric_limits<unsigned>::max())
     throw std::runtime_error("Could not create directory!");
+  unsigned long extracted_size = 0;
   try
   {
-    extract(source, tmp_dir, {});
+    extracted_size = extract(source, tmp_dir, {}, index_cache_dir);
   }
   catch(CompressionError& error)
   {
@@ -197,6 +221,9 @@ unsigned long Installer::install(const sfs::path& source,
       throw error;
     }
   }
+  // files are only removed or merged when using fomod, root levels or a single directory
+  if(type == SIMPLEINSTALLER && root_level == 0 && !(options & single_directory))
+    return extracted_size;
   unsigned long size = 0;
   for(const auto& dir_entry : sfs::recursive_directory_iterator(destination))
     if(dir_entry.is_regular_file())
@@ -204,12 +231,109 @@ unsigned long Installer::install(const sfs::path& source,
   return size;
 }
 
+bool Installer::extractFomodPreview(const sfs::path& source_path,
+                                    const sfs::path& dest_path,
+                                    std::optional<ProgressNode*> progress_node,
+                                    const sfs::path& index_cache_dir)
+{
+  if(sfs::is_directory(source_path))
+    return false;
+  std::string archive_extension = source_path.extension().string();
+  str::transform(archive_extension,
+                 archive_extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if(str::find(LISTABLE_EXTENSIONS, archive_extension) == LISTABLE_EXTENSIONS.end() &&
+     !ArchiveIndex::getCached(source_path, index_cache_dir))
+    return false;
+  const auto [_, prefix, type] = detectInstallerSignature(source_path, index_cache_dir);
+  if(type != FOMODINSTALLER)
+    return false;
+  log(Log::LOG_DEBUG, "Extracting fomod installer");
+
+  // entry paths are normalized, so the prefix is compared by its normalized components
+  sfs::path prefix_path = sfs::path(prefix).lexically_normal();
+  if(!prefix_path.has_filename())
+    prefix_path = prefix_path.parent_path();
+  if(prefix_path == ".")
+    prefix_path.clear();
+  const int prefix_length = std::distance(prefix_path.begin(), prefix_path.end());
+  auto is_preview_file = [&prefix_path, prefix_length](const sfs::path& path)
+  {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(),
+                   extension.end(),
+                   extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if(str::find(PREVIEW_IMAGE_EXTENSIONS, extension) != PREVIEW_IMAGE_EXTENSIONS.end())
+      return true;
+    const auto [head, tail] = pu::removePathComponents(path, prefix_length);
+    return head == prefix_path && !tail.empty() &&
+           pu::toLowerCase(*tail.begin()) == "fomod";
+  };
+
+  std::unique_ptr<struct archive, decltype(&archive_read_free)> source(archive_read_new(),
+                                                                       archive_read_free);
+  std::unique_ptr<struct archive, decltype(&archive_write_free)> dest(archive_write_disk_new(),
+                                                                     archive_write_free);
+  archive_read_support_format_all(source.get());
+  archive_read_support_filter_all(source.get());
+  archive_write_disk_set_options(dest.get(), ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
+  archive_write_disk_set_standard_lookup(dest.get());
+  if(archive_read_open_filename(source.get(), source_path.c_str(), 10240) != ARCHIVE_OK)
+    throw CompressionError("Could not open archive file.");
+  sfs::create_directories(dest_path);
+  // entries are written to absolute paths, since extractions may run concurrently
+  const sfs::path absolute_dest_path = sfs::absolute(dest_path);
+  const uint64_t total_steps = std::max<uint64_t>(sfs::file_size(source_path), 1);
+  if(progress_node)
+    (*progress_node)->setTotalSteps(total_steps);
+
+  EntryPathMapper path_mapper;
+  struct archive_entry* entry;
+  while(true)
+  {
+    const int return_code = archive_read_next_header(source.get(), &entry);
+    if(return_code == ARCHIVE_EOF)
+      break;
+    if(return_code < ARCHIVE_OK || !archive_entry_pathname(entry))
+      throwCompressionError(source.get());
+    const auto file_type = archive_entry_filetype(entry);
+    const sfs::path path = path_mapper.map(archive_entry_pathname(entry), file_type == AE_IFDIR);
+    if(path.empty())
+      continue;
+    const sfs::path dest_file = absolute_dest_path / path;
+    if(file_type == AE_IFDIR)
+      sfs::create_directories(dest_file);
+    else if(file_type != AE_IFREG || archive_entry_hardlink(entry) || !is_preview_file(path))
+    {
+      sfs::create_directories(dest_file.parent_path());
+      std::ofstream placeholder(dest_file);
+    }
+    else
+    {
+      archive_entry_set_pathname(entry, dest_file.c_str());
+      archive_entry_set_perm(entry, 0664);
+      if(archive_write_header(dest.get(), entry) < ARCHIVE_OK)
+        throwCompressionError(dest.get());
+      copyArchive(source.get(), dest.get());
+      if(archive_write_finish_entry(dest.get()) < ARCHIVE_OK)
+        throwCompressionError(dest.get());
+    }
+  }
+  archive_write_close(dest.get());
+  if(progress_node)
+    (*progress_node)->advance(total_steps);
+  return true;
+}
+
 void Installer::uninstall(const sfs::path& mod_path, const std::string& type)
 {
   sfs::remove_all(mod_path);
 }
 
-std::vector<std::pair<sfs::path, bool>> Installer::getArchiveFileNames(const sfs::path& path)
+std::vector<std::pair<sfs::path, bool>> Installer::getArchiveFileNames(
+  const sfs::path& path,
+  const sfs::path& index_cache_dir)
 {
 
   std::vector<std::pair<sfs::path, bool>> file_names;
@@ -219,22 +343,15 @@ std::vector<std::pair<sfs::path, bool>> Installer::getArchiveFileNames(const sfs
       file_names.emplace_back(pu::getRelativePath(dir_entry.path(), path), sfs::is_directory(path));
     return file_names;
   }
-  struct archive* source;
-  struct archive_entry* entry;
-  source = archive_read_new();
-  archive_read_support_filter_all(source);
-  archive_read_support_format_all(source);
-  if(archive_read_open_filename(source, path.string().c_str(), 10240) != ARCHIVE_OK)
-    throw CompressionError("Could not open archive file.");
-  while(archive_read_next_header(source, &entry) == ARCHIVE_OK)
-    file_names.emplace_back(archive_entry_pathname(entry), archive_entry_filetype(entry) == AE_IFDIR);
-  if(archive_read_free(source) != ARCHIVE_OK)
-    throw CompressionError("Parsing of archive failed.");
+  const auto index = ArchiveIndex::get(path, index_cache_dir);
+  for(const auto& entry : index->entries())
+    file_names.emplace_back(entry.path, entry.type == AE_IFDIR);
   return file_names;
 }
 
 std::tuple<int, std::string, std::string> Installer::detectInstallerSignature(
-  const sfs::path& source)
+  const sfs::path& source,
+  const sfs::path& index_cache_dir)
 {
   const auto path = (sfs::path("fomod") / "ModuleConfig.xml");
   auto str_equals = [](const std::string& a, const std::string& b)
@@ -245,7 +362,7 @@ std::tuple<int, std::string, std::string> Installer::detectInstallerSignature(
                       b.end(),
                       [](char c1, char c2) { return tolower(c1) == tolower(c2); });
   };
-  const auto files = getArchiveFileNames(source);
+  const auto files = getArchiveFileNames(source, index_cache_dir);
   int max_length = 0;
   for(const auto& [file, _] : files)
     max_length = std::max(max_length, pu::getPathLength(file));
@@ -277,6 +394,97 @@ void Installer::cleanupFailedInstallation(const sfs::path& staging_dir, int mod_
   }
 }
 
+std::pair<std::set<sfs::path>, bool> Installer::applyModUpdate(const sfs::path& update_dir,
+                                                               const sfs::path& mod_dir)
+{
+  std::set<sfs::path> changed_files;
+  bool file_list_changed = false;
+  std::set<sfs::path> update_paths;
+  std::vector<sfs::path> update_dirs;
+  std::vector<sfs::path> unchanged_candidates;
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(update_dir))
+  {
+    const sfs::path relative_path = pu::getRelativePath(dir_entry.path(), update_dir);
+    update_paths.insert(relative_path);
+    const sfs::path old_path = mod_dir / relative_path;
+    if(dir_entry.is_directory())
+      update_dirs.push_back(relative_path);
+    else if(dir_entry.is_regular_file() && !dir_entry.is_symlink() &&
+            sfs::is_regular_file(sfs::symlink_status(old_path)) &&
+            sfs::file_size(old_path) == dir_entry.file_size())
+      unchanged_candidates.push_back(relative_path);
+    else
+    {
+      if(!sfs::exists(sfs::symlink_status(old_path)) || sfs::is_directory(old_path))
+        file_list_changed = true;
+      changed_files.insert(relative_path);
+    }
+  }
+
+  // files of equal size only need to be replaced if their contents differ
+  {
+    ThreadPool pool;
+    std::vector<std::future<bool>> results;
+    for(const auto& path : unchanged_candidates)
+      results.push_back(pool.submit(
+        [&update_dir, &mod_dir, &path]()
+        {
+          return hash_utils::hashFile(update_dir / path) == hash_utils::hashFile(mod_dir / path);
+        }));
+    std::exception_ptr error;
+    for(int i = 0; i < results.size(); i++)
+    {
+      try
+      {
+        if(!results[i].get())
+          changed_files.insert(unchanged_candidates[i]);
+      }
+      catch(...)
+      {
+        if(!error)
+          error = std::current_exception();
+      }
+    }
+    if(error)
+      std::rethrow_exception(error);
+  }
+
+  std::vector<sfs::path> removed_paths;
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(mod_dir))
+  {
+    const sfs::path relative_path = pu::getRelativePath(dir_entry.path(), mod_dir);
+    if(update_paths.contains(relative_path))
+      continue;
+    removed_paths.push_back(relative_path);
+    if(!dir_entry.is_directory())
+    {
+      changed_files.insert(relative_path);
+      file_list_changed = true;
+    }
+  }
+  for(const auto& path : removed_paths)
+    sfs::remove_all(mod_dir / path);
+
+  for(const auto& path : update_dirs)
+  {
+    const auto old_status = sfs::symlink_status(mod_dir / path);
+    if(sfs::exists(old_status) && !sfs::is_directory(old_status))
+      sfs::remove(mod_dir / path);
+    sfs::create_directories(mod_dir / path);
+  }
+  for(const auto& path : changed_files)
+  {
+    if(!update_paths.contains(path))
+      continue;
+    const sfs::path old_path = mod_dir / path;
+    if(sfs::is_directory(sfs::symlink_status(old_path)))
+      sfs::remove_all(old_path);
+    sfs::rename(update_dir / path, old_path);
+  }
+  sfs::remove_all(update_dir);
+  return { changed_files, file_list_changed };
+}
+
 void Installer::setIsAFlatpak(bool is_a_flatpak)
 {
   is_a_flatpak_ = is_a_flatpak;
@@ -311,145 +519,691 @@ void Installer::copyArchive(struct archive* source, struct archive* dest)
   }
 }
 
-void Installer::extractWithProgress(const sfs::path& source_path,
-                                    const sfs::path& dest_path,
-                                    std::optional<ProgressNode*> progress_node)
+unsigned long Installer::extractArchive(const sfs::path& source_path,
+                                        const sfs::path& dest_path,
+                                        std::optional<ProgressNode*> progress_node,
+                                        int options,
+                                        int root_level,
+                                        const sfs::path& index_cache_dir)
 {
-  log(Log::LOG_DEBUG, "Beginning extraction with progress");
-
-  constexpr int buffer_size = 10240;
-  struct archive* source;
-  struct archive* dest;
-  struct archive_entry* entry;
-  int return_code;
-  const char* file_name = source_path.c_str();
-  int flags = ARCHIVE_EXTRACT_TIME;
-  sfs::path working_dir = "/tmp";
   try
   {
-    working_dir = sfs::current_path();
+    const auto entries =
+      readRandomAccessEntries(source_path, options, root_level, index_cache_dir);
+    if(entries)
+      return extractInParallel(source_path, dest_path, *entries, progress_node);
+    return extractWithProgress(source_path, dest_path, progress_node, options, root_level);
   }
-  catch(std::filesystem::filesystem_error& error)
-  {}
-  if(!sfs::exists(dest_path))
-    sfs::create_directories(dest_path);
-  sfs::current_path(dest_path);
-  source = archive_read_new();
-  archive_read_support_format_all(source);
-  archive_read_support_filter_all(source);
-  dest = archive_write_disk_new();
-  archive_write_disk_set_options(dest, flags);
-  archive_write_disk_set_standard_lookup(dest);
-  if(archive_read_open_filename(source, file_name, buffer_size))
-  {
-    sfs::current_path(working_dir);
-    throw CompressionError("Could not open archive file.");
+  catch(CompressionError& error)
+  {
+    if(!isRarArchive(source_path))
+      throw error;
   }
-  uint64_t total_size = 0;
+  sfs::remove_all(dest_path);
+  extractRarArchive(source_path, dest_path, options, root_level);
+  return setExtractedPermissions(dest_path);
+}
+
+unsigned long Installer::extractWithProgress(const sfs::path& source_path,
+                                             const sfs::path& dest_path,
+                                             std::optional<ProgressNode*> progress_node,
+                                             int options,
+                                             int root_level)
+{
+  log(Log::LOG_DEBUG, "Beginning extraction with progress");
+
+  std::unique_ptr<struct archive, decltype(&archive_read_free)> source(archive_read_new(),
+                                                                       archive_read_free);
+  archive_read_support_format_all(source.get());
+  archive_read_support_filter_all(source.get());
+  if(archive_read_open_filename(source.get(), source_path.c_str(), 10240) != ARCHIVE_OK)
+    throw CompressionError("Could not open archive file.");
+  // progress is measured in bytes read from the archive file, which avoids a separate pass
+  // over all headers to compute the total uncompressed size
+  const uint64_t total_steps = std::max<uint64_t>(sfs::file_size(source_path), 1);
+  if(progress_node)
+    (*progress_node)->setTotalSteps(total_steps);
+  uint64_t bytes_read = 0;
+  auto update_progress = [&progress_node, &bytes_read, total_steps, &source]()
+  {
+    if(!progress_node)
+      return;
+    const int64_t new_bytes_read = archive_filter_bytes(source.get(), -1);
+    if(new_bytes_read > 0 && new_bytes_read > bytes_read && new_bytes_read <= total_steps)
+    {
+      (*progress_node)->advance(new_bytes_read - bytes_read);
+      bytes_read = new_bytes_read;
+    }
+  };
+
+  const unsigned long total_size =
+    extractFromArchive(source.get(), dest_path, options, root_level, update_progress);
+  if(progress_node)
+    (*progress_node)->advance(total_steps - bytes_read);
+  archive_read_close(source.get());
+  return total_size;
+}
+
+unsigned long Installer::extractStream(const std::function<int64_t(char*, size_t)>& read,
+                                       const sfs::path& dest_path)
+{
+  log(Log::LOG_DEBUG, "Beginning extraction from stream");
+
+  struct StreamData
+  {
+    const std::function<int64_t(char*, size_t)>& read;
+    std::vector<char> buffer;
+  } stream_data{ read, std::vector<char>(1 << 16) };
+  auto read_callback = [](struct archive* source, void* client_data, const void** buffer)
+  {
+    auto data = static_cast<StreamData*>(client_data);
+    *buffer = data->buffer.data();
+    const int64_t size = data->read(data->buffer.data(), data->buffer.size());
+    if(size < 0)
+    {
+      archive_set_error(source, EIO, "Could not read from stream");
+      return static_cast<la_ssize_t>(ARCHIVE_FATAL);
+    }
+    return static_cast<la_ssize_t>(size);
+  };
+
+  std::unique_ptr<struct archive, decltype(&archive_read_free)> source(archive_read_new(),
+                                                                       archive_read_free);
+  archive_read_support_format_all(source.get());
+  archive_read_support_filter_all(source.get());
+  if(archive_read_open(source.get(), &stream_data, nullptr, read_callback, nullptr) != ARCHIVE_OK)
+    throw CompressionError("Could not open archive stream.");
+  const unsigned long total_size =
+    extractFromArchive(source.get(), dest_path, preserve_case, 0, []() {});
+  archive_read_close(source.get());
+  return total_size;
+}
+
+bool Installer::isStreamable(const sfs::path& path)
+{
+  std::string extension = path.extension().string();
+  str::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  return str::find(STREAMABLE_EXTENSIONS, extension) != STREAMABLE_EXTENSIONS.end();
+}
+
+unsigned long Installer::extractFromArchive(struct archive* source,
+                                            const sfs::path& dest_path,
+                                            int options,
+                                            int root_level,
+                                            const std::function<void()>& on_data)
+{
+  std::unique_ptr<struct archive, decltype(&archive_write_free)> dest(archive_write_disk_new(),
+                                                                     archive_write_free);
+  archive_write_disk_set_options(dest.get(), ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
+  archive_write_disk_set_standard_lookup(dest.get());
+  sfs::create_directories(dest_path);
+  // entries are written to absolute paths, since extractions may run concurrently
+  const sfs::path absolute_dest_path = sfs::absolute(dest_path);
+
+  EntryPathMapper path_mapper(options, root_level);
+  std::unordered_map<std::string, uint64_t> file_sizes;
+  struct archive_entry* entry;
   while(true)
   {
-    return_code = archive_read_next_header(source, &entry);
+    const int return_code = archive_read_next_header(source, &entry);
     if(return_code == ARCHIVE_EOF)
       break;
     if(return_code < ARCHIVE_OK)
-    {
-      sfs::current_path(working_dir);
       throwCompressionError(source);
+    const char* entry_path = archive_entry_pathname(entry);
+    if(!entry_path)
+      throwCompressionError(source);
+    const auto file_type = archive_entry_filetype(entry);
+    const sfs::path path = path_mapper.map(entry_path, file_type == AE_IFDIR);
+    sfs::path hardlink_path;
+    if(archive_entry_hardlink(entry))
+      hardlink_path = path_mapper.map(archive_entry_hardlink(entry), false);
+    // skipped entries: the data is skipped when reading the next header
+    if(path.empty() || (archive_entry_hardlink(entry) && hardlink_path.empty()))
+    {
+      on_data();
+      continue;
+    }
+    archive_entry_set_pathname(entry, (absolute_dest_path / path).c_str());
+    if(file_type == AE_IFDIR)
+      archive_entry_set_perm(entry, 0775);
+    else
+      archive_entry_set_perm(entry, 0664);
+    if(archive_entry_hardlink(entry))
+    {
+      archive_entry_set_hardlink(entry, (absolute_dest_path / hardlink_path).c_str());
+      auto iter = file_sizes.find(hardlink_path.string());
+      file_sizes[path.string()] = iter == file_sizes.end() ? 0 : iter->second;
     }
-    total_size += archive_entry_size(entry);
+    else if(file_type == AE_IFREG)
+      file_sizes[path.string()] = archive_entry_size(entry);
+    if(archive_write_header(dest.get(), entry) < ARCHIVE_OK)
+      throwCompressionError(dest.get());
+    const void* buffer;
+    size_t size;
+    int64_t offset;
+    while(true)
+    {
+      const int data_return_code = archive_read_data_block(source, &buffer, &size, &offset);
+      if(data_return_code == ARCHIVE_EOF)
+        break;
+      if(data_return_code < ARCHIVE_OK)
+        throwCompressionError(source);
+      if(archive_write_data_block(dest.get(), buffer, size, offset) != ARCHIVE_OK)
+        throwCompressionError(dest.get());
+      on_data();
+    }
+    if(archive_write_finish_entry(dest.get()) < ARCHIVE_OK)
+      throwCompressionError(dest.get());
   }
-  if(progress_node)
-    (*progress_node)->setTotalSteps(total_size);
-  archive_read_close(source);
-  archive_read_free(source);
-  source = archive_read_new();
-  archive_read_support_format_all(source);
-  archive_read_support_filter_all(source);
-  if(archive_read_open_filename(source, file_name, buffer_size))
-  {
-    sfs::current_path(working_dir);
-    throw CompressionError("Could not open archive file.");
+  archive_write_close(dest.get());
+  unsigned long total_size = 0;
+  for(const auto& [path, size] : file_sizes)
+    total_size += size;
+  return total_size;
+}
+
+std::optional<std::vector<Installer::ArchiveEntryInfo>> Installer::readRandomAccessEntries(
+  const sfs::path& source_path,
+  int options,
+  int root_level,
+  const sfs::path& index_cache_dir)
+{
+  // check the format first, indexing compressed tar archives requires decompressing them
+  {
+    std::unique_ptr<struct archive, decltype(&archive_read_free)> source(archive_read_new(),
+                                                                         archive_read_free);
+    archive_read_support_format_all(source.get());
+    archive_read_support_filter_all(source.get());
+    struct archive_entry* entry;
+    // errors are reported by the serial extraction
+    if(archive_read_open_filename(source.get(), source_path.c_str(), 10240) != ARCHIVE_OK ||
+       archive_read_next_header(source.get(), &entry) != ARCHIVE_OK)
+      return {};
+    // skipping entries only avoids decompression when the reader can seek past them
+    const int format = archive_format(source.get()) & ARCHIVE_FORMAT_BASE_MASK;
+    if(format != ARCHIVE_FORMAT_ZIP &&
+       !(format == ARCHIVE_FORMAT_TAR &&
+         archive_filter_code(source.get(), 0) == ARCHIVE_FILTER_NONE))
+      return {};
+  }
+  std::shared_ptr<const ArchiveIndex> index;
+  try
+  {
+    index = ArchiveIndex::get(source_path, index_cache_dir);
+  }
+  catch(CompressionError& error)
+  {
+    return {};
   }
 
-  while(true)
+  EntryPathMapper path_mapper(options, root_level);
+  std::vector<ArchiveEntryInfo> entries;
+  std::unordered_map<std::string, int> last_entries;
+  for(int i = 0; i < index->entries().size(); i++)
   {
-    return_code = archive_read_next_header(source, &entry);
-    if(return_code == ARCHIVE_EOF)
-      break;
-    if(return_code < ARCHIVE_OK)
+    const auto& entry = index->entries()[i];
+    if(entry.is_encrypted)
+      return {};
+    ArchiveEntryInfo info{ i,
+                           path_mapper.map(entry.path, entry.type == AE_IFDIR),
+                           {},
+                           entry.type == AE_IFREG && entry.hardlink.empty(),
+                           entry.size };
+    if(!entry.hardlink.empty())
     {
-      sfs::current_path(working_dir);
-      throwCompressionError(source);
+      info.hardlink_path = path_mapper.map(entry.hardlink, false);
+      if(info.hardlink_path.empty())
+        continue;
     }
-    archive_entry_set_pathname(entry, archive_entry_pathname(entry));
-    if(archive_write_header(dest, entry) < ARCHIVE_OK)
+    if(info.path.empty())
+      continue;
+    last_entries[info.path.string()] = entries.size();
+    entries.push_back(std::move(info));
+  }
+  if(str::count_if(entries, [](const auto& info) { return info.is_regular_file; }) < 2)
+    return {};
+
+  // entries overwrite previous entries with the same path, which is order dependent
+  std::vector<ArchiveEntryInfo> unique_entries;
+  unique_entries.reserve(last_entries.size());
+  for(int i = 0; i < entries.size(); i++)
+  {
+    if(last_entries[entries[i].path.string()] == i)
+      unique_entries.push_back(std::move(entries[i]));
+  }
+  return unique_entries;
+}
+
+unsigned long Installer::extractInParallel(const sfs::path& source_path,
+                                           const sfs::path& dest_path,
+                                           const std::vector<ArchiveEntryInfo>& entries,
+                                           std::optional<ProgressNode*> progress_node)
+{
+  log(Log::LOG_DEBUG, "Beginning parallel extraction");
+
+  std::vector<int> file_ids;
+  std::vector<int> other_ids;
+  std::unordered_map<std::string, uint64_t> file_sizes;
+  uint64_t total_steps = 0;
+  for(int i = 0; i < entries.size(); i++)
+  {
+    if(entries[i].is_regular_file)
     {
-      sfs::current_path(working_dir);
-      throwCompressionError(dest);
+      file_ids.push_back(i);
+      file_sizes[entries[i].path.string()] = entries[i].size;
+      total_steps += entries[i].size;
+    }
+    else
+      other_ids.push_back(i);
+  }
+  total_steps = std::max<uint64_t>(total_steps, 1);
+  if(progress_node)
+    (*progress_node)->setTotalSteps(total_steps);
+  std::mutex progress_mutex;
+  uint64_t bytes_written = 0;
+  auto on_data_written = [&progress_node, &progress_mutex, &bytes_written](uint64_t size)
+  {
+    if(!progress_node)
+      return;
+    std::scoped_lock lock(progress_mutex);
+    (*progress_node)->advance(size);
+    bytes_written += size;
+  };
+
+  sfs::create_directories(dest_path);
+  {
+    ThreadPool pool;
+    const int num_workers = std::min<size_t>(pool.numThreads(), file_ids.size());
+    // assign the largest remaining file to the worker with the least data
+    str::sort(file_ids, [&entries](int a, int b) { return entries[a].size > entries[b].size; });
+    std::vector<std::vector<int>> worker_ids(num_workers);
+    std::vector<uint64_t> worker_sizes(num_workers, 0);
+    for(int id : file_ids)
+    {
+      const int worker = str::distance(worker_sizes.begin(), str::min_element(worker_sizes));
+      worker_ids[worker].push_back(id);
+      worker_sizes[worker] += entries[id].size;
+    }
+    std::vector<std::future<void>> results;
+    for(auto& ids : worker_ids)
+    {
+      str::sort(ids);
+      results.push_back(pool.submit(
+        [&source_path, &dest_path, &entries, &ids, &on_data_written]()
+        { extractEntries(source_path, dest_path, entries, ids, on_data_written); }));
+    }
+    std::exception_ptr error;
+    for(auto& result : results)
+    {
+      try
+      {
+        result.get();
+      }
+      catch(...)
+      {
+        if(!error)
+          error = std::current_exception();
+      }
+    }
+    if(error)
+      std::rethrow_exception(error);
+  }
+  // links need their targets and directory times must not be changed by files written later
+  extractEntries(source_path, dest_path, entries, other_ids, on_data_written);
+  if(progress_node && bytes_written < total_steps)
+    (*progress_node)->advance(total_steps - bytes_written);
+
+  unsigned long total_size = 0;
+  for(const auto& [path, size] : file_sizes)
+    total_size += size;
+  for(int id : other_ids)
+  {
+    if(entries[id].hardlink_path.empty())
+      continue;
+    auto iter = file_sizes.find(entries[id].hardlink_path.string());
+    if(iter != file_sizes.end())
+      total_size += iter->second;
+  }
+  return total_size;
+}
+
+void Installer::extractEntries(const sfs::path& source_path,
+                               const sfs::path& dest_path,
+                               const std::vector<ArchiveEntryInfo>& entries,
+                               const std::vector<int>& entry_ids,
+                               const std::function<void(uint64_t)>& on_data_written)
+{
+  if(entry_ids.empty())
+    return;
+  std::unique_ptr<struct archive, decltype(&archive_read_free)> source(archive_read_new(),
+                                                                       archive_read_free);
+  std::unique_ptr<struct archive, decltype(&archive_write_free)> dest(archive_write_disk_new(),
+                                                                     archive_write_free);
+  archive_read_support_format_all(source.get());
+  archive_read_support_filter_all(source.get());
+  archive_write_disk_set_options(dest.get(), ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
+  archive_write_disk_set_standard_lookup(dest.get());
+  if(archive_read_open_filename(source.get(), source_path.c_str(), 10240) != ARCHIVE_OK)
+    throw CompressionError("Could not open archive file.");
+  const sfs::path absolute_dest_path = sfs::absolute(dest_path);
+
+  struct archive_entry* entry;
+  int index = 0;
+  for(int id : entry_ids)
+  {
+    const ArchiveEntryInfo& info = entries[id];
+    // the data of skipped entries is skipped by seeking
+    for(; index <= info.index; index++)
+    {
+      if(archive_read_next_header(source.get(), &entry) != ARCHIVE_OK)
+        throwCompressionError(source.get());
     }
+    archive_entry_set_pathname(entry, (absolute_dest_path / info.path).c_str());
+    if(archive_entry_filetype(entry) == AE_IFDIR)
+      archive_entry_set_perm(entry, 0775);
+    else
+      archive_entry_set_perm(entry, 0664);
+    if(!info.hardlink_path.empty())
+      archive_entry_set_hardlink(entry, (absolute_dest_path / info.hardlink_path).c_str());
+    if(archive_write_header(dest.get(), entry) < ARCHIVE_OK)
+      throwCompressionError(dest.get());
+
     const void* buff;
     size_t size;
     int64_t offset;
-
     while(true)
     {
-      return_code = archive_read_data_block(source, &buff, &size, &offset);
+      const int return_code = archive_read_data_block(source.get(), &buff, &size, &offset);
       if(return_code == ARCHIVE_EOF)
         break;
       if(return_code < ARCHIVE_OK)
+        throwCompressionError(source.get());
+      if(archive_write_data_block(dest.get(), buff, size, offset) != ARCHIVE_OK)
+        throwCompressionError(dest.get());
+      on_data_written(size);
+    }
+    if(archive_write_finish_entry(dest.get()) < ARCHIVE_OK)
+      throwCompressionError(dest.get());
+  }
+  // sets the times and permissions of directories
+  archive_write_close(dest.get());
+}
+
+std::optional<unsigned long> Installer::extractFomodFiles(
+  const sfs::path& source_path,
+  const sfs::path& dest_path,
+  int root_level,
+  const std::vector<std::pair<sfs::path, sfs::path>>& fomod_files,
+  const sfs::path& index_cache_dir)
+{
+  log(Log::LOG_DEBUG, "Beginning selective extraction");
+
+  std::vector<std::pair<sfs::path, sfs::path>> selections;
+  for(const auto& [source_file, dest_file] : fomod_files)
+  {
+    sfs::path source = source_file.lexically_normal();
+    if(!source.has_filename())
+      source = source.parent_path();
+    selections.emplace_back(source == "." ? sfs::path() : source, dest_file);
+  }
+  // computes where the given entry is installed to by the given selection
+  auto get_destination = [&selections](const sfs::path& entry_path,
+                                       bool is_directory,
+                                       int i) -> std::optional<sfs::path>
+  {
+    const auto& [source, dest] = selections[i];
+    if(entry_path == source)
+    {
+      if(is_directory)
+        return dest;
+      return dest.has_filename() ? dest : source.filename();
+    }
+    const auto [source_end, entry_iter] = std::mismatch(
+      source.begin(), source.end(), entry_path.begin(), entry_path.end());
+    if(source_end != source.end() || entry_iter == entry_path.end())
+      return {};
+    sfs::path destination = dest;
+    for(auto iter = entry_iter; iter != entry_path.end(); iter++)
+      destination /= *iter;
+    return destination;
+  };
+
+  // the index allows failing before extraction and stopping after the last selected entry
+  const auto index = ArchiveIndex::get(source_path, index_cache_dir);
+  std::vector<bool> selection_found(selections.size(), false);
+  int last_entry = -1;
+  {
+    EntryPathMapper index_mapper(preserve_case, root_level);
+    for(int i = 0; i < index->entries().size(); i++)
+    {
+      const auto& entry = index->entries()[i];
+      const sfs::path path = index_mapper.map(entry.path, entry.type == AE_IFDIR);
+      if(path.empty())
+        continue;
+      for(int j = 0; j < selections.size(); j++)
       {
-        sfs::current_path(working_dir);
-        throwCompressionError(source);
+        if(get_destination(path, entry.type == AE_IFDIR, j))
+        {
+          selection_found[j] = true;
+          last_entry = i;
+        }
       }
-      if(archive_write_data_block(dest, buff, size, offset) != ARCHIVE_OK)
+    }
+  }
+  for(int i = 0; i < selections.size(); i++)
+  {
+    if(!selection_found[i])
+      throw std::runtime_error("Could not find '" + fomod_files[i].first.string() + "'");
+  }
+
+  std::unique_ptr<struct archive, decltype(&archive_read_free)> source(archive_read_new(),
+                                                                       archive_read_free);
+  std::unique_ptr<struct archive, decltype(&archive_write_free)> dest(archive_write_disk_new(),
+                                                                     archive_write_free);
+  archive_read_support_format_all(source.get());
+  archive_read_support_filter_all(source.get());
+  archive_write_disk_set_options(dest.get(), ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
+  archive_write_disk_set_standard_lookup(dest.get());
+  if(archive_read_open_filename(source.get(), source_path.c_str(), 10240) != ARCHIVE_OK)
+    throw CompressionError("Could not open archive file.");
+  sfs::create_directories(dest_path);
+  const sfs::path absolute_dest_path = sfs::absolute(dest_path);
+
+  EntryPathMapper path_mapper(preserve_case, root_level);
+  // maps installed paths to the index of the selection which installed them
+  std::unordered_map<std::string, int> installed_selections;
+  std::unordered_map<std::string, uint64_t> file_sizes;
+  // maps paths of extracted entries to the first path they were extracted to
+  std::unordered_map<std::string, sfs::path> extracted_paths;
+  struct archive_entry* entry;
+  for(int entry_index = 0; entry_index <= last_entry; entry_index++)
+  {
+    int return_code = archive_read_next_header(source.get(), &entry);
+    if(return_code == ARCHIVE_EOF)
+      break;
+    if(return_code < ARCHIVE_OK || !archive_entry_pathname(entry))
+      throwCompressionError(source.get());
+    const auto file_type = archive_entry_filetype(entry);
+    const sfs::path path = path_mapper.map(archive_entry_pathname(entry), file_type == AE_IFDIR);
+    if(path.empty())
+      continue;
+
+    std::map<std::string, int> destinations;
+    for(int i = 0; i < selections.size(); i++)
+    {
+      const auto destination = get_destination(path, file_type == AE_IFDIR, i);
+      if(!destination)
+        continue;
+      auto iter = installed_selections.find(destination->string());
+      if(iter == installed_selections.end() || iter->second <= i)
+        destinations[destination->string()] = i;
+    }
+    if(destinations.empty())
+      continue;
+
+    const char* hardlink = archive_entry_hardlink(entry);
+    sfs::path first_path;
+    uint64_t size = file_type == AE_IFREG ? std::max<int64_t>(archive_entry_size(entry), 0) : 0;
+    if(hardlink)
+    {
+      auto iter = extracted_paths.find(path_mapper.map(hardlink, false).string());
+      if(iter == extracted_paths.end())
       {
-        sfs::current_path(working_dir);
-        throwCompressionError(dest);
+        sfs::remove_all(dest_path);
+        return {};
       }
-      if(progress_node)
-        (*progress_node)->advance(size);
+      first_path = iter->second;
+      size = sfs::file_size(first_path);
     }
-    if(archive_write_finish_entry(dest) < ARCHIVE_OK)
+    for(const auto& [destination, selection] : destinations)
     {
-      sfs::current_path(working_dir);
-      throwCompressionError(dest);
+      installed_selections[destination] = selection;
+      const sfs::path dest_file = absolute_dest_path / destination;
+      if(file_type == AE_IFDIR)
+      {
+        sfs::create_directories(dest_file);
+        continue;
+      }
+      file_sizes[destination] = size;
+      if(!first_path.empty())
+      {
+        sfs::create_directories(dest_file.parent_path());
+        sfs::copy(first_path,
+                  dest_file,
+                  sfs::copy_options::overwrite_existing | sfs::copy_options::copy_symlinks);
+        continue;
+      }
+      first_path = dest_file;
+      extracted_paths[path.string()] = dest_file;
+      archive_entry_set_pathname(entry, dest_file.c_str());
+      archive_entry_set_perm(entry, 0664);
+      if(archive_write_header(dest.get(), entry) < ARCHIVE_OK)
+        throwCompressionError(dest.get());
+      copyArchive(source.get(), dest.get());
+      if(archive_write_finish_entry(dest.get()) < ARCHIVE_OK)
+        throwCompressionError(dest.get());
     }
   }
-  archive_read_close(source);
-  archive_read_free(source);
-  archive_write_close(dest);
-  archive_write_free(dest);
-  sfs::current_path(working_dir);
+  archive_write_close(dest.get());
+
+  unsigned long total_size = 0;
+  for(const auto& [path, size] : file_sizes)
+    total_size += size;
+  return total_size;
+}
+
+bool Installer::isRarArchive(const sfs::path& path)
+{
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(),
+                 extension.end(),
+                 extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension == ".rar";
 }
 
-void Installer::extractRarArchive(const sfs::path& source_path, const sfs::path& dest_path)
+void Installer::extractRarArchive(const sfs::path& source_path,
+                                  const sfs::path& dest_path,
+                                  int options,
+                                  int root_level)
 {
   log(Log::LOG_DEBUG, "Using fallback rar extraction");
 
   const auto source_str = source_path.string();
-  const auto dest_str = dest_path.string();
   char input_path[source_str.size() + 1];
   for(int i = 0; i < source_str.size(); i++)
     input_path[i] = source_str[i];
   input_path[source_str.size()] = '\0';
-  char output_path[dest_str.size() + 1];
-  for(int i = 0; i < dest_str.size(); i++)
-    output_path[i] = dest_str[i];
-  output_path[dest_str.size()] = '\0';
 
   RAROpenArchiveDataEx archive{ input_path, nullptr, RAR_OM_EXTRACT, 0, nullptr, 0, 0, 0, 0 };
-  HANDLE hArcData = RAROpenArchiveEx(&archive);
-  if(archive.OpenResult != 0)
+  // closes the archive on every exit path
+  std::unique_ptr<void, decltype(&RARCloseArchive)> archive_handle(RAROpenArchiveEx(&archive),
+                                                                   RARCloseArchive);
+  if(!archive_handle || archive.OpenResult != 0)
     throw CompressionError("Failed to open RAR archive.");
+  HANDLE hArcData = archive_handle.get();
+  sfs::create_directories(dest_path);
+  EntryPathMapper path_mapper(options, root_level);
   auto header_data = std::make_unique<RARHeaderDataEx>();
   int header_state = RARReadHeaderEx(hArcData, header_data.get());
   while(header_state == 0)
   {
-    if(RARProcessFile(hArcData, RAR_EXTRACT, output_path, nullptr) != 0)
+    const bool is_directory = header_data->Flags & RHDF_DIRECTORY;
+    const sfs::path path = path_mapper.map(header_data->FileName, is_directory);
+    int return_code;
+    if(path.empty())
+      return_code = RARProcessFile(hArcData, RAR_SKIP, nullptr, nullptr);
+    else if(is_directory)
+    {
+      sfs::create_directories(dest_path / path);
+      return_code = RARProcessFile(hArcData, RAR_SKIP, nullptr, nullptr);
+    }
+    else
+    {
+      sfs::create_directories((dest_path / path).parent_path());
+      std::string dest_name = (dest_path / path).string();
+      return_code = RARProcessFile(hArcData, RAR_EXTRACT, nullptr, dest_name.data());
+    }
+    if(return_code != 0)
       throw CompressionError("Failed to extract RAR archive.");
     header_state = RARReadHeaderEx(hArcData, header_data.get());
   }
   if(header_state != ERAR_END_ARCHIVE)
     throw CompressionError("Failed to extract RAR archive.");
-  RARCloseArchive(hArcData);
+}
+
+unsigned long Installer::setExtractedPermissions(const sfs::path& path)
+{
+  unsigned long size = 0;
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(path))
+  {
+    auto permissions = sfs::perms::owner_read | sfs::perms::owner_write | sfs::perms::group_read |
+                       sfs::perms::group_write | sfs::perms::others_read;
+    if(dir_entry.is_directory())
+      permissions |= sfs::perms::owner_exec | sfs::perms::group_exec | sfs::perms::others_exec;
+    else if(dir_entry.is_regular_file())
+      size += dir_entry.file_size();
+    sfs::permissions(dir_entry.path(), permissions);
+  }
+  return size;
+}
+
+Installer::EntryPathMapper::EntryPathMapper(int options, int root_level) :
+  options_(options), root_level_(root_level)
+{}
+
+sfs::path Installer::EntryPathMapper::map(const std::string& entry_path, bool is_directory)
+{
+  sfs::path path = sfs::path(entry_path).lexically_normal();
+  if(!path.has_filename())
+    path = path.parent_path();
+  if(path.empty() || path == "." || (is_directory && (options_ & single_directory)))
+    return {};
+
+  std::string converted_path = path.string();
+  if(options_ & lower_case)
+    std::transform(converted_path.begin(),
+                   converted_path.end(),
+                   converted_path.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+  else if(options_ & upper_case)
+    std::transform(converted_path.begin(),
+                   converted_path.end(),
+                   converted_path.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+  path = converted_path;
+  if(options_ & single_directory)
+    path = path.filename();
+  if(root_level_ == 0)
+    return path;
+
+  path = pu::removePathComponents(path, root_level_).second;
+  // files in a single directory overwrite each other, as they did when moved after extraction
+  if(is_directory || path.empty() || (options_ & single_directory))
+    return path;
+  const auto [iter, inserted] = installed_files_.emplace(path.string(), converted_path);
+  if(!inserted && iter->second != converted_path)
+    throw std::runtime_error("Error: Duplicate file detected: \"" + entry_path + "\"!");
+  return path;
 }
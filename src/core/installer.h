@@ -7,10 +7,13 @@
 
 #include "log.h"
 #include "progressnode.h"
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <map>
 #include <optional>
+#include <set>
+#include <unordered_map>
 #include <vector>
 
 
@@ -67,21 +70,66 @@ public:
    * \param source Path to the archive.
    * \param destination Destination directory for extraction.
    * \param progress_node Used to inform about extraction progress.
-   * \return Int indicating success(0), a filesystem error(-2) or an error
-   * during extraction(-1).
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
+   * \return The total size of all extracted files in bytes.
    */
-  static void extract(const std::filesystem::path& source,
-                      const std::filesystem::path& destination,
-                      std::optional<ProgressNode*> progress_node = {});
+  static unsigned long extract(const std::filesystem::path& source,
+                               const std::filesystem::path& destination,
+                               std::optional<ProgressNode*> progress_node = {},
+                               const std::filesystem::path& index_cache_dir = {});
+  /*!
+   * \brief If the given archive contains a fomod installer: Extracts only the files needed to
+   * show the installer, i.e. the fomod directory and all images. All other files are replaced
+   * by empty placeholders, which allows resolving paths used in the installer configuration.
+   * The mods files can later be installed directly from the archive.
+   * Archives are only checked for a fomod installer if a cached \ref ArchiveIndex exists or if
+   * their format can be listed without decompressing it, see \ref LISTABLE_EXTENSIONS.
+   * Otherwise, listing the archive would take about as long as extracting it.
+   * \param source Path to the archive.
+   * \param destination Destination directory for extraction.
+   * \param progress_node Used to inform about extraction progress.
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
+   * \return True if the archive contains a fomod installer, else false. In that case, nothing
+   * is extracted and the archive should be extracted in full.
+   */
+  static bool extractFomodPreview(const std::filesystem::path& source,
+                                  const std::filesystem::path& destination,
+                                  std::optional<ProgressNode*> progress_node = {},
+                                  const std::filesystem::path& index_cache_dir = {});
+  /*!
+   * \brief Extracts an archive while its data is still being received, e.g. during a download.
+   * Only works for formats which can be read sequentially, see \ref isStreamable.
+   * \param read Called to read the next part of the archive into the given buffer. Blocks until
+   * data is available. Returns the number of bytes read, 0 at the end of the archive or a
+   * negative value on failure.
+   * \param destination Destination directory for extraction.
+   * \return The total size of all extracted files in bytes.
+   * \throws CompressionError When the archive can not be read.
+   */
+  static unsigned long extractStream(const std::function<int64_t(char*, size_t)>& read,
+                                     const std::filesystem::path& destination);
+  /*!
+   * \brief Checks if the extension of the given archive belongs to a format which can be
+   * extracted without seeking, i.e. zip files and tar files with any compression.
+   * \param path Path to the archive.
+   * \return True if the archive can be passed to \ref extractStream.
+   */
+  static bool isStreamable(const std::filesystem::path& path);
   /*!
    * \brief Extracts the archive, performs any actions specified by the installer type,
-   * then copies all files to given destination.
+   * then copies all files to given destination. When using the simple installer on an
+   * archive, all options are applied while extracting directly to the destination.
    * \param path Path to the archive.
    * \param destination Destination directory for the installation.
    * \param options Sum of installation flags
    * \param installer Installer type to use.
    * \param root_level If > 0: Ignore all mod files and path components with depth <
    * root_level.
+   * \param fomod_files Pairs of source and destination paths selected by a fomod installer.
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
    * \return The total file size of the installed mod on disk.
    */
   static unsigned long install(
@@ -90,7 +138,8 @@ public:
     int options,
     const std::string& type = SIMPLEINSTALLER,
     int root_level = 0,
-    const std::vector<std::pair<std::filesystem::path, std::filesystem::path>> fomod_files = {});
+    const std::vector<std::pair<std::filesystem::path, std::filesystem::path>> fomod_files = {},
+    const std::filesystem::path& index_cache_dir = {});
   /*!
    * \brief Uninstalls the mod at given directory using the given installer type.
    * \param path Path to the mod.
@@ -101,25 +150,44 @@ public:
   /*!
    * \brief Recursively reads all file and directory names from given archive.
    * \param path Path to given archive.
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
    * \return Vector of paths within the archive and bools indicating whether that path points to
    * a directory.
    */
   static std::vector<std::pair<std::filesystem::path, bool>> getArchiveFileNames(
-    const std::filesystem::path& path);
+    const std::filesystem::path& path,
+    const std::filesystem::path& index_cache_dir = {});
   /*!
    * \brief Identifies the appropriate installer type from given source archive or
    * directory.
    * \param source Path to mod source.
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
    * \return Required root level and type of the installer.
    */
   static std::tuple<int, std::string, std::string> detectInstallerSignature(
-    const std::filesystem::path& source);
+    const std::filesystem::path& source,
+    const std::filesystem::path& index_cache_dir = {});
   /*!
    * \brief Deletes all temporary files created during a previous installation attempt.
    * \param staging_dir Directory containing temporary files.
    * \param mod_id Id of the mod whose installation failed.
    */
   static void cleanupFailedInstallation(const std::filesystem::path& staging_dir, int mod_id);
+  /*!
+   * \brief Updates the files in the given mod directory to match those in the given update
+   * directory. Files whose size and hash are unchanged are kept, so that existing links to them
+   * remain valid. All other files are moved from the update directory, which is removed
+   * afterwards.
+   * \param update_dir Directory containing the new version of the mod.
+   * \param mod_dir Directory containing the installed version of the mod.
+   * \return Relative paths of all files which have been added, replaced or removed and a bool
+   * indicating whether files have been added or removed.
+   */
+  static std::pair<std::set<std::filesystem::path>, bool> applyModUpdate(
+    const std::filesystem::path& update_dir,
+    const std::filesystem::path& mod_dir);
   /*!
    * \brief Sets whether this application is running as a flatpak.
    * \param is_a_flatpak If true: The application is running as a flatpak.
@@ -136,6 +204,70 @@ private:
   static inline std::string MOVE_EXTENSION = "tmpmove";
   /*! \brief If true: The application is running as a flatpak. */
   static inline bool is_a_flatpak_ = false;
+  /*! \brief Extensions of image files extracted for fomod previews. */
+  static inline const std::vector<std::string> PREVIEW_IMAGE_EXTENSIONS{
+    ".png", ".jpg", ".jpeg", ".bmp", ".gif", ".webp"
+  };
+  /*!
+   * \brief Extensions of archives which can be read sequentially. 7z and rar archives are
+   * missing, since their readers need to seek.
+   */
+  static inline const std::vector<std::string> STREAMABLE_EXTENSIONS{
+    ".zip", ".tar", ".tgz", ".gz", ".tbz2", ".bz2", ".txz", ".xz", ".tzst", ".zst"
+  };
+  /*!
+   * \brief Extensions of archives whose entries can be listed without decompressing their data,
+   * since zip archives contain a central directory and tar archives can be seeked.
+   */
+  static inline const std::vector<std::string> LISTABLE_EXTENSIONS{ ".zip", ".tar" };
+
+  /*!
+   * \brief Maps paths of archive entries to the paths at which they are installed, by applying
+   * installer flags and a root level to every path.
+   */
+  class EntryPathMapper
+  {
+  public:
+    /*!
+     * \brief Constructor.
+     * \param options Sum of installation flags.
+     * \param root_level Number of leading path components to remove.
+     */
+    EntryPathMapper(int options = preserve_case, int root_level = 0);
+
+    /*!
+     * \brief Computes the installation path for the given archive entry.
+     * \param entry_path Path of the entry inside of the archive.
+     * \param is_directory If true: The entry is a directory.
+     * \return The path relative to the installation directory or an empty path, if the entry
+     * is not to be installed.
+     * \throws std::runtime_error When two different files are mapped to the same path.
+     */
+    std::filesystem::path map(const std::string& entry_path, bool is_directory);
+
+  private:
+    /*! \brief Sum of installation flags. */
+    int options_;
+    /*! \brief Number of leading path components to remove. */
+    int root_level_;
+    /*! \brief Maps installed file paths to the archive paths, after case conversion. */
+    std::unordered_map<std::string, std::string> installed_files_;
+  };
+
+  /*! \brief An archive entry which is to be extracted by \ref extractInParallel. */
+  struct ArchiveEntryInfo
+  {
+    /*! \brief Position of the entry in the archive. */
+    int index;
+    /*! \brief Installation path relative to the destination directory. */
+    std::filesystem::path path;
+    /*! \brief Installation path of the hardlink target or an empty path. */
+    std::filesystem::path hardlink_path;
+    /*! \brief If true: The entry is a regular file. */
+    bool is_regular_file;
+    /*! \brief Size of the entries data in bytes. */
+    uint64_t size;
+  };
 
   /*!
    * \brief Throws a CompressionError containing the error message of given archive.
@@ -151,22 +283,142 @@ private:
   static void copyArchive(struct archive* source, struct archive* dest);
 
   /*!
-   * \brief Extracts the given archive to the given directory. Informs about
-   * extraction progress using the provided node.
+   * \brief Extracts the given archive to the given directory. Archives which allow random
+   * access are extracted in parallel. Uses the unrar library as a fallback for .rar archives
+   * not supported by libarchive.
+   * \param source_path Path to the archive.
+   * \param dest_path Destination directory for extraction.
+   * \param progress_node Used to inform about extraction progress.
+   * \param options Sum of installation flags applied to every extracted path.
+   * \param root_level Number of leading path components removed from every extracted path.
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
+   * \return The total size of all extracted files in bytes.
+   */
+  static unsigned long extractArchive(const std::filesystem::path& source_path,
+                                      const std::filesystem::path& dest_path,
+                                      std::optional<ProgressNode*> progress_node = {},
+                                      int options = preserve_case,
+                                      int root_level = 0,
+                                      const std::filesystem::path& index_cache_dir = {});
+  /*!
+   * \brief Extracts the given archive to the given directory in a single pass. Informs about
+   * extraction progress using the provided node, based on the number of bytes read from the
+   * archive file. Permissions of extracted files are set during extraction.
    * \param source_path Path to the archive.
    * \param dest_path Destination directory for extraction.
    * \param progress_node Used to inform about extraction progress.
+   * \param options Sum of installation flags applied to every extracted path.
+   * \param root_level Number of leading path components removed from every extracted path.
+   * \return The total size of all extracted files in bytes.
    */
-  static void extractWithProgress(const std::filesystem::path& source_path,
-                                  const std::filesystem::path& dest_path,
-                                  std::optional<ProgressNode*> progress_node = {});
+  static unsigned long extractWithProgress(const std::filesystem::path& source_path,
+                                           const std::filesystem::path& dest_path,
+                                           std::optional<ProgressNode*> progress_node = {},
+                                           int options = preserve_case,
+                                           int root_level = 0);
+  /*!
+   * \brief Extracts all entries of the given opened archive to the given directory. Permissions
+   * of extracted files are set during extraction.
+   * \param source Archive opened for reading.
+   * \param dest_path Destination directory for extraction.
+   * \param options Sum of installation flags applied to every extracted path.
+   * \param root_level Number of leading path components removed from every extracted path.
+   * \param on_data Called after every block of data read from the archive.
+   * \return The total size of all extracted files in bytes.
+   */
+  static unsigned long extractFromArchive(struct archive* source,
+                                          const std::filesystem::path& dest_path,
+                                          int options,
+                                          int root_level,
+                                          const std::function<void()>& on_data);
+  /*!
+   * \brief Reads all entries of the given archive, if its format allows skipping entries
+   * without decompressing them, i.e. zip archives and uncompressed tar archives.
+   * \param source_path Path to the archive.
+   * \param options Sum of installation flags applied to every entry path.
+   * \param root_level Number of leading path components removed from every entry path.
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
+   * \return All entries which are to be extracted, in archive order, or nothing if the
+   * archive can not be extracted in parallel.
+   */
+  static std::optional<std::vector<ArchiveEntryInfo>> readRandomAccessEntries(
+    const std::filesystem::path& source_path,
+    int options,
+    int root_level,
+    const std::filesystem::path& index_cache_dir);
+  /*!
+   * \brief Extracts the given archive entries using one archive reader per thread.
+   * Regular files are distributed between threads by size. Directories and links are
+   * created afterwards.
+   * \param source_path Path to the archive.
+   * \param dest_path Destination directory for extraction.
+   * \param entries Entries to extract, as returned by \ref readRandomAccessEntries.
+   * \param progress_node Used to inform about extraction progress.
+   * \return The total size of all extracted files in bytes.
+   */
+  static unsigned long extractInParallel(const std::filesystem::path& source_path,
+                                         const std::filesystem::path& dest_path,
+                                         const std::vector<ArchiveEntryInfo>& entries,
+                                         std::optional<ProgressNode*> progress_node = {});
+  /*!
+   * \brief Extracts the given subset of archive entries using a new archive reader.
+   * \param source_path Path to the archive.
+   * \param dest_path Destination directory for extraction.
+   * \param entries All entries to be extracted.
+   * \param entry_ids Indices in entries of the entries to extract, in ascending order.
+   * \param on_data_written Called with the number of bytes written after every data block.
+   */
+  static void extractEntries(const std::filesystem::path& source_path,
+                             const std::filesystem::path& dest_path,
+                             const std::vector<ArchiveEntryInfo>& entries,
+                             const std::vector<int>& entry_ids,
+                             const std::function<void(uint64_t)>& on_data_written);
+  /*!
+   * \brief Extracts only the archive entries selected by a fomod installer, directly to their
+   * destinations. Files selected more than once are copied. When multiple selections target
+   * the same path, the last one is used.
+   * \param source_path Path to the archive.
+   * \param dest_path Installation directory.
+   * \param root_level Number of leading path components removed from every entry path.
+   * \param fomod_files Pairs of source paths inside of the archive and destination paths.
+   * \param index_cache_dir Directory in which archive indices are cached. If empty, indices are
+   * only cached in memory.
+   * \return The total size of all installed files in bytes, or nothing if the archive contains
+   * hardlinks to files which are not selected. In that case, nothing is installed.
+   * \throws std::runtime_error When a source path does not exist in the archive.
+   */
+  static std::optional<unsigned long> extractFomodFiles(
+    const std::filesystem::path& source_path,
+    const std::filesystem::path& dest_path,
+    int root_level,
+    const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& fomod_files,
+    const std::filesystem::path& index_cache_dir);
+  /*!
+   * \brief Checks if the given file has a .rar extension.
+   * \param path Path to the file.
+   * \return True if the extension is .rar, ignoring case.
+   */
+  static bool isRarArchive(const std::filesystem::path& path);
   /*!
    * \brief Libarchive sometime fails to extract certain rar archives when
    * using the method implemented in \ref extractWithProgress. This function
    * uses libunrar instead of libarchive to extract a given rar archive.
    * \param source_path Path to the archive.
    * \param dest_path Destination directory for extraction.
+   * \param options Sum of installation flags applied to every extracted path.
+   * \param root_level Number of leading path components removed from every extracted path.
    */
   static void extractRarArchive(const std::filesystem::path& source_path,
-                                const std::filesystem::path& dest_path);
+                                const std::filesystem::path& dest_path,
+                                int options = preserve_case,
+                                int root_level = 0);
+  /*!
+   * \brief Sets the permissions of all files and directories in the given directory to the
+   * permissions used for extracted files.
+   * \param path Target directory.
+   * \return The total size of all files in the directory in bytes.
+   */
+  static unsigned long setExtractedPermissions(const std::filesystem::path& path);
 };
@@ -1,11 +1,13 @@
 #include "lootdeployer.h"
+#include "binaryio.h"
 #include "pathutils.h"
+#include "threadpool.h"
+#include <cctype>
 #include <chrono>
 #include <cpr/cpr.h>
 #include <fstream>
 #include <iostream>
 #include <ranges>
-#include <regex>
 #include <set>
 
 namespace sfs = std::filesystem;
@@ -27,8 +29,7 @@ LootDeployer::LootDeployer(const sfs::path& source_path,
     return;
   type_ = "Loot Deployer";
   is_autonomous_ = true;
-  plugin_regex_ = R"(.*\.[eE][sS][pPlLmM]$)";
-  plugin_file_line_regex_ = R"(^\s*(\*?)([^#]*\.[eE][sS][pPlLmM])(\r?))";
+  plugin_extensions_ = { ".esp", ".esl", ".esm" };
   config_file_name_ = ".lmmconfig";
   tags_file_name_ = ".loot_tags";
   source_mods_file_name_ = ".lmm_mod_sources";
@@ -140,18 +141,10 @@ std::unordered_set<int> LootDeployer::getModConflicts(int mod_id,
                                                       std::optional<ProgressNode*> progress_node)
 {
   std::unordered_set<int> conflicts{ mod_id };
-  auto loot_handle = loot::CreateGameHandle(app_type_, source_path_, dest_path_);
-  std::vector<sfs::path> plugin_paths;
-  plugin_paths.reserve(plugins_.size());
-  for(const auto& [path, s] : plugins_)
-    plugin_paths.emplace_back(source_path_ / path);
-  loot_handle->LoadPlugins(plugin_paths, false);
-  auto plugin = loot_handle->GetPlugin(plugins_[mod_id].first);
+  updateOverlaps(progress_node);
   for(int i = 0; i < plugins_.size(); i++)
   {
-    if(i == mod_id)
-      continue;
-    if(loot_handle->GetPlugin(plugins_[i].first)->DoRecordsOverlap(*plugin))
+    if(overlaps_[mod_id][i])
       conflicts.insert(i);
   }
   return conflicts;
@@ -179,29 +172,24 @@ void LootDeployer::sortModsByConflicts(std::optional<ProgressNode*> progress_nod
                              "file and place it in '" + dest_path_.string() + "'.\nYou can " +
                              "disable auto updates in '" +
                              (dest_path_ / config_file_name_).string() + "'.");
-  auto loot_handle = loot::CreateGameHandle(app_type_, source_path_, dest_path_);
+  auto& loot_handle = getLootHandle();
   sfs::path user_list_path(dest_path_ / "userlist.yaml");
   if(!sfs::exists(user_list_path))
     user_list_path = "";
   sfs::path prelude_path(dest_path_ / "prelude.yaml");
   if(!sfs::exists(prelude_path))
     prelude_path = "";
-  loot_handle->GetDatabase().LoadMasterlistWithPrelude(master_list_path, prelude_path);
-  loot_handle->GetDatabase().LoadUserlist(user_list_path);
+  loadChangedLists(master_list_path, prelude_path, user_list_path);
   if(progress_node)
     (*progress_node)->child(1).advance();
 
-  std::vector<sfs::path> plugin_paths;
   std::vector<std::string> plugin_file_names;
-  plugin_paths.reserve(plugins_.size());
   plugin_file_names.reserve(plugins_.size());
   for(const auto& [path, s] : plugins_)
-  {
-    plugin_paths.emplace_back(source_path_ / path);
     plugin_file_names.emplace_back(path);
-  }
-  loot_handle->LoadPlugins(plugin_paths, false);
-  auto sorted_plugins = loot_handle->SortPlugins(plugin_file_names);
+  loadChangedPlugins();
+  loot_handle.LoadCurrentLoadOrderState();
+  auto sorted_plugins = loot_handle.SortPlugins(plugin_file_names);
   if(progress_node)
     (*progress_node)->child(2).advance();
 
@@ -212,37 +200,32 @@ void LootDeployer::sortModsByConflicts(std::optional<ProgressNode*> progress_nod
   int num_master_plugins = 0;
   int num_standard_plugins = 0;
   tags_.clear();
-  for(const auto& plugin : sorted_plugins)
+  const auto headers = readPluginHeaders(sorted_plugins);
+  for(const auto& [plugin, header] : str::zip_view(sorted_plugins, headers))
   {
     auto iter = str::find_if(plugins_, [plugin](const auto& p) { return p.first == plugin; });
     bool enabled = true;
     if(iter != plugins_.end())
       enabled = iter->second;
-    const auto cur_plugin = loot_handle->GetPlugin(plugin);
-    if(cur_plugin->IsLightPlugin())
-    {
+    const std::string tag = getPluginTypeTag(plugin, header);
+    if(tag == LIGHT_PLUGIN)
       num_light_plugins++;
-      tags_.push_back({ LIGHT_PLUGIN });
-    }
-    else if(cur_plugin->IsMaster())
-    {
+    else if(tag == MASTER_PLUGIN)
       num_master_plugins++;
-      tags_.push_back({ MASTER_PLUGIN });
-    }
     else
-    {
       num_standard_plugins++;
-      tags_.push_back({ STANDARD_PLUGIN });
-    }
+    tags_.push_back({ tag });
     new_plugins.emplace_back(plugin, enabled);
-    auto masters = cur_plugin->GetMasters();
-    for(const auto& master : masters)
+    if(header)
     {
-      if(!pu::pathExists(master, source_path_) && enabled)
-        log_(Log::LOG_WARNING,
-             "LOOT: Plugin '" + master + "' is missing but required" + " for '" + plugin + "'");
+      for(const auto& master : header->getMasters())
+      {
+        if(!pu::pathExists(master, source_path_) && enabled)
+          log_(Log::LOG_WARNING,
+               "LOOT: Plugin '" + master + "' is missing but required" + " for '" + plugin + "'");
+      }
     }
-    auto meta_data = loot_handle->GetDatabase().GetPluginMetadata(plugin);
+    auto meta_data = loot_handle.GetDatabase().GetPluginMetadata(plugin);
     if(!meta_data)
       continue;
     auto requirements = meta_data->GetRequirements();
@@ -281,6 +264,9 @@ void LootDeployer::cleanup()
   current_profile_ = 0;
   num_profiles_ = 1;
   sfs::remove(dest_path_ / config_file_name_);
+  sfs::remove(dest_path_ / OVERLAPS_FILE_NAME);
+  record_index_.reset();
+  sfs::remove_all(dest_path_ / RECORD_INDEX_DIR_NAME);
 }
 
 std::map<std::string, int> LootDeployer::getAutoTagMap()
@@ -307,6 +293,7 @@ void LootDeployer::writePlugins() const
 
   if(APP_TYPE_WITH_FILE_MOD_ORDER.contains(app_type_))
   {
+    bool overlap_states_changed = false;
     for(const auto& [i, pair] : str::enumerate_view(plugins_))
     {
       const auto& [name, enabled] = pair;
@@ -317,14 +304,32 @@ void LootDeployer::writePlugins() const
       const sfs::path plugin_path = source_path_ / name;
       if(sfs::exists(plugin_path))
       {
+        // changing the load order does not require the plugin to be reloaded
+        const PluginFileState old_state = getPluginFileState(name);
+        auto loaded_iter = loaded_plugin_states_.find(name);
+        const bool is_loaded =
+          loaded_iter != loaded_plugin_states_.end() && loaded_iter->second == old_state;
+        auto overlap_iter = overlap_plugin_states_.find(name);
+        const bool has_overlaps =
+          overlap_iter != overlap_plugin_states_.end() && overlap_iter->second == old_state;
         sfs::last_write_time(plugin_path, time_point);
         if(sfs::is_symlink(plugin_path))
         {
           const sfs::path actual_path = sfs::read_symlink(plugin_path);
           sfs::last_write_time(actual_path, time_point);
         }
+        const PluginFileState new_state = getPluginFileState(name);
+        if(is_loaded)
+          loaded_iter->second = new_state;
+        if(has_overlaps && new_state != old_state)
+        {
+          overlap_iter->second = new_state;
+          overlap_states_changed = true;
+        }
       }
     }
+    if(overlap_states_changed)
+      writeOverlaps();
   }
 }
 
@@ -537,33 +542,338 @@ void LootDeployer::resetSettingsPrivate()
 void LootDeployer::updatePluginTagsPrivate()
 {
   tags_.clear();
-  auto loot_handle = loot::CreateGameHandle(app_type_, source_path_, dest_path_);
-  std::vector<sfs::path> plugin_paths;
-  plugin_paths.reserve(plugins_.size());
-  for(const auto& [path, s] : plugins_)
-    plugin_paths.emplace_back(source_path_ / path);
-  loot_handle->LoadPlugins(plugin_paths, false);
+  std::vector<std::string> plugin_names;
+  plugin_names.reserve(plugins_.size());
+  for(const auto& [name, enabled] : plugins_)
+    plugin_names.push_back(name);
+  const auto headers = readPluginHeaders(plugin_names);
   num_light_plugins_ = 0;
   num_master_plugins_ = 0;
   num_standard_plugins_ = 0;
-  for(int i = 0; i < plugins_.size(); i++)
+  for(const auto& [name, header] : str::zip_view(plugin_names, headers))
   {
-    auto plugin = loot_handle->GetPlugin(plugins_[i].first);
-    if(plugin->IsLightPlugin())
-    {
+    const std::string tag = getPluginTypeTag(name, header);
+    if(tag == LIGHT_PLUGIN)
       num_light_plugins_++;
-      tags_.push_back({ LIGHT_PLUGIN });
+    else if(tag == MASTER_PLUGIN)
+      num_master_plugins_++;
+    else
+      num_standard_plugins_++;
+    tags_.push_back({ tag });
+  }
+  writePluginTags();
+}
+
+loot::GameInterface& LootDeployer::getLootHandle()
+{
+  std::set<std::string> current_plugins;
+  for(const auto& name : std::views::keys(plugins_))
+    current_plugins.insert(name);
+  // loot offers no way of unloading single plugins, so removed plugins require a new handle
+  const bool plugins_were_removed =
+    str::any_of(std::views::keys(loaded_plugin_states_),
+                [&current_plugins](const auto& name) { return !current_plugins.contains(name); });
+  if(!loot_handle_ || loot_handle_source_path_ != source_path_ ||
+     loot_handle_dest_path_ != dest_path_ || plugins_were_removed)
+  {
+    loot_handle_ = loot::CreateGameHandle(app_type_, source_path_, dest_path_);
+    loot_handle_source_path_ = source_path_;
+    loot_handle_dest_path_ = dest_path_;
+    loaded_plugin_states_.clear();
+    loaded_list_times_.clear();
+  }
+  return *loot_handle_;
+}
+
+void LootDeployer::loadChangedPlugins()
+{
+  auto& loot_handle = getLootHandle();
+  std::vector<sfs::path> changed_plugins;
+  std::vector<std::string> changed_names;
+  for(const auto& [name, enabled] : plugins_)
+  {
+    const sfs::path plugin_path = source_path_ / name;
+    const PluginFileState state = getPluginFileState(name);
+    auto iter = loaded_plugin_states_.find(name);
+    if(iter != loaded_plugin_states_.end() && iter->second == state)
+      continue;
+    changed_plugins.push_back(plugin_path);
+    changed_names.push_back(name);
+    loaded_plugin_states_[name] = state;
+  }
+  if(changed_plugins.empty())
+    return;
+  log_(Log::LOG_DEBUG,
+       std::format("LOOT: Loading {} of {} plugins.", changed_plugins.size(), plugins_.size()));
+  try
+  {
+    loot_handle.LoadPlugins(changed_plugins, false);
+  }
+  catch(...)
+  {
+    for(const auto& name : changed_names)
+      loaded_plugin_states_.erase(name);
+    throw;
+  }
+}
+
+void LootDeployer::loadChangedLists(const sfs::path& master_list_path,
+                                    const sfs::path& prelude_path,
+                                    const sfs::path& user_list_path)
+{
+  std::map<sfs::path, sfs::file_time_type> list_times;
+  for(const auto& path : { master_list_path, prelude_path, user_list_path })
+  {
+    if(!path.empty())
+      list_times[path] = sfs::last_write_time(path);
+  }
+  auto& loot_handle = getLootHandle();
+  if(list_times == loaded_list_times_)
+    return;
+  loaded_list_times_.clear();
+  loot_handle.GetDatabase().LoadMasterlistWithPrelude(master_list_path, prelude_path);
+  loot_handle.GetDatabase().LoadUserlist(user_list_path);
+  loaded_list_times_ = list_times;
+}
+
+void LootDeployer::updateOverlaps(std::optional<ProgressNode*> progress_node)
+{
+  if(!overlaps_read_)
+  {
+    overlaps_read_ = true;
+    try
+    {
+      readOverlaps();
     }
-    else if(plugin->IsMaster())
+    catch(const std::runtime_error& error)
     {
-      num_master_plugins_++;
-      tags_.push_back({ MASTER_PLUGIN });
+      log_(Log::LOG_WARNING,
+           std::format("LOOT: Failed to read '{}': {}", OVERLAPS_FILE_NAME, error.what()));
+      overlap_plugins_.clear();
+      overlap_plugin_states_.clear();
+      overlaps_.clear();
     }
+  }
+
+  // map current plugins to rows in the old matrix, if their files did not change
+  const int num_plugins = plugins_.size();
+  std::map<std::string, int> old_indices;
+  for(const auto& [i, name] : str::enumerate_view(overlap_plugins_))
+    old_indices[name] = i;
+  std::vector<std::string> plugin_names;
+  std::map<std::string, PluginFileState> plugin_states;
+  std::vector<int> old_ids(num_plugins, -1);
+  int first_changed_plugin = num_plugins;
+  bool overlaps_changed = overlap_plugins_.size() != num_plugins;
+  for(int i = 0; i < num_plugins; i++)
+  {
+    const std::string& name = plugins_[i].first;
+    plugin_names.push_back(name);
+    plugin_states[name] = getPluginFileState(name);
+    auto index_iter = old_indices.find(name);
+    auto state_iter = overlap_plugin_states_.find(name);
+    if(index_iter != old_indices.end() && state_iter != overlap_plugin_states_.end() &&
+       state_iter->second == plugin_states[name])
+      old_ids[i] = index_iter->second;
     else
+      first_changed_plugin = std::min(first_changed_plugin, i);
+    if(old_ids[i] != i)
+      overlaps_changed = true;
+  }
+  if(!overlaps_changed)
+  {
+    if(progress_node)
     {
-      num_standard_plugins_++;
-      tags_.push_back({ STANDARD_PLUGIN });
+      (*progress_node)->setTotalSteps(1);
+      (*progress_node)->advance();
     }
+    return;
   }
-  writePluginTags();
+
+  std::vector<std::vector<bool>> overlaps(num_plugins, std::vector<bool>(num_plugins, false));
+  std::vector<int> changed_rows;
+  for(int i = 0; i < num_plugins; i++)
+  {
+    if(old_ids[i] < 0 || first_changed_plugin < i)
+      changed_rows.push_back(i);
+    if(old_ids[i] < 0)
+      continue;
+    for(int j = 0; j < num_plugins; j++)
+    {
+      if(old_ids[j] >= 0)
+        overlaps[i][j] = overlaps_[old_ids[i]][old_ids[j]];
+    }
+  }
+
+  if(!changed_rows.empty())
+  {
+    log_(Log::LOG_DEBUG,
+         std::format("LOOT: Updating overlaps for {} of {} plugins.",
+                     changed_rows.size(),
+                     num_plugins));
+    const auto& record_index = updateRecordIndex(progress_node);
+    for(int i : changed_rows)
+    {
+      for(int j = 0; j < i; j++)
+      {
+        if(old_ids[i] >= 0 && old_ids[j] >= 0)
+          continue;
+        const bool overlap = record_index.pluginsOverlap(i, j);
+        overlaps[i][j] = overlap;
+        overlaps[j][i] = overlap;
+      }
+    }
+  }
+  else if(progress_node)
+  {
+    (*progress_node)->setTotalSteps(1);
+    (*progress_node)->advance();
+  }
+
+  overlap_plugins_ = std::move(plugin_names);
+  overlap_plugin_states_ = std::move(plugin_states);
+  overlaps_ = std::move(overlaps);
+  writeOverlaps();
+}
+
+void LootDeployer::readOverlaps()
+{
+  const sfs::path overlaps_path = dest_path_ / OVERLAPS_FILE_NAME;
+  if(!sfs::exists(overlaps_path))
+    return;
+
+  BinaryReader reader(overlaps_path);
+  if(reader.read<uint32_t>() != OVERLAPS_MAGIC_NUMBER ||
+     reader.read<uint32_t>() != OVERLAPS_FILE_VERSION)
+    throw ParseError("Unsupported file format: \"" + overlaps_path.string() + "\".");
+  const auto num_plugins = reader.read<uint32_t>();
+  std::vector<std::string> plugin_names;
+  std::map<std::string, PluginFileState> plugin_states;
+  for(uint32_t i = 0; i < num_plugins; i++)
+  {
+    const std::string name = reader.readString();
+    const auto size = reader.read<uint64_t>();
+    const auto time = reader.read<int64_t>();
+    plugin_names.push_back(name);
+    plugin_states[name] = { size, sfs::file_time_type(sfs::file_time_type::duration(time)) };
+  }
+  std::vector<std::vector<bool>> overlaps;
+  overlaps.reserve(num_plugins);
+  for(uint32_t i = 0; i < num_plugins; i++)
+  {
+    overlaps.push_back(reader.readBits());
+    if(overlaps.back().size() != num_plugins)
+      throw ParseError("Invalid overlap data in \"" + overlaps_path.string() + "\".");
+  }
+  overlap_plugins_ = std::move(plugin_names);
+  overlap_plugin_states_ = std::move(plugin_states);
+  overlaps_ = std::move(overlaps);
+}
+
+void LootDeployer::writeOverlaps() const
+{
+  const sfs::path overlaps_path = dest_path_ / OVERLAPS_FILE_NAME;
+  sfs::path temp_path = overlaps_path;
+  temp_path += ".tmp";
+  {
+    BinaryWriter writer(temp_path);
+    writer.write<uint32_t>(OVERLAPS_MAGIC_NUMBER);
+    writer.write<uint32_t>(OVERLAPS_FILE_VERSION);
+    writer.write<uint32_t>(overlap_plugins_.size());
+    for(const auto& name : overlap_plugins_)
+    {
+      const auto& [size, time] = overlap_plugin_states_.at(name);
+      writer.writeString(name);
+      writer.write<uint64_t>(size);
+      writer.write<int64_t>(time.time_since_epoch().count());
+    }
+    for(const auto& row : overlaps_)
+      writer.writeBits(row);
+    writer.flush();
+  }
+  sfs::rename(temp_path, overlaps_path);
+}
+
+LootDeployer::PluginFileState LootDeployer::getPluginFileState(const std::string& plugin) const
+{
+  const sfs::path plugin_path = source_path_ / plugin;
+  return { sfs::file_size(plugin_path), sfs::last_write_time(plugin_path) };
+}
+
+std::vector<std::optional<TesPluginHeader>> LootDeployer::readPluginHeaders(
+  const std::vector<std::string>& plugins) const
+{
+  const TesPluginHeader::Format format = getPluginFormat();
+  std::vector<std::optional<TesPluginHeader>> headers(plugins.size());
+  std::vector<std::string> errors(plugins.size());
+  {
+    ThreadPool pool;
+    std::vector<std::future<void>> results;
+    results.reserve(plugins.size());
+    for(int i = 0; i < plugins.size(); i++)
+    {
+      results.push_back(pool.submit(
+        [this, &plugins, &headers, &errors, format, i]()
+        {
+          try
+          {
+            headers[i] = TesPluginHeader(source_path_ / plugins[i], format);
+          }
+          catch(const ParseError& error)
+          {
+            errors[i] = error.what();
+          }
+        }));
+    }
+    for(auto& result : results)
+      result.get();
+  }
+  for(const auto& error : errors)
+  {
+    if(!error.empty())
+      log_(Log::LOG_WARNING, "LOOT: " + error);
+  }
+  return headers;
+}
+
+std::string LootDeployer::getPluginTypeTag(const std::string& plugin,
+                                           const std::optional<TesPluginHeader>& header) const
+{
+  std::string extension = sfs::path(plugin).extension().string();
+  str::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  const bool supports_light_plugins = LIGHT_PLUGIN_FLAGS.contains(app_type_);
+  // games which support light plugins also treat .esl and .esm files as masters
+  if(supports_light_plugins &&
+     (extension == ".esl" || (header && header->hasFlag(LIGHT_PLUGIN_FLAGS.at(app_type_)))))
+    return LIGHT_PLUGIN;
+  if((header && header->hasFlag(TesPluginHeader::MASTER_FLAG)) ||
+     (supports_light_plugins && extension == ".esm"))
+    return MASTER_PLUGIN;
+  return STANDARD_PLUGIN;
+}
+
+const PluginRecordIndex& LootDeployer::updateRecordIndex(std::optional<ProgressNode*> progress_node)
+{
+  const sfs::path index_path = dest_path_ / RECORD_INDEX_DIR_NAME;
+  if(!record_index_ || record_index_path_ != index_path)
+  {
+    record_index_ = std::make_unique<PluginRecordIndex>(index_path, getPluginFormat());
+    record_index_path_ = index_path;
+  }
+  std::vector<std::string> plugin_names;
+  plugin_names.reserve(plugins_.size());
+  for(const auto& [name, enabled] : plugins_)
+    plugin_names.push_back(name);
+  for(const auto& error : record_index_->update(source_path_, plugin_names, progress_node))
+    log_(Log::LOG_WARNING, "LOOT: " + error);
+  return *record_index_;
+}
+
+TesPluginHeader::Format LootDeployer::getPluginFormat() const
+{
+  if(app_type_ == loot::GameType::tes3 || app_type_ == loot::GameType::openmw)
+    return TesPluginHeader::Format::tes3;
+  if(app_type_ == loot::GameType::tes4)
+    return TesPluginHeader::Format::tes4;
+  return TesPluginHeader::Format::tes5;
 }
@@ -7,6 +7,8 @@
 #include "deployer.h"
 #include "loot/api.h"
 #include "plugindeployer.h"
+#include "pluginrecordindex.h"
+#include "tespluginheader.h"
 #include <json/json.h>
 
 
@@ -115,8 +117,19 @@ public:
   virtual std::map<std::string, int> getAutoTagMap() override;
 
 protected:
+  /*! \brief Size and modification time of a plugin file. */
+  using PluginFileState = std::pair<std::uintmax_t, std::filesystem::file_time_type>;
+
   /*! \brief Name of the file containing plugin load order. */
   static constexpr std::string LOADORDER_FILE_NAME = "loadorder.txt";
+  /*! \brief Name of the file containing the plugin overlap matrix. */
+  static constexpr std::string OVERLAPS_FILE_NAME = ".loot_overlaps";
+  /*! \brief Identifies the overlaps file. */
+  static constexpr uint32_t OVERLAPS_MAGIC_NUMBER = 0x4f4c544c;
+  /*! \brief Current version of the overlaps file format. */
+  static constexpr uint32_t OVERLAPS_FILE_VERSION = 1;
+  /*! \brief Name of the directory containing the cache of \ref record_index_. */
+  static constexpr std::string RECORD_INDEX_DIR_NAME = ".loot_records";
   /*! \brief Maps supported game type to a path to a file unique to that type. */
   static inline const std::map<loot::GameType, std::filesystem::path> TYPE_IDENTIFIERS = {
     { loot::GameType::fo3, "Fallout3.esm" },
@@ -144,6 +157,12 @@ protected:
     { loot::GameType::tes4, "Plugins.txt" },      { loot::GameType::tes5, "plugins.txt" },
     { loot::GameType::tes5se, "plugins.txt" },    { loot::GameType::tes5vr, "plugins.txt" }
   };
+  /*! \brief Maps app types which support light plugins to the header flag used to mark them. */
+  static inline const std::map<loot::GameType, uint32_t> LIGHT_PLUGIN_FLAGS = {
+    { loot::GameType::fo4, 0x200 },   { loot::GameType::fo4vr, 0x200 },
+    { loot::GameType::tes5se, 0x200 }, { loot::GameType::tes5vr, 0x200 },
+    { loot::GameType::starfield, 0x100 }
+  };
   /*! \brief All app types which use file modification times as plugin load order. */
   static inline const std::set<loot::GameType> APP_TYPE_WITH_FILE_MOD_ORDER = {
     loot::GameType::fo3,
@@ -165,6 +184,40 @@ protected:
   int num_master_plugins_ = 0;
   /*! \brief Current number of standard plugins. */
   int num_standard_plugins_ = 0;
+  /*!
+   * \brief Long lived loot handle. Plugins and lists loaded into this handle are reused
+   * until they change on disk.
+   */
+  std::unique_ptr<loot::GameInterface> loot_handle_;
+  /*! \brief Source path used to create \ref loot_handle_. */
+  std::filesystem::path loot_handle_source_path_;
+  /*! \brief Target path used to create \ref loot_handle_. */
+  std::filesystem::path loot_handle_dest_path_;
+  /*!
+   * \brief Maps names of all plugins loaded into \ref loot_handle_ to their file size and
+   * modification time at the time of loading.
+   */
+  mutable std::map<std::string, PluginFileState> loaded_plugin_states_;
+  /*!
+   * \brief Maps paths of the masterlist, prelude and userlist loaded into \ref loot_handle_
+   * to their modification time at the time of loading.
+   */
+  std::map<std::filesystem::path, std::filesystem::file_time_type> loaded_list_times_;
+  /*! \brief Names of all plugins in \ref overlaps_, in the order used to index it. */
+  std::vector<std::string> overlap_plugins_;
+  /*! \brief Maps names of all plugins in \ref overlaps_ to their state when it was computed. */
+  mutable std::map<std::string, PluginFileState> overlap_plugin_states_;
+  /*!
+   * \brief For every pair of plugins: True if both plugins share at least one record.
+   * Indexed in the order given by \ref overlap_plugins_.
+   */
+  std::vector<std::vector<bool>> overlaps_;
+  /*! \brief If true: \ref overlaps_ has been read from disk. */
+  bool overlaps_read_ = false;
+  /*! \brief Maps records to the plugins containing them. Created on first use. */
+  std::unique_ptr<PluginRecordIndex> record_index_;
+  /*! \brief Cache directory used by \ref record_index_. */
+  std::filesystem::path record_index_path_;
 
   /*! \brief Writes current load order to plugins.txt and loadorder.txt. */
   virtual void writePlugins() const override;
@@ -200,4 +253,72 @@ protected:
   void resetSettingsPrivate();
   /*! \brief Updates the loot plugin tags for every currently loaded plugin. */
   void updatePluginTagsPrivate();
+  /*!
+   * \brief Returns \ref loot_handle_. Creates a new handle if none exists, if the source
+   * or target path has changed since it has been created or if plugins loaded into it have
+   * since been removed from \ref plugins_.
+   * \return The handle.
+   */
+  loot::GameInterface& getLootHandle();
+  /*!
+   * \brief Loads all plugins in \ref plugins_ into \ref loot_handle_. Plugins which have
+   * already been loaded are only reloaded if their size or modification time has changed.
+   */
+  void loadChangedPlugins();
+  /*!
+   * \brief Loads the masterlist, prelude and userlist into \ref loot_handle_, if they
+   * have changed since they were last loaded.
+   * \param master_list_path Path to the masterlist.yaml.
+   * \param prelude_path Path to the prelude.yaml. An empty path indicates no prelude.
+   * \param user_list_path Path to the userlist.yaml. An empty path indicates no userlist.
+   */
+  void loadChangedLists(const std::filesystem::path& master_list_path,
+                        const std::filesystem::path& prelude_path,
+                        const std::filesystem::path& user_list_path);
+  /*!
+   * \brief Updates \ref overlaps_ to match \ref plugins_. Only overlaps of plugins which
+   * are new or whose files have changed are recomputed, using \ref record_index_.
+   * Saves the result to disk if anything changed.
+   * \param progress_node Used to inform about the current progress.
+   */
+  void updateOverlaps(std::optional<ProgressNode*> progress_node = {});
+  /*! \brief Reads \ref overlaps_ from disk. */
+  void readOverlaps();
+  /*! \brief Writes \ref overlaps_ to disk. */
+  void writeOverlaps() const;
+  /*!
+   * \brief Updates \ref record_index_ to contain all plugins in \ref plugins_, in that order.
+   * Creates the index if necessary. Allows derived classes to find plugins which
+   * share records.
+   * \param progress_node Used to inform about the current progress.
+   * \return The updated index.
+   */
+  const PluginRecordIndex& updateRecordIndex(std::optional<ProgressNode*> progress_node = {});
+  /*!
+   * \brief Returns the layout of plugin files for the current app type.
+   * \return The format.
+   */
+  TesPluginHeader::Format getPluginFormat() const;
+  /*!
+   * \brief Reads the header records of the given plugins in parallel.
+   * \param plugins Names of the plugins.
+   * \return For every plugin: The header, or an empty optional if it could not be read.
+   */
+  std::vector<std::optional<TesPluginHeader>> readPluginHeaders(
+    const std::vector<std::string>& plugins) const;
+  /*!
+   * \brief Determines the type tag of the given plugin. Like libloot, games with light plugins
+   * treat every .esl file as light and every .esm file as master, regardless of header flags.
+   * \param plugin Name of the plugin.
+   * \param header Header of the plugin. If empty: The plugin is considered a standard plugin.
+   * \return One of \ref LIGHT_PLUGIN, \ref MASTER_PLUGIN and \ref STANDARD_PLUGIN.
+   */
+  std::string getPluginTypeTag(const std::string& plugin,
+                               const std::optional<TesPluginHeader>& header) const;
+  /*!
+   * \brief Returns the size and modification time of the given plugin.
+   * \param plugin Name of the plugin.
+   * \return The state.
+   */
+  PluginFileState getPluginFileState(const std::string& plugin) const;
 };
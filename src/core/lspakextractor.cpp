@@ -1,22 +1,32 @@
 #include "lspakextractor.h"
+#include "threadpool.h"
+#include <cstring>
 #include <format>
 #include <fstream>
-#include <iostream>
 #include <lz4.h>
 #include <vector>
-#include <zstd.h>
-#include <zlib.h>
 
 namespace sfs = std::filesystem;
 
 
 LsPakExtractor::LsPakExtractor(const sfs::path& source_path) : source_path_(source_path) {}
 
+LsPakExtractor::~LsPakExtractor()
+{
+  if(zstd_context_)
+    ZSTD_freeDCtx(zstd_context_);
+  if(zlib_stream_initialized_)
+    inflateEnd(&zlib_stream_);
+}
+
 void LsPakExtractor::init()
 {
-  std::ifstream file(source_path_, std::ios::binary);
+  archive_ = std::make_unique<MappedFile>(source_path_);
+  if(archive_->size() < sizeof(LsPakHeader))
+    throw std::runtime_error(
+      std::format("File is too small to be a .pak archive: {}B.", archive_->size()));
   header_ = std::make_unique<LsPakHeader>();
-  file.read(reinterpret_cast<char*>(header_.get()), sizeof(LsPakHeader));
+  std::memcpy(header_.get(), archive_->data(), sizeof(LsPakHeader));
 
   if(static_cast<unsigned int>(header_->magic_number) != LS_PAK_MAGIC_HEADER_NUMBER)
     throw std::runtime_error(std::format("Unknown file format with magic number: {}",
@@ -36,97 +46,266 @@ void LsPakExtractor::init()
   }
 }
 
-std::string LsPakExtractor::extractData(unsigned long offset,
-                                        unsigned int length,
-                                        unsigned int uncompressed_size,
-                                        int compression_type)
+std::string_view LsPakExtractor::extractData(unsigned long offset,
+                                             unsigned int length,
+                                             unsigned int uncompressed_size,
+                                             int compression_type,
+                                             int archive_part)
 {
   // this is used to extract xml files; they should never exceed 1GiB
   if(uncompressed_size > 1 << 30)
     throw std::runtime_error(std::format("Uncompressed file size is too large: {}B.", uncompressed_size));
+  const MappedFile& archive = getArchivePart(archive_part);
+  if(offset > archive.size() || length > archive.size() - offset)
+    throw std::runtime_error(std::format(
+      "Data at offset {} with size {}B exceeds the archive size.", offset, length));
 
-  std::ifstream file(source_path_, std::ios::binary);
-  std::vector<char> input_buffer(length);
-  file.seekg(offset);
-  file.read(input_buffer.data(), length);
-
+  const char* input = archive.data() + offset;
   if(compression_type == COMPRESSION_NONE)
-    return { input_buffer.data(), length };
-  else if(compression_type == COMPRESSION_LZ4)
+    return { input, length };
+
+  if(output_buffer_.size() < uncompressed_size)
+    output_buffer_.resize(uncompressed_size);
+  if(compression_type == COMPRESSION_LZ4)
   {
-    std::vector<char> output_buffer(uncompressed_size);
     int ret_code = LZ4_decompress_safe_partial(
-      input_buffer.data(), output_buffer.data(), length, uncompressed_size, uncompressed_size);
+      input, output_buffer_.data(), length, uncompressed_size, uncompressed_size);
     if(ret_code < 0)
       throw std::runtime_error(std::format("LZ4 decompression failed with code: {}", ret_code));
-
-    return { output_buffer.data(), uncompressed_size };
   }
   else if(compression_type == COMPRESSION_ZSTD)
   {
-    std::vector<char> output_buffer(uncompressed_size);
-    const size_t actual_size = ZSTD_decompress(reinterpret_cast<void*>(output_buffer.data()),
-                                               uncompressed_size,
-                                               reinterpret_cast<const void*>(input_buffer.data()),
-                                               input_buffer.size());
+    if(!zstd_context_)
+    {
+      zstd_context_ = ZSTD_createDCtx();
+      if(!zstd_context_)
+        throw std::runtime_error("zstd initialization failed.");
+    }
+    const size_t actual_size = ZSTD_decompressDCtx(zstd_context_,
+                                                   reinterpret_cast<void*>(output_buffer_.data()),
+                                                   uncompressed_size,
+                                                   reinterpret_cast<const void*>(input),
+                                                   length);
     if(ZSTD_isError(actual_size))
       throw std::runtime_error(std::format("zstd decompression failed with code: {}", actual_size));
-    return { output_buffer.data(), uncompressed_size };
   }
   else if(compression_type == COMPRESSION_ZLIB)
   {
-    z_stream stream;
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-    if (inflateInit(&stream) != Z_OK)
+    if(!zlib_stream_initialized_)
+    {
+      zlib_stream_.zalloc = Z_NULL;
+      zlib_stream_.zfree = Z_NULL;
+      zlib_stream_.opaque = Z_NULL;
+      if(inflateInit(&zlib_stream_) != Z_OK)
+        throw std::runtime_error("zlib initialization failed.");
+      zlib_stream_initialized_ = true;
+    }
+    else if(inflateReset(&zlib_stream_) != Z_OK)
       throw std::runtime_error("zlib initialization failed.");
-    stream.avail_in = input_buffer.size();
-    stream.next_in = reinterpret_cast<Bytef*>(input_buffer.data());
-
-    std::vector<char> output_buffer(uncompressed_size);
-    stream.avail_out = uncompressed_size;
-    stream.next_out = reinterpret_cast<Bytef*>(output_buffer.data());
-    inflateInit(&stream);
-    int code = inflate(&stream, Z_NO_FLUSH);
-    inflateEnd(&stream);
+    zlib_stream_.avail_in = length;
+    zlib_stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+    zlib_stream_.avail_out = uncompressed_size;
+    zlib_stream_.next_out = reinterpret_cast<Bytef*>(output_buffer_.data());
+    int code = inflate(&zlib_stream_, Z_NO_FLUSH);
     if(code < 0)
       throw std::runtime_error(std::format("zlib decompression failed with code: {}", code));
-    return { output_buffer.data(), uncompressed_size };
   }
   else
     throw std::runtime_error(std::format("Unsopported compression type: {}", compression_type));
+  return { output_buffer_.data(), uncompressed_size };
 }
 
 std::vector<std::filesystem::path> LsPakExtractor::getFileList()
 {
   std::vector<sfs::path> path_list;
+  path_list.reserve(file_list_.size());
   for(const auto& f : file_list_)
-    path_list.emplace_back(f.path);
+    path_list.emplace_back(getEntryPath(f));
   return path_list;
 }
 
 std::string LsPakExtractor::extractFile(int file_id)
+{
+  return std::string(extractFileView(file_id));
+}
+
+std::string_view LsPakExtractor::extractFileView(int file_id)
 {
   const auto& file = file_list_[file_id];
-  return extractData(
-    file.offset, file.compressed_size, file.uncompressed_size, file.flags & COMPRESSION_MASK);
+  return extractData(file.offset,
+                     file.compressed_size,
+                     file.uncompressed_size,
+                     file.flags & COMPRESSION_MASK,
+                     file.archive_part);
+}
+
+void LsPakExtractor::extractAll(const sfs::path& dest_path,
+                                std::optional<ProgressNode*> progress_node)
+{
+  if(progress_node)
+    (*progress_node)->setTotalSteps(file_list_.size());
+  std::vector<const MappedFile*> archives;
+  std::vector<sfs::path> dest_files;
+  archives.reserve(file_list_.size());
+  dest_files.reserve(file_list_.size());
+  for(const auto& entry : file_list_)
+  {
+    const sfs::path path = sfs::path(getEntryPath(entry)).lexically_normal();
+    if(path.empty() || path.is_absolute() || *path.begin() == "..")
+      throw std::runtime_error(
+        std::format("Invalid file path in archive: '{}'.", getEntryPath(entry)));
+    archives.push_back(&getArchivePart(entry.archive_part));
+    dest_files.push_back(dest_path / path);
+  }
+
+  ThreadPool pool;
+  std::vector<std::future<void>> results;
+  results.reserve(file_list_.size());
+  for(int i = 0; i < file_list_.size(); i++)
+  {
+    results.push_back(pool.submit([this, &archives, &dest_files, i]()
+                                  { extractEntry(file_list_[i], *archives[i], dest_files[i]); }));
+  }
+  std::exception_ptr error;
+  for(auto& result : results)
+  {
+    try
+    {
+      result.get();
+    }
+    catch(...)
+    {
+      if(!error)
+        error = std::current_exception();
+    }
+    if(progress_node)
+      (*progress_node)->advance();
+  }
+  if(error)
+    std::rethrow_exception(error);
+}
+
+std::string LsPakExtractor::getEntryPath(const LsPakFileListEntry& entry)
+{
+  return std::string(entry.path, strnlen(entry.path, sizeof(entry.path)));
+}
+
+const MappedFile& LsPakExtractor::getArchivePart(int archive_part)
+{
+  if(archive_part == 0)
+    return *archive_;
+  if(archive_part >= header_->num_parts)
+    throw std::runtime_error(std::format("Invalid archive part: {}.", archive_part));
+  if(archive_parts_.size() < archive_part)
+    archive_parts_.resize(archive_part);
+  auto& part = archive_parts_[archive_part - 1];
+  if(!part)
+  {
+    sfs::path part_path = source_path_.parent_path() / source_path_.stem();
+    part_path += std::format("_{}", archive_part);
+    part_path += source_path_.extension();
+    part = std::make_unique<MappedFile>(part_path);
+  }
+  return *part;
+}
+
+void LsPakExtractor::extractEntry(const LsPakFileListEntry& entry,
+                                  const MappedFile& archive,
+                                  const sfs::path& dest_file)
+{
+  const int compression_type = entry.flags & COMPRESSION_MASK;
+  const unsigned long offset = entry.offset;
+  const unsigned int length = entry.compressed_size;
+  if(offset > archive.size() || length > archive.size() - offset)
+    throw std::runtime_error(std::format("Data for '{}' exceeds the archive size.",
+                                         getEntryPath(entry)));
+  const char* input = archive.data() + offset;
+
+  sfs::create_directories(dest_file.parent_path());
+  std::ofstream out(dest_file, std::ios::binary);
+  if(!out.is_open())
+    throw std::runtime_error(std::format("Could not write to '{}'.", dest_file.string()));
+
+  constexpr size_t chunk_size = 1 << 20;
+  if(compression_type == COMPRESSION_NONE)
+    out.write(input, length);
+  else if(compression_type == COMPRESSION_LZ4)
+  {
+    // lz4 blocks can not be decompressed in chunks
+    std::vector<char> output(entry.uncompressed_size);
+    const int ret_code = LZ4_decompress_safe(input, output.data(), length, output.size());
+    if(ret_code < 0 || ret_code != output.size())
+      throw std::runtime_error(std::format("LZ4 decompression of '{}' failed with code: {}",
+                                           getEntryPath(entry),
+                                           ret_code));
+    out.write(output.data(), output.size());
+  }
+  else if(compression_type == COMPRESSION_ZSTD)
+  {
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(),
+                                                                 ZSTD_freeDCtx);
+    if(!context)
+      throw std::runtime_error("zstd initialization failed.");
+    std::vector<char> output(chunk_size);
+    ZSTD_inBuffer in_buffer{ input, length, 0 };
+    size_t ret_code = 1;
+    while(ret_code != 0)
+    {
+      ZSTD_outBuffer out_buffer{ output.data(), output.size(), 0 };
+      ret_code = ZSTD_decompressStream(context.get(), &out_buffer, &in_buffer);
+      if(ZSTD_isError(ret_code))
+        throw std::runtime_error(std::format("zstd decompression of '{}' failed with code: {}",
+                                             getEntryPath(entry),
+                                             ret_code));
+      out.write(output.data(), out_buffer.pos);
+      if(ret_code != 0 && out_buffer.pos == 0 && in_buffer.pos == in_buffer.size)
+        throw std::runtime_error(
+          std::format("zstd decompression of '{}' failed: Data is truncated.", getEntryPath(entry)));
+    }
+  }
+  else if(compression_type == COMPRESSION_ZLIB)
+  {
+    z_stream stream{};
+    if(inflateInit(&stream) != Z_OK)
+      throw std::runtime_error("zlib initialization failed.");
+    std::unique_ptr<z_stream, decltype(&inflateEnd)> stream_guard(&stream, inflateEnd);
+    stream.avail_in = length;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+    std::vector<char> output(chunk_size);
+    int code = Z_OK;
+    while(code != Z_STREAM_END)
+    {
+      stream.avail_out = output.size();
+      stream.next_out = reinterpret_cast<Bytef*>(output.data());
+      code = inflate(&stream, Z_NO_FLUSH);
+      if(code < 0 || code == Z_NEED_DICT)
+        throw std::runtime_error(std::format("zlib decompression of '{}' failed with code: {}",
+                                             getEntryPath(entry),
+                                             code));
+      out.write(output.data(), output.size() - stream.avail_out);
+    }
+  }
+  else
+    throw std::runtime_error(std::format("Unsopported compression type: {}", compression_type));
+  if(!out)
+    throw std::runtime_error(std::format("Could not write to '{}'.", dest_file.string()));
 }
 
 unsigned int LsPakExtractor::readFileList()
 {
-  std::ifstream file(source_path_, std::ios::binary);
-  file.seekg(header_->file_list_offset);
-  std::vector<char> buffer(4);
-  file.read(buffer.data(), 4);
-  unsigned int num_files = *reinterpret_cast<unsigned int*>(buffer.data());
-  file.read(buffer.data(), 4);
-  unsigned int compressed_size = *reinterpret_cast<unsigned int*>(buffer.data());
-  std::string data = extractData(
-    file.tellg(), compressed_size, sizeof(LsPakFileListEntry) * num_files, COMPRESSION_LZ4);
-
-  file_list_.clear();
-  for(int i = 0; i < sizeof(LsPakFileListEntry) * num_files; i += sizeof(LsPakFileListEntry))
-    file_list_.push_back(*reinterpret_cast<LsPakFileListEntry*>(data.data() + i));
+  const unsigned long offset = header_->file_list_offset;
+  if(offset > archive_->size() || archive_->size() - offset < 8)
+    throw std::runtime_error("File list offset exceeds the archive size.");
+  unsigned int num_files;
+  unsigned int compressed_size;
+  std::memcpy(&num_files, archive_->data() + offset, 4);
+  std::memcpy(&compressed_size, archive_->data() + offset + 4, 4);
+  if(num_files > (1 << 30) / sizeof(LsPakFileListEntry))
+    throw std::runtime_error(std::format("Invalid number of files: {}", num_files));
+  const std::string_view data = extractData(
+    offset + 8, compressed_size, sizeof(LsPakFileListEntry) * num_files, COMPRESSION_LZ4);
+
+  file_list_.resize(num_files);
+  std::memcpy(file_list_.data(), data.data(), sizeof(LsPakFileListEntry) * num_files);
   return compressed_size;
 }
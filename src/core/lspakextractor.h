@@ -7,23 +7,54 @@
 
 #include "lspakfilelistentry.h"
 #include "lspakheader.h"
+#include "mappedfile.h"
+#include "progressnode.h"
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
+#include <zlib.h>
+#include <zstd.h>
 
 
 /*!
  * \brief Class providing functions for extracting files from a .pak archive used for Baldurs Gate 3.
+ *
+ * The archive is mapped into memory once during init(). Uncompressed files are returned as
+ * views into that mapping, decompressed files are written to a buffer which is reused for
+ * every extraction, as are the decompression contexts.
  */
 class LsPakExtractor
 {
 public:
+  /*! \brief Mask used to get compression type from file list entry flags. */
+  static constexpr int COMPRESSION_MASK = 0xf;
+  /*! \brief Indicates file is uncompressed. */
+  static constexpr int COMPRESSION_NONE = 0;
+  /*! \brief Indicates file is compressed using zlib. */
+  static constexpr int COMPRESSION_ZLIB = 1;
+  /*! \brief Indicates file is compressed using lz4. */
+  static constexpr int COMPRESSION_LZ4 = 2;
+  /*! \brief Indicates file is compressed using zstd. */
+  static constexpr int COMPRESSION_ZSTD = 3;
+  /*! \brief Indicates file is a supported .pak archive. */
+  static constexpr unsigned int LS_PAK_MAGIC_HEADER_NUMBER = 0x4b50534c;
+  /*! \brief Currently the only supported archive format version. */
+  static constexpr unsigned int LS_PAK_SUPPORTED_VERSION = 18;
+
   /*!
    * \brief Sets the archive path to the given path.
    * \param source_path Target archive path.
    */
   LsPakExtractor(const std::filesystem::path& source_path);
+  /*! \brief Frees all decompression contexts. */
+  ~LsPakExtractor();
+  LsPakExtractor(const LsPakExtractor&) = delete;
+  LsPakExtractor& operator=(const LsPakExtractor&) = delete;
 
-  /*! \brief Initializes header and file list from the source archive. */
+  /*! \brief Maps the source archive and initializes header and file list from it. */
   void init();
   /*!
    * \brief Returns a vector of paths to files in the archive.
@@ -36,28 +67,51 @@ public:
    * \return The uncompressed file as a string.
    */
   std::string extractFile(int file_id);
+  /*!
+   * \brief Decompresses a file in the archive without copying it.
+   * \param file_id Index of the file to the extracted.
+   * \return A view of the uncompressed file. This is only valid until the next extraction
+   * and as long as this object exists.
+   */
+  std::string_view extractFileView(int file_id);
+  /*!
+   * \brief Extracts every file in the archive to the given directory. Files are decompressed
+   * in parallel and streamed to disk, so their size is only limited by the archive format.
+   * \param dest_path Target directory.
+   * \param progress_node Used to inform about the current progress.
+   * \throws std::runtime_error When a file can not be extracted.
+   */
+  void extractAll(const std::filesystem::path& dest_path,
+                  std::optional<ProgressNode*> progress_node = {});
+  /*!
+   * \brief Returns the path of the given file list entry inside of the archive.
+   * \param entry Target entry.
+   * \return The path.
+   */
+  static std::string getEntryPath(const LsPakFileListEntry& entry);
 
 private:
-  /*! \brief Mask used to get compression type from file list entry flags. */
-  static constexpr int COMPRESSION_MASK = 0xf;
-  /*! \brief Indicates file is uncompressed. */
-  static constexpr int COMPRESSION_NONE = 0;
-  /*! \brief Indicates file is compressed using zlib. */
-  static constexpr int COMPRESSION_ZLIB = 1;
-  /*! \brief Indicates file is compressed using lz4. */
-  static constexpr int COMPRESSION_LZ4 = 2;
-  /*! \brief Indicates file is compressed using zstd. */
-  static constexpr int COMPRESSION_ZSTD = 3;
-  /*! \brief Indicates file is a supported .pak archive. */
-  static constexpr unsigned int LS_PAK_MAGIC_HEADER_NUMBER = 0x4b50534c;
-  /*! \brief Currently the only supported archive format version. */
-  static constexpr unsigned int LS_PAK_SUPPORTED_VERSION = 18;
   /*! \brief Path to the source archive. */
   std::filesystem::path source_path_;
   /*! \brief Contains the archive's header. */
   std::unique_ptr<LsPakHeader> header_;
   /*! \brief Contains all file list entries of the archive. */
   std::vector<LsPakFileListEntry> file_list_;
+  /*! \brief The memory mapped source archive. */
+  std::unique_ptr<MappedFile> archive_;
+  /*!
+   * \brief Additional parts of a multi part archive, mapped on first use. Index 0 refers to
+   * part 1, which is stored in a file called "<name>_1.pak".
+   */
+  std::vector<std::unique_ptr<MappedFile>> archive_parts_;
+  /*! \brief Holds the most recently decompressed data. */
+  std::vector<char> output_buffer_;
+  /*! \brief Context reused for every zstd decompression. */
+  ZSTD_DCtx* zstd_context_ = nullptr;
+  /*! \brief Stream reused for every zlib decompression. */
+  z_stream zlib_stream_{};
+  /*! \brief True if \ref zlib_stream_ has been initialized. */
+  bool zlib_stream_initialized_ = false;
 
   /*!
    * \brief Extracts and, if necessary, decompresses data from the source archive.
@@ -65,12 +119,30 @@ private:
    * \param length Number of bytes to read.
    * \param uncompressed_size Uncompressed size of the data.
    * \param compression_type Compression type used.
-   * \return The uncompressed data as a string.
+   * \param archive_part Part of the archive containing the data.
+   * \return A view of the uncompressed data. This is only valid until the next extraction.
+   */
+  std::string_view extractData(unsigned long offset,
+                               unsigned int length,
+                               unsigned int uncompressed_size,
+                               int compression_type,
+                               int archive_part = 0);
+  /*!
+   * \brief Returns the given part of the archive, mapping it if necessary.
+   * \param archive_part Target part.
+   * \return The mapped part.
+   */
+  const MappedFile& getArchivePart(int archive_part);
+  /*!
+   * \brief Decompresses the given file list entry and writes it to the given path.
+   * Uses its own decompression contexts, so multiple entries can be extracted concurrently.
+   * \param entry Entry to extract.
+   * \param archive Archive part containing the entry.
+   * \param dest_file Target file.
    */
-  std::string extractData(unsigned long offset,
-                          unsigned int length,
-                          unsigned int uncompressed_size,
-                          int compression_type);
+  static void extractEntry(const LsPakFileListEntry& entry,
+                           const MappedFile& archive,
+                           const std::filesystem::path& dest_file);
   /*!
    * \brief Reads the file list from the source archive and initializes file_list_.
    * \return The compressed size of the file list.
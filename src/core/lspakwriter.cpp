@@ -0,0 +1,191 @@
+#include "lspakwriter.h"
+#include "lspakextractor.h"
+#include "mappedfile.h"
+#include "pathutils.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <lz4.h>
+
+namespace sfs = std::filesystem;
+namespace str = std::ranges;
+namespace pu = path_utils;
+
+
+LsPakWriter::LsPakWriter(const sfs::path& archive_path, int compression_type) :
+  archive_path_(archive_path), compression_type_(compression_type)
+{
+  if(compression_type < LsPakExtractor::COMPRESSION_NONE ||
+     compression_type > LsPakExtractor::COMPRESSION_ZSTD)
+    throw std::runtime_error(std::format("Unsopported compression type: {}", compression_type));
+}
+
+void LsPakWriter::addFile(const sfs::path& source_file, const std::string& archive_path)
+{
+  if(archive_path.size() >= sizeof(LsPakFileListEntry::path))
+    throw std::runtime_error(std::format("Path is too long for a .pak archive: '{}'.", archive_path));
+  auto iter = file_ids_.find(archive_path);
+  if(iter != file_ids_.end())
+  {
+    files_[iter->second].source_file = source_file;
+    return;
+  }
+  file_ids_[archive_path] = files_.size();
+  files_.emplace_back(source_file, archive_path);
+}
+
+void LsPakWriter::addDirectory(const sfs::path& source_dir)
+{
+  std::vector<sfs::path> source_files;
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(source_dir))
+  {
+    if(dir_entry.is_regular_file())
+      source_files.push_back(dir_entry.path());
+  }
+  // directory order is unspecified, sort to make archives reproducible
+  str::sort(source_files);
+  for(const auto& source_file : source_files)
+    addFile(source_file, sfs::path(pu::getRelativePath(source_file, source_dir)).generic_string());
+}
+
+void LsPakWriter::write(std::optional<ProgressNode*> progress_node)
+{
+  if(progress_node)
+    (*progress_node)->setTotalSteps(files_.size());
+  sfs::path temp_path = archive_path_;
+  temp_path += ".tmp";
+  try
+  {
+    std::ofstream file(temp_path, std::ios::binary);
+    if(!file.is_open())
+      throw std::runtime_error(std::format("Could not write to '{}'.", temp_path.string()));
+    LsPakHeader header{};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<LsPakFileListEntry> file_list(files_.size());
+    {
+      ThreadPool pool;
+      const int max_pending_files = pool.numThreads() * FILES_PER_THREAD;
+      std::deque<std::future<CompressedFile>> pending_files;
+      int next_file = 0;
+      for(int i = 0; i < files_.size(); i++)
+      {
+        while(next_file < files_.size() && pending_files.size() < max_pending_files)
+        {
+          const sfs::path& source_file = files_[next_file].source_file;
+          pending_files.push_back(pool.submit(
+            [&source_file, this]() { return compressFile(source_file, compression_type_); }));
+          next_file++;
+        }
+        const CompressedFile compressed_file = pending_files.front().get();
+        pending_files.pop_front();
+
+        auto& entry = file_list[i];
+        std::memcpy(entry.path, files_[i].archive_path.data(), files_[i].archive_path.size());
+        entry.offset = static_cast<uint64_t>(file.tellp());
+        entry.archive_part = 0;
+        entry.flags = compressed_file.compression_type == LsPakExtractor::COMPRESSION_NONE
+                        ? LsPakExtractor::COMPRESSION_NONE
+                        : compressed_file.compression_type | COMPRESSION_LEVEL_DEFAULT;
+        entry.compressed_size = compressed_file.data.size();
+        entry.uncompressed_size = compressed_file.uncompressed_size;
+        file.write(compressed_file.data.data(), compressed_file.data.size());
+        if(progress_node)
+          (*progress_node)->advance();
+      }
+    }
+
+    const uint64_t file_list_offset = file.tellp();
+    const int file_list_size = file_list.size() * sizeof(LsPakFileListEntry);
+    std::vector<char> compressed_file_list(LZ4_compressBound(file_list_size));
+    const int compressed_size = LZ4_compress_default(reinterpret_cast<const char*>(file_list.data()),
+                                                     compressed_file_list.data(),
+                                                     file_list_size,
+                                                     compressed_file_list.size());
+    if(compressed_size <= 0)
+      throw std::runtime_error("Failed to compress the file list.");
+    const uint32_t num_files = file_list.size();
+    file.write(reinterpret_cast<const char*>(&num_files), sizeof(num_files));
+    file.write(reinterpret_cast<const char*>(&compressed_size), sizeof(uint32_t));
+    file.write(compressed_file_list.data(), compressed_size);
+
+    header.magic_number = LsPakExtractor::LS_PAK_MAGIC_HEADER_NUMBER;
+    header.version = LsPakExtractor::LS_PAK_SUPPORTED_VERSION;
+    header.file_list_offset = file_list_offset;
+    header.file_list_size = compressed_size + 8;
+    header.num_parts = 1;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    if(!file)
+      throw std::runtime_error(std::format("Could not write to '{}'.", temp_path.string()));
+  }
+  catch(...)
+  {
+    sfs::remove(temp_path);
+    throw;
+  }
+  sfs::rename(temp_path, archive_path_);
+}
+
+LsPakWriter::CompressedFile LsPakWriter::compressFile(const sfs::path& source_file,
+                                                      int compression_type)
+{
+  const MappedFile source(source_file, true);
+  if(source.size() > std::numeric_limits<uint32_t>::max())
+    throw std::runtime_error(
+      std::format("File is too large for a .pak archive: '{}'.", source_file.string()));
+  const char* data = source.data();
+  const size_t size = source.size();
+
+  CompressedFile compressed_file{ {}, static_cast<uint32_t>(size), compression_type };
+  if(compression_type == LsPakExtractor::COMPRESSION_LZ4 && size <= LZ4_MAX_INPUT_SIZE)
+  {
+    compressed_file.data.resize(LZ4_compressBound(size));
+    const int compressed_size =
+      LZ4_compress_default(data, compressed_file.data.data(), size, compressed_file.data.size());
+    if(compressed_size <= 0)
+      throw std::runtime_error(
+        std::format("LZ4 compression of '{}' failed.", source_file.string()));
+    compressed_file.data.resize(compressed_size);
+  }
+  else if(compression_type == LsPakExtractor::COMPRESSION_ZSTD)
+  {
+    compressed_file.data.resize(ZSTD_compressBound(size));
+    const size_t compressed_size = ZSTD_compress(
+      compressed_file.data.data(), compressed_file.data.size(), data, size, ZSTD_CLEVEL_DEFAULT);
+    if(ZSTD_isError(compressed_size))
+      throw std::runtime_error(std::format(
+        "zstd compression of '{}' failed with code: {}", source_file.string(), compressed_size));
+    compressed_file.data.resize(compressed_size);
+  }
+  else if(compression_type == LsPakExtractor::COMPRESSION_ZLIB)
+  {
+    uLongf compressed_size = compressBound(size);
+    compressed_file.data.resize(compressed_size);
+    const int code = compress2(reinterpret_cast<Bytef*>(compressed_file.data.data()),
+                               &compressed_size,
+                               reinterpret_cast<const Bytef*>(data),
+                               size,
+                               Z_DEFAULT_COMPRESSION);
+    if(code != Z_OK)
+      throw std::runtime_error(
+        std::format("zlib compression of '{}' failed with code: {}", source_file.string(), code));
+    compressed_file.data.resize(compressed_size);
+  }
+  else
+    compressed_file.compression_type = LsPakExtractor::COMPRESSION_NONE;
+
+  if(compressed_file.compression_type != LsPakExtractor::COMPRESSION_NONE &&
+     compressed_file.data.size() < size)
+    return compressed_file;
+  // uncompressed files are stored with an uncompressed size of 0
+  compressed_file.data.assign(data, data + size);
+  compressed_file.uncompressed_size = 0;
+  compressed_file.compression_type = LsPakExtractor::COMPRESSION_NONE;
+  return compressed_file;
+}
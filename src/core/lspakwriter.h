@@ -0,0 +1,100 @@
+/*!
+ * \file lspakwriter.h
+ * \brief Header for the LsPakWriter class
+ */
+
+#pragma once
+
+#include "progressnode.h"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*!
+ * \brief Packs loose files into a .pak archive used for Baldurs Gate 3.
+ *
+ * Archives are written in version 18 of the format, which is the version read by
+ * LsPakExtractor. Files are compressed in parallel. Files which do not get smaller when
+ * compressed are stored uncompressed.
+ */
+class LsPakWriter
+{
+public:
+  /*!
+   * \brief Constructor.
+   * \param archive_path Path of the archive to be written.
+   * \param compression_type Compression used for all files. Must be one of the compression
+   * types defined in LsPakExtractor.
+   */
+  LsPakWriter(const std::filesystem::path& archive_path, int compression_type);
+
+  /*!
+   * \brief Adds a file to the archive. If a file with the same path inside the archive has
+   * already been added, it is replaced.
+   * \param source_file File on disk.
+   * \param archive_path Path of the file inside of the archive.
+   * \throws std::runtime_error When the archive path is longer than supported by the format.
+   */
+  void addFile(const std::filesystem::path& source_file, const std::string& archive_path);
+  /*!
+   * \brief Recursively adds all files in the given directory to the archive. Paths inside of
+   * the archive are relative to that directory.
+   * \param source_dir Directory containing the files.
+   */
+  void addDirectory(const std::filesystem::path& source_dir);
+  /*!
+   * \brief Compresses all added files and writes the archive. Replaces the archive if it
+   * already exists.
+   * \param progress_node Used to inform about the current progress.
+   * \throws std::runtime_error When a file can not be read or compressed.
+   */
+  void write(std::optional<ProgressNode*> progress_node = {});
+
+private:
+  /*! \brief A file which is to be added to the archive. */
+  struct SourceFile
+  {
+    /*! \brief Path to the file on disk. */
+    std::filesystem::path source_file;
+    /*! \brief Path of the file inside of the archive. */
+    std::string archive_path;
+  };
+
+  /*! \brief A file compressed for the archive. */
+  struct CompressedFile
+  {
+    /*! \brief Data as stored in the archive. */
+    std::vector<char> data;
+    /*! \brief Size of the uncompressed file. */
+    uint32_t uncompressed_size;
+    /*! \brief Compression type used for data. */
+    int compression_type;
+  };
+
+  /*! \brief Flag marking the default compression level, combined with the compression type. */
+  static constexpr int COMPRESSION_LEVEL_DEFAULT = 0x20;
+  /*! \brief Maximum number of compressed files held in memory per worker thread. */
+  static constexpr int FILES_PER_THREAD = 4;
+
+  /*! \brief Path of the archive to be written. */
+  std::filesystem::path archive_path_;
+  /*! \brief Compression used for all files. */
+  int compression_type_;
+  /*! \brief All files which are to be added. */
+  std::vector<SourceFile> files_;
+  /*! \brief Maps paths inside of the archive to their index in \ref files_. */
+  std::unordered_map<std::string, int> file_ids_;
+
+  /*!
+   * \brief Reads and compresses the given file.
+   * \param source_file File to be compressed.
+   * \param compression_type Compression to be used.
+   * \return The compressed file.
+   */
+  static CompressedFile compressFile(const std::filesystem::path& source_file,
+                                     int compression_type);
+};
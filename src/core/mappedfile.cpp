@@ -0,0 +1,51 @@
+#include "mappedfile.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sfs = std::filesystem;
+
+
+MappedFile::MappedFile(const sfs::path& path, bool sequential)
+{
+  const int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    throw std::runtime_error("Could not open \"" + path.string() + "\".");
+  struct stat file_stats;
+  if(fstat(fd, &file_stats) != 0)
+  {
+    close(fd);
+    throw std::runtime_error("Could not read \"" + path.string() + "\".");
+  }
+  size_ = file_stats.st_size;
+  if(size_ == 0)
+  {
+    close(fd);
+    return;
+  }
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED)
+    throw std::runtime_error("Could not map \"" + path.string() + "\" into memory.");
+  if(sequential)
+    madvise(data, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+  if(data_)
+    munmap(const_cast<char*>(data_), size_);
+}
+
+const char* MappedFile::data() const
+{
+  return data_;
+}
+
+std::size_t MappedFile::size() const
+{
+  return size_;
+}
@@ -0,0 +1,46 @@
+/*!
+ * \file mappedfile.h
+ * \brief Header for the MappedFile class.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+
+/*!
+ * \brief Maps a file into memory for reading. The mapping is released on destruction.
+ */
+class MappedFile
+{
+public:
+  /*!
+   * \brief Maps the given file into memory.
+   * \param path Path to the file.
+   * \param sequential If true: Advise the kernel that the file will be read sequentially.
+   * \throws std::runtime_error When the file can not be mapped.
+   */
+  MappedFile(const std::filesystem::path& path, bool sequential = false);
+  /*! \brief Releases the mapping. */
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /*!
+   * \brief Returns a pointer to the start of the mapped file.
+   * \return The pointer. Null for empty files.
+   */
+  const char* data() const;
+  /*!
+   * \brief Returns the size of the mapped file.
+   * \return The size in bytes.
+   */
+  std::size_t size() const;
+
+private:
+  /*! \brief Start of the mapping. */
+  const char* data_ = nullptr;
+  /*! \brief Size of the mapping. */
+  std::size_t size_ = 0;
+};
@@ -5,6 +5,7 @@
 #include "parseerror.h"
 #include "pathutils.h"
 #include "reversedeployer.h"
+#include "threadpool.h"
 #include <algorithm>
 #include <fstream>
 #include <memory>
@@ -21,7 +22,8 @@ ModdedApplication::ModdedApplication(sfs::path staging_dir,
                                      std::string command,
                                      std::filesystem::path icon_path,
                                      std::string app_version) :
-  name_(name), staging_dir_(staging_dir), command_(command), icon_path_(icon_path)
+  name_(name), staging_dir_(staging_dir), command_(command), icon_path_(icon_path),
+  mod_store_(staging_dir / MOD_STORE_DIR / "files")
 {
   if(sfs::exists(staging_dir / CONFIG_FILE_NAME))
     updateState(true);
@@ -133,35 +135,30 @@ void ModdedApplication::installMod(const ImportModInfo& info)
   else
     progress_node.addChildren({ 1 });
   progress_node.child(0).setTotalSteps(1);
-  int mod_id = 0;
-  if(!installed_mods_.empty())
-    mod_id = std::max_element(installed_mods_.begin(), installed_mods_.end())->id + 1;
-  while(pu::exists(staging_dir_ / std::to_string(mod_id)) &&
-        mod_id < std::numeric_limits<int>().max())
-    mod_id++;
-  if(mod_id == std::numeric_limits<int>().max())
-    throw std::runtime_error("Error: Could not generate new mod id.");
+  const int mod_id = generateModId();
   last_mod_id_ = mod_id;
-  const auto mod_size = Installer::install(info.current_path,
+  const auto mod_size = Installer::install(info.is_fomod_preview ? info.local_source
+                                                                 : info.current_path,
                                            staging_dir_ / std::to_string(mod_id),
                                            info.installer_flags,
                                            info.installer,
                                            info.root_level,
-                                           info.files);
-  const auto time_now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-  installed_mods_.emplace_back(mod_id,
-                               info.name,
-                               info.version,
-                               time_now,
-                               info.local_source,
-                               info.remote_source,
-                               time_now,
-                               mod_size,
-                               time_now,
-                               info.remote_mod_id,
-                               info.remote_file_id,
-                               info.remote_type);
-  installer_map_[mod_id] = info.installer;
+                                           info.files,
+                                           getArchiveIndexDir());
+  addInstalledMod(info, mod_id, mod_size);
+  if(use_content_store_)
+  {
+    // the mod remains fully usable with its own copy of every file
+    try
+    {
+      addModToStore(mod_id);
+    }
+    catch(std::exception& error)
+    {
+      log_(Log::LOG_WARNING,
+           std::format("Could not add mod '{}' to the mod store: {}", info.name, error.what()));
+    }
+  }
   progress_node.child(0).advance();
   if(info.target_group_id >= 0)
   {
@@ -181,6 +178,154 @@ void ModdedApplication::installMod(const ImportModInfo& info)
   updateSettings(true);
 }
 
+void ModdedApplication::installMods(const std::vector<ImportModInfo>& infos)
+{
+  if(infos.empty())
+    return;
+  ProgressNode progress_node(progress_callback_);
+  progress_node.addChildren({ 10, 1, 1 });
+  progress_node.child(0).setTotalSteps(infos.size());
+  progress_node.child(1).setTotalSteps(infos.size());
+
+  // ids are allocated up front, so that they follow the order of the given mods
+  std::vector<int> mod_ids(infos.size(), -1);
+  std::set<int> reserved_ids;
+  for(int i = 0; i < infos.size(); i++)
+  {
+    if(infos[i].replace_mod && infos[i].target_group_id != -1)
+      continue;
+    mod_ids[i] = generateModId(reserved_ids);
+    reserved_ids.insert(mod_ids[i]);
+  }
+
+  std::vector<std::optional<unsigned long>> mod_sizes(infos.size());
+  std::vector<std::string> errors;
+  {
+    ThreadPool pool(std::min<unsigned int>(MAX_PARALLEL_INSTALLATIONS, infos.size()));
+    std::vector<std::future<unsigned long>> results(infos.size());
+    for(int i = 0; i < infos.size(); i++)
+    {
+      if(mod_ids[i] == -1)
+        continue;
+      results[i] = pool.submit(
+        [this, &info = infos[i], mod_id = mod_ids[i]]()
+        {
+          return Installer::install(info.is_fomod_preview ? info.local_source : info.current_path,
+                                    staging_dir_ / std::to_string(mod_id),
+                                    info.installer_flags,
+                                    info.installer,
+                                    info.root_level,
+                                    info.files,
+                                    getArchiveIndexDir());
+        });
+    }
+    for(int i = 0; i < infos.size(); i++)
+    {
+      if(results[i].valid())
+      {
+        try
+        {
+          mod_sizes[i] = results[i].get();
+        }
+        catch(std::exception& error)
+        {
+          errors.push_back(std::format("'{}': {}", infos[i].name, error.what()));
+        }
+      }
+      progress_node.child(0).advance();
+    }
+  }
+  for(int i = 0; i < infos.size(); i++)
+  {
+    if(mod_ids[i] != -1 && !mod_sizes[i])
+      Installer::cleanupFailedInstallation(staging_dir_, mod_ids[i]);
+  }
+
+  // a failing mod must not prevent the remaining mods from being added, since their files
+  // have already been extracted and settings are only written once all mods have been handled
+  std::vector<int> new_mod_ids;
+  std::set<int> updated_deployers;
+  for(int i = 0; i < infos.size(); i++)
+  {
+    const auto& info = infos[i];
+    bool was_added = false;
+    try
+    {
+      if(mod_ids[i] == -1)
+        replaceMod(info);
+      else if(mod_sizes[i])
+      {
+        const int mod_id = mod_ids[i];
+        addInstalledMod(info, mod_id, *mod_sizes[i]);
+        was_added = true;
+        new_mod_ids.push_back(mod_id);
+        if(use_content_store_)
+        {
+          // the mod remains fully usable with its own copy of every file
+          try
+          {
+            addModToStore(mod_id);
+          }
+          catch(std::exception& error)
+          {
+            log_(Log::LOG_WARNING,
+                 std::format(
+                   "Could not add mod '{}' to the mod store: {}", info.name, error.what()));
+          }
+        }
+        if(info.target_group_id >= 0)
+        {
+          if(modHasGroup(info.target_group_id))
+            addModToGroup(mod_id, group_map_[info.target_group_id]);
+          else
+            createGroup(mod_id, info.target_group_id);
+        }
+        for(int deployer : info.deployers)
+        {
+          if(deployers_[deployer]->isAutonomous())
+            continue;
+          if(deployers_[deployer]->addMod(mod_id, true, false))
+            updated_deployers.insert(deployer);
+          splitMod(mod_id, deployer);
+        }
+      }
+    }
+    catch(std::exception& error)
+    {
+      errors.push_back(std::format("'{}': {}", info.name, error.what()));
+      if(mod_ids[i] != -1 && !was_added)
+        Installer::cleanupFailedInstallation(staging_dir_, mod_ids[i]);
+    }
+    progress_node.child(1).advance();
+  }
+
+  if(updated_deployers.empty())
+  {
+    progress_node.child(2).setTotalSteps(1);
+    progress_node.child(2).advance();
+  }
+  else
+  {
+    progress_node.child(2).addChildren(std::vector<float>(updated_deployers.size(), 1.0f));
+    for(auto [i, deployer] : str::enumerate_view(updated_deployers))
+      deployers_[deployer]->updateConflictGroups(&progress_node.child(2).child(i));
+  }
+
+  for(auto& tag : auto_tags_)
+    tag.updateMods(staging_dir_, new_mod_ids);
+  updateAutoTagMap();
+  updateSettings(true);
+
+  if(!errors.empty())
+  {
+    std::string message =
+      std::format("Failed to install {} of {} mods:", errors.size(), infos.size());
+    for(const auto& error : errors)
+      message += "\n" + error;
+    throw std::runtime_error(message);
+  }
+}
+
 void ModdedApplication::uninstallMods(const std::vector<int>& mod_ids,
                                       const std::string& installer_type)
 {
@@ -218,6 +363,7 @@ void ModdedApplication::uninstallMods(const std::vector<int>& mod_ids,
     if(installer_type == "" && installer_map_.contains(mod_id))
       installer = installer_map_[mod_id];
     Installer::uninstall(staging_dir_ / std::to_string(mod_id), installer);
+    sfs::remove(getModManifestPath(mod_id));
 
     for(auto& tag : manual_tags_)
       tag.removeMod(mod_id);
@@ -235,6 +381,8 @@ void ModdedApplication::uninstallMods(const std::vector<int>& mod_ids,
     }
     deployers_[depl]->setProfile(current_profile_);
   }
+  if(use_content_store_)
+    collectModStoreGarbage();
 
   updateSettings(true);
 }
@@ -332,6 +480,7 @@ void ModdedApplication::addDeployer(const EditDeployerInfo& info)
                                                      info.separate_profile_dirs,
                                                      info.update_ignore_list));
   deployers_.back()->setEnableUnsafeSorting(info.enable_unsafe_sorting);
+  deployers_.back()->setDeployedFilesRegistry(deployed_files_registry_);
   for(int i = 0; i < profile_names_.size(); i++)
     deployers_.back()->addProfile();
   deployers_.back()->setProfile(current_profile_);
@@ -430,8 +579,11 @@ void ModdedApplication::setStagingDir(std::string staging_dir, bool move_existin
       sfs::rename(staging_dir_ / mod_dir, sfs::path(staging_dir) / mod_dir);
     }
     sfs::rename(staging_dir_ / CONFIG_FILE_NAME, sfs::path(staging_dir) / CONFIG_FILE_NAME);
+    if(sfs::exists(staging_dir_ / MOD_STORE_DIR))
+      sfs::rename(staging_dir_ / MOD_STORE_DIR, sfs::path(staging_dir) / MOD_STORE_DIR);
   }
   staging_dir_ = staging_dir;
+  mod_store_ = ContentStore(staging_dir_ / MOD_STORE_DIR / "files");
   updateState(true);
 }
 
@@ -474,10 +626,37 @@ std::vector<ConflictInfo> ModdedApplication::getFileConflicts(int deployer,
   auto conflicts = deployers_[deployer]->getFileConflicts(mod_id, show_disabled, &node);
   if(deployers_[deployer]->isAutonomous())
     return conflicts;
-  for(auto& [_, ids, names] : conflicts)
+  for(auto& conflict : conflicts)
+  {
+    for(int id : conflict.mod_ids)
+      conflict.mod_names.push_back(getModName(id));
+  }
+  if(!use_content_store_)
+    return conflicts;
+  // stored hashes identify candidates, files are only read if all hashes match
+  std::map<int, std::map<sfs::path, std::string>> manifests;
+  for(auto& conflict : conflicts)
   {
-    for(int id : ids)
-      names.push_back(getModName(id));
+    std::optional<std::string> hash;
+    conflict.is_identical = true;
+    for(int id : conflict.mod_ids)
+    {
+      if(!manifests.contains(id))
+        manifests[id] = readModManifest(id);
+      const auto iter = manifests[id].find(conflict.file);
+      if(iter == manifests[id].end() || hash && *hash != iter->second)
+      {
+        conflict.is_identical = false;
+        break;
+      }
+      hash = iter->second;
+    }
+    // mod files may have been edited since they were added to the store
+    if(conflict.is_identical)
+      conflict.is_identical = str::all_of(
+        conflict.mod_ids,
+        [this, &conflict, &hash](int id)
+        { return mod_store_.isLinked(staging_dir_ / std::to_string(id) / conflict.file, *hash); });
   }
   return conflicts;
 }
@@ -491,6 +670,7 @@ AppInfo ModdedApplication::getAppInfo() const
   info.num_mods = installed_mods_.size();
   info.app_version = app_versions_[current_profile_];
   info.steam_app_id = steam_app_id_;
+  info.uses_content_store = use_content_store_;
   for(const auto& deployer : deployers_)
   {
     info.deployers.push_back(deployer->getName());
@@ -1423,6 +1603,7 @@ void ModdedApplication::deleteAllData()
     sfs::remove_all(staging_dir_ / std::to_string(mod.id));
   sfs::remove(staging_dir_ / CONFIG_FILE_NAME);
   sfs::remove_all(getDownloadDir());
+  sfs::remove_all(staging_dir_ / MOD_STORE_DIR);
 }
 
 void ModdedApplication::setAppVersion(const std::string& app_version)
@@ -1602,6 +1783,50 @@ std::filesystem::path ModdedApplication::getDownloadDir() const
   return staging_dir_ / DOWNLOAD_DIR;
 }
 
+std::filesystem::path ModdedApplication::getArchiveIndexDir() const
+{
+  return getDownloadDir() / ARCHIVE_INDEX_DIR;
+}
+
+void ModdedApplication::setUseContentStore(bool use_content_store)
+{
+  if(use_content_store && !mod_store_.supportsReflinks())
+    throw std::runtime_error(
+      std::format("The file system containing '{}' does not support reflinks, which are "
+                  "required to share files between mods.",
+                  staging_dir_.string()));
+  use_content_store_ = use_content_store;
+  if(use_content_store_)
+  {
+    ProgressNode node(progress_callback_);
+    node.setTotalSteps(installed_mods_.size());
+    for(const auto& mod : installed_mods_)
+    {
+      addModToStore(mod.id);
+      node.advance();
+    }
+    collectModStoreGarbage();
+    // files replaced by links to the store no longer share an inode with deployed hard links
+    std::vector<int> hard_link_deployers;
+    for(int deployer = 0; deployer < deployers_.size(); deployer++)
+    {
+      if(!deployers_[deployer]->isAutonomous() && deployers_[deployer]->getNumMods() > 0 &&
+         deployers_[deployer]->getDeployMode() == Deployer::hard_link)
+        hard_link_deployers.push_back(deployer);
+    }
+    if(!hard_link_deployers.empty())
+      deployModsFor(hard_link_deployers);
+  }
+  else
+    sfs::remove_all(staging_dir_ / MOD_STORE_DIR);
+  updateSettings(true);
+}
+
+bool ModdedApplication::usesContentStore() const
+{
+  return use_content_store_;
+}
+
 sfs::path ModdedApplication::iconPath() const
 {
   return icon_path_;
@@ -1690,6 +1915,7 @@ void ModdedApplication::updateSettings(bool write)
   }
 
   json_settings_["steam_app_id"] = steam_app_id_;
+  json_settings_["use_content_store"] = use_content_store_;
 
   if(write)
     writeSettings();
@@ -1721,6 +1947,7 @@ void ModdedApplication::updateState(bool read)
 {
   installed_mods_.clear();
   deployers_.clear();
+  deployed_files_registry_->clear();
   groups_.clear();
   group_map_.clear();
   active_group_members_.clear();
@@ -1827,6 +2054,7 @@ void ModdedApplication::updateState(bool read)
                                     sfs::path(deployers[depl]["dest_path"].asString()),
                                     deployers[depl]["name"].asString(),
                                     deploy_mode));
+    deployers_.back()->setDeployedFilesRegistry(deployed_files_registry_);
     if(deployers[depl].isMember("enable_unsafe_sorting"))
       deployers_.back()->setEnableUnsafeSorting(deployers[depl]["enable_unsafe_sorting"].asBool());
 
@@ -1933,6 +2161,7 @@ void ModdedApplication::updateState(bool read)
     steam_app_id_ = json_settings_["steam_app_id"].asInt64();
   else
     updateSteamAppId();
+  use_content_store_ = json_settings_.get("use_content_store", false).asBool();
 
   updateSteamIconPath();
 }
@@ -2086,26 +2315,48 @@ void ModdedApplication::replaceMod(const ImportModInfo& info)
   if(index == installed_mods_.end())
     throw std::runtime_error(std::format("Invalid group '{}' for mod '{}'", info.target_group_id, info.name));
 
-  int mod_id = 0;
-  if(!installed_mods_.empty())
-    mod_id = std::max_element(installed_mods_.begin(), installed_mods_.end())->id + 1;
-  while(pu::exists(staging_dir_ / std::to_string(mod_id)) &&
-        mod_id < std::numeric_limits<int>().max())
-    mod_id++;
-  if(mod_id == std::numeric_limits<int>().max())
-    throw std::runtime_error("Error: Could not generate new mod id.");
+  const int mod_id = generateModId();
   const sfs::path tmp_replace_dir =
     staging_dir_ / (std::string("tmp_replace_") + std::to_string(mod_id));
 
-  const auto mod_size = Installer::install(info.current_path,
+  const auto mod_size = Installer::install(info.is_fomod_preview ? info.local_source
+                                                                 : info.current_path,
                                            tmp_replace_dir,
                                            info.installer_flags,
                                            info.installer,
                                            info.root_level,
-                                           info.files);
+                                           info.files,
+                                           getArchiveIndexDir());
   const sfs::path old_mod_path = staging_dir_ / std::to_string(info.target_group_id);
-  sfs::remove_all(old_mod_path);
-  sfs::rename(tmp_replace_dir, old_mod_path);
+  // only replace changed files, so that deployed links to unchanged files remain valid
+  std::optional<std::set<sfs::path>> changed_files;
+  bool file_list_changed = true;
+  if(sfs::is_directory(old_mod_path))
+  {
+    std::tie(changed_files, file_list_changed) =
+      Installer::applyModUpdate(tmp_replace_dir, old_mod_path);
+    log_(Log::LOG_DEBUG,
+         std::format("Updated {} files of mod '{}'", changed_files->size(), info.name));
+  }
+  else
+  {
+    sfs::remove_all(old_mod_path);
+    sfs::rename(tmp_replace_dir, old_mod_path);
+  }
+  if(use_content_store_)
+  {
+    // the mod remains fully usable with its own copy of every file
+    try
+    {
+      addModToStore(info.target_group_id);
+      collectModStoreGarbage();
+    }
+    catch(std::exception& error)
+    {
+      log_(Log::LOG_WARNING,
+           std::format("Could not add mod '{}' to the mod store: {}", info.name, error.what()));
+    }
+  }
 
   index->name = info.name;
   index->version = info.version;
@@ -2136,8 +2387,12 @@ void ModdedApplication::replaceMod(const ImportModInfo& info)
       deployers_[depl]->setProfile(prof);
       if(deployers_[depl]->hasMod(info.target_group_id))
       {
-        update_targets[depl].push_back(prof);
-        weights_profiles.push_back(deployers_[depl]->getNumMods());
+        // conflicts only change when files have been added or removed
+        if(file_list_changed)
+        {
+          update_targets[depl].push_back(prof);
+          weights_profiles.push_back(deployers_[depl]->getNumMods());
+        }
         if(!was_split)
         {
           was_split = true;
@@ -2154,7 +2409,8 @@ void ModdedApplication::replaceMod(const ImportModInfo& info)
   int i = 0;
   for(int depl = 0; depl < update_targets.size(); depl++)
   {
-    deployers_[depl]->updateDeployedFilesForMod(info.target_group_id, &node.child(0).child(depl));
+    deployers_[depl]->updateDeployedFilesForMod(
+      info.target_group_id, &node.child(0).child(depl), changed_files);
     for(int prof : update_targets[depl])
     {
       deployers_[depl]->setProfile(prof);
@@ -2304,3 +2560,133 @@ void ModdedApplication::updateSteamAppId()
     }
   }
 }
+
+int ModdedApplication::generateModId(const std::set<int>& reserved_ids) const
+{
+  int mod_id = 0;
+  if(!installed_mods_.empty())
+    mod_id = std::max_element(installed_mods_.begin(), installed_mods_.end())->id + 1;
+  while((reserved_ids.contains(mod_id) || pu::exists(staging_dir_ / std::to_string(mod_id))) &&
+        mod_id < std::numeric_limits<int>().max())
+    mod_id++;
+  if(mod_id == std::numeric_limits<int>().max())
+    throw std::runtime_error("Error: Could not generate new mod id.");
+  return mod_id;
+}
+
+void ModdedApplication::addInstalledMod(const ImportModInfo& info, int mod_id, unsigned long mod_size)
+{
+  const auto time_now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  installed_mods_.emplace_back(mod_id,
+                               info.name,
+                               info.version,
+                               time_now,
+                               info.local_source,
+                               info.remote_source,
+                               time_now,
+                               mod_size,
+                               time_now,
+                               info.remote_mod_id,
+                               info.remote_file_id,
+                               info.remote_type);
+  installer_map_[mod_id] = info.installer;
+}
+
+sfs::path ModdedApplication::getModManifestPath(int mod_id) const
+{
+  return staging_dir_ / MOD_STORE_DIR / "manifests" / (std::to_string(mod_id) + ".json");
+}
+
+std::map<sfs::path, std::string> ModdedApplication::readModManifest(int mod_id) const
+{
+  std::map<sfs::path, std::string> hashes;
+  std::ifstream file(getModManifestPath(mod_id), std::fstream::binary);
+  if(!file.is_open())
+    return hashes;
+  Json::Value manifest;
+  try
+  {
+    file >> manifest;
+  }
+  catch(Json::Exception&)
+  {
+    return hashes;
+  }
+  for(const auto& path : manifest.getMemberNames())
+    hashes[path] = manifest[path].asString();
+  return hashes;
+}
+
+void ModdedApplication::addModToStore(int mod_id)
+{
+  const sfs::path mod_dir = staging_dir_ / std::to_string(mod_id);
+  // without reflinks, every mod would need its own copy anyway
+  if(!sfs::is_directory(mod_dir) || !mod_store_.supportsReflinks())
+    return;
+  const auto old_hashes = readModManifest(mod_id);
+  std::vector<sfs::path> files;
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(mod_dir))
+  {
+    if(dir_entry.is_regular_file() && !dir_entry.is_symlink())
+      files.push_back(pu::getRelativePath(dir_entry.path(), mod_dir));
+  }
+
+  std::vector<std::string> hashes(files.size());
+  {
+    ThreadPool pool;
+    std::vector<std::future<void>> results;
+    for(int i = 0; i < files.size(); i++)
+      results.push_back(pool.submit(
+        [this, &mod_dir, &files, &hashes, &old_hashes, i]()
+        {
+          const auto iter = old_hashes.find(files[i]);
+          if(iter != old_hashes.end() && mod_store_.isLinked(mod_dir / files[i], iter->second))
+            hashes[i] = iter->second;
+          else
+            hashes[i] = mod_store_.addFile(mod_dir / files[i]);
+        }));
+    std::exception_ptr error;
+    for(auto& result : results)
+    {
+      try
+      {
+        result.get();
+      }
+      catch(...)
+      {
+        if(!error)
+          error = std::current_exception();
+      }
+    }
+    if(error)
+      std::rethrow_exception(error);
+  }
+
+  Json::Value manifest(Json::objectValue);
+  for(int i = 0; i < files.size(); i++)
+    manifest[files[i].generic_string()] = hashes[i];
+  const sfs::path manifest_path = getModManifestPath(mod_id);
+  sfs::create_directories(manifest_path.parent_path());
+  sfs::path tmp_path = manifest_path;
+  tmp_path += ".tmp";
+  std::ofstream file(tmp_path, std::fstream::binary);
+  if(!file.is_open())
+    throw std::runtime_error(std::format("Could not write to '{}'.", tmp_path.string()));
+  file << manifest;
+  file.close();
+  sfs::rename(tmp_path, manifest_path);
+}
+
+void ModdedApplication::collectModStoreGarbage() const
+{
+  std::unordered_set<std::string> referenced_hashes;
+  for(const auto& mod : installed_mods_)
+  {
+    for(const auto& hash : std::views::values(readModManifest(mod.id)))
+      referenced_hashes.insert(hash);
+  }
+  const int num_deleted_files = mod_store_.collectGarbage(referenced_hashes);
+  if(num_deleted_files > 0)
+    log_(Log::LOG_DEBUG,
+         std::format("Deleted {} unused files from the mod store.", num_deleted_files));
+}
@@ -8,6 +8,8 @@
 #include "appinfo.h"
 #include "autotag.h"
 #include "backupmanager.h"
+#include "contentstore.h"
+#include "deployedfilesregistry.h"
 #include "deployer.h"
 #include "deployerinfo.h"
 #include "editautotagaction.h"
@@ -22,6 +24,7 @@
 #include "tool.h"
 #include <filesystem>
 #include <json/json.h>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -74,6 +77,15 @@ public:
    * \param info Contains all data needed to install the mod.
    */
   void installMod(const ImportModInfo& info);
+  /*!
+   * \brief Installs all given mods. Mods are extracted concurrently and then added in the given
+   * order. Settings are only written once after all mods have been added. Mods replacing an
+   * existing mod are installed one at a time while adding mods.
+   * \param infos Contains all data needed to install each mod.
+   * \throws std::runtime_error When at least one mod could not be installed. All other mods
+   * are still installed.
+   */
+  void installMods(const std::vector<ImportModInfo>& infos);
   /*!
    * \brief Uninstalls the given mods, this includes deleting all installed files.
    * \param mod_id Ids of the mods to be uninstalled.
@@ -645,10 +657,35 @@ public:
    * \return The download path.
    */
   std::filesystem::path getDownloadDir() const;
+  /*!
+   * \brief Returns the path used to cache listings of downloaded archives.
+   * \return The cache path.
+   */
+  std::filesystem::path getArchiveIndexDir() const;
+  /*!
+   * \brief Enables or disables the content addressed store for mod files. While enabled, all
+   * identical files of installed mods are replaced with reflinks to a single stored copy.
+   * Disabling deletes the store, files which are already shared remain copy on write clones.
+   * Deployers using hard links are redeployed after existing mods have been added.
+   * \param use_content_store If true: Enable the store and add all installed mods to it.
+   * \throws std::runtime_error When enabling the store on a file system without reflinks.
+   */
+  void setUseContentStore(bool use_content_store);
+  /*!
+   * \brief Checks if files of installed mods are deduplicated using a content addressed store.
+   * \return True if the store is enabled.
+   */
+  bool usesContentStore() const;
 
 private:
   /*! \brief The subdirectory used to store downloads. */
   static inline constexpr std::string DOWNLOAD_DIR = "_download";
+  /*! \brief The subdirectory of \ref DOWNLOAD_DIR used to cache archive listings. */
+  static inline constexpr std::string ARCHIVE_INDEX_DIR = ".archive_index";
+  /*! \brief Maximum number of mods extracted at the same time by \ref installMods. */
+  static constexpr unsigned int MAX_PARALLEL_INSTALLATIONS = 4;
+  /*! \brief The subdirectory containing the content addressed store for mod files. */
+  static inline constexpr std::string MOD_STORE_DIR = ".mod_store";
 
   /*! \brief The name of this application. */
   std::string name_;
@@ -660,6 +697,9 @@ private:
   std::vector<Mod> installed_mods_;
   /*! \brief Contains every Deployer used by this application. */
   std::vector<std::unique_ptr<Deployer>> deployers_;
+  /*! \brief Shares the files deployed by every Deployer with all other deployers. */
+  std::shared_ptr<DeployedFilesRegistry> deployed_files_registry_ =
+    std::make_shared<DeployedFilesRegistry>();
   /*! \brief Contains all tools for this application. */
   std::vector<Tool> tools_;
   /*! \brief The command used to run this application. */
@@ -706,6 +746,10 @@ private:
   std::string export_file_name = "exported_config";
   /*! \brief Steam app id. Or -1 if not a Steam app. */
   long steam_app_id_;
+  /*! \brief If true: Files of installed mods are deduplicated using a \ref ContentStore. */
+  bool use_content_store_ = false;
+  /*! \brief Content addressed store used to share files between mods. */
+  ContentStore mod_store_;
 
   /*!
    * \brief Updates json_settings_ with the current state of this object.
@@ -753,6 +797,42 @@ private:
    * \param info Contains all data needed to install the mod.
    */
   void replaceMod(const ImportModInfo& info);
+  /*!
+   * \brief Generates an id for a new mod which is neither used by an installed mod nor by a
+   * directory in the staging directory.
+   * \param reserved_ids Ids which must not be used.
+   * \return The new id.
+   * \throws std::runtime_error When no id is available.
+   */
+  int generateModId(const std::set<int>& reserved_ids = {}) const;
+  /*!
+   * \brief Adds a mod which has been installed to the given id to \ref installed_mods_.
+   * \param info Data used for the installation.
+   * \param mod_id Id of the new mod.
+   * \param mod_size Size of the installed files.
+   */
+  void addInstalledMod(const ImportModInfo& info, int mod_id, unsigned long mod_size);
+  /*!
+   * \brief Returns the path to the file mapping the files of the given mod to their hashes.
+   * \param mod_id Target mod.
+   * \return The path.
+   */
+  std::filesystem::path getModManifestPath(int mod_id) const;
+  /*!
+   * \brief Reads the hashes of all files of the given mod which have been added to the store.
+   * \param mod_id Target mod.
+   * \return Maps paths relative to the mod directory to content hashes.
+   */
+  std::map<std::filesystem::path, std::string> readModManifest(int mod_id) const;
+  /*!
+   * \brief Replaces all files of the given mod with links to the mod store, in parallel.
+   * Files which still match the hash stored in their manifest are skipped. Does nothing if
+   * the file system does not support reflinks.
+   * \param mod_id Target mod.
+   */
+  void addModToStore(int mod_id);
+  /*! \brief Deletes all stored files which are not used by any installed mod. */
+  void collectModStoreGarbage() const;
   /*! \brief Updates manual_tag_map_ with the information contained in manual_tags_. */
   void updateManualTagMap();
   /*! \brief Updates auto_tag_map_ with the information contained in auto_tags_. */
@@ -200,6 +200,41 @@ std::string Api::getDownloadUrl(const std::string& nxm_url)
   return json_body[0]["URI"].asString();
 }
 
+std::optional<bool> Api::fileMatchesMd5(const std::string& mod_url,
+                                        long file_id,
+                                        const std::string& md5)
+{
+  auto domain_and_mod = extractDomainAndModId(mod_url);
+  if(!domain_and_mod)
+    throw std::runtime_error(std::format("Could not parse mod URL: \"{}\".", mod_url));
+
+  const auto [domain_name, mod_id] = *domain_and_mod;
+  cpr::Response response = cpr::Get(
+    cpr::Url(std::format(
+      "https://api.nexusmods.com/v1/games/{}/mods/md5_search/{}.json", domain_name, md5)),
+    cpr::Header{ { "apikey", api_key_ } });
+  // the hash is unknown, which also happens for files whose hash has not been computed yet
+  if(response.status_code == 404)
+    return {};
+  if(response.status_code != 200)
+    throw std::runtime_error(
+      std::format("Failed to search for MD5 hash on NexusMods. Response code was {}",
+                  response.status_code));
+
+  Json::Value json_body;
+  Json::Reader reader;
+  bool success = reader.parse(response.text.c_str(), json_body);
+  if(!success)
+    throw ParseError("Failed to parse response from NexusMods.");
+  for(int i = 0; i < json_body.size(); i++)
+  {
+    if(json_body[i]["mod"]["mod_id"].asInt64() == mod_id &&
+       json_body[i]["file_details"]["file_id"].asInt64() == file_id)
+      return true;
+  }
+  return false;
+}
+
 std::vector<std::pair<std::string, std::vector<std::string>>> Api::getChangelogs(
   const std::string& mod_url)
 {
@@ -100,6 +100,18 @@ public:
    * \return The download URL.
    */
   static std::string getDownloadUrl(const std::string& nxm_url);
+  /*!
+   * \brief Checks if NexusMods lists the given MD5 hash for the given mod file.
+   * \param mod_url URL to the mod on NexusMods.
+   * \param file_id Id of the file.
+   * \param md5 MD5 hash of the file as a hexadecimal string.
+   * \return True if the hash belongs to the given file, false if it belongs to other files.
+   * Empty if NexusMods does not know the hash, e.g. because it has not been computed yet.
+   * \throws std::runtime_error When the request fails.
+   */
+  static std::optional<bool> fileMatchesMd5(const std::string& mod_url,
+                                            long file_id,
+                                            const std::string& md5);
   /*!
    * \brief Fetches changelogs for the given mod.
    * \param mod_url URL to the mod on NexusMods.
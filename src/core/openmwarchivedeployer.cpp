@@ -18,8 +18,7 @@ OpenMwArchiveDeployer::OpenMwArchiveDeployer(const std::filesystem::path& source
   deploy_mode_ = copy;
   type_ = "OpenMW Archive Deployer";
   is_autonomous_ = true;
-  plugin_regex_ = R"(.*\.[bB][sS][aA]$)";
-  plugin_file_line_regex_ = R"(^\s*(\*?)([^#]*\.[bB][sS][aA])(\r?))";
+  plugin_extensions_ = { ".bsa" };
   plugin_file_name_ = ".archives.txt";
   config_file_name_ = ".archives_config";
   tags_file_name_ = ".archives_tags";
@@ -64,13 +63,11 @@ void OpenMwArchiveDeployer::writePlugins() const
   std::vector<std::string> lines;
   int archive_line = -1;
   bool found_archive = false;
-  std::regex archive_regex(R"(^fallback-archive=.*)");
   std::string line;
   int i = 0;
   while(getline(in_file, line))
   {
-    std::smatch match;
-    if(std::regex_match(line, match, archive_regex))
+    if(line.starts_with("fallback-archive="))
     {
       if(!found_archive)
         archive_line = i;
@@ -121,13 +118,15 @@ bool OpenMwArchiveDeployer::initPluginFile()
   if(!in_file.is_open())
     throw std::runtime_error(std::format("Error: Could not open '{}'.", config_file_path.string()));
 
+  const std::string archive_prefix = "fallback-archive=";
   std::string line;
-  std::regex archive_regex(R"(^fallback-archive=(.*?\.[bB][sS][aA]))");
   while(getline(in_file, line))
   {
-    std::smatch match;
-    if(std::regex_match(line, match, archive_regex))
-      plugins_.emplace_back(match[1], true);
+    if(!line.starts_with(archive_prefix))
+      continue;
+    std::string archive = line.substr(archive_prefix.size());
+    if(isPluginFile(archive))
+      plugins_.emplace_back(std::move(archive), true);
   }
 
   PluginDeployer::writePlugins();
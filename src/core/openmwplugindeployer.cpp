@@ -4,6 +4,7 @@
 #include <fstream>
 #include <json/json.h>
 #include <ranges>
+#include <regex>
 
 namespace sfs = std::filesystem;
 namespace str = std::ranges;
@@ -20,10 +21,7 @@ OpenMwPluginDeployer::OpenMwPluginDeployer(const sfs::path& source_path,
   type_ = "OpenMW Plugin Deployer";
   is_autonomous_ = true;
   app_type_ = loot::GameType::openmw;
-  plugin_regex_ =
-    std::regex(R"(.*\.(?:es[pm]|omwscripts|omwaddon|omwgame)$)", std::regex_constants::icase);
-  plugin_file_line_regex_ = std::regex(
-    R"(^\s*(\*?)([^#]*\.(?:es[pm]|omwscripts|omwaddon|omwgame))(\r?))", std::regex_constants::icase);
+  plugin_extensions_ = { ".esp", ".esm", ".omwscripts", ".omwaddon", ".omwgame" };
   config_file_name_ = ".plugin_config";
   source_mods_file_name_ = ".plugin_mod_sources";
   plugin_file_name_ = ".plugins.txt";
@@ -329,7 +327,6 @@ void OpenMwPluginDeployer::writePluginTagsPrivate() const
 }
 
 void OpenMwPluginDeployer::writePluginsToOpenMwConfig(const std::string& line_prefix,
-                                                      const std::regex& line_regex,
                                                       std::function<bool(int)> plugin_filter) const
 {
   const sfs::path plugin_file_path = dest_path_ / OPEN_MW_CONFIG_FILE_NAME;
@@ -344,8 +341,7 @@ void OpenMwPluginDeployer::writePluginsToOpenMwConfig(const std::string& line_pr
   int i = 0;
   while(getline(in_file, line))
   {
-    std::smatch match;
-    if(std::regex_match(line, match, line_regex))
+    if(line.starts_with(line_prefix))
     {
       if(!found_target)
         target_line = i;
@@ -388,13 +384,11 @@ void OpenMwPluginDeployer::writePluginsPrivate() const
   PluginDeployer::writePlugins();
 
   writePluginsToOpenMwConfig("content=",
-                             std::regex(R"(^content=.*)"),
                              [this](int i) {
                                return plugins_[i].second &&
                                       !groundcover_plugins_.contains(plugins_[i].first);
                              });
   writePluginsToOpenMwConfig("groundcover=",
-                             std::regex(R"(^groundcover=.*)"),
                              [this](int i) {
                                return plugins_[i].second &&
                                       groundcover_plugins_.contains(plugins_[i].first);
@@ -132,12 +132,12 @@ private:
   void writePluginTagsPrivate() const;
   /*!
    * \brief Writes a subset of plugins to the OpenMW config file.
-   * \param line_prefix Prefix for the line containing the written plugins.
-   * \param line_regex Regex matched against lines that should be excluded from existing files.
+   * \param line_prefix Prefix for the line containing the written plugins. Existing lines with
+   * this prefix are replaced.
    * \param plugin_filter Used to filter indices in plugins_.
    * Plugins are written when this returns true.
    */
-  void writePluginsToOpenMwConfig(const std::string& line_prefix, const std::regex& line_regex,
+  void writePluginsToOpenMwConfig(const std::string& line_prefix,
                                   std::function<bool(int)> plugin_filter) const;
   /*! \brief Writes the plugins to disk. */
   void writePluginsPrivate() const;
@@ -1,13 +1,15 @@
 #include "plugindeployer.h"
 #include "pathutils.h"
 #include <algorithm>
+#include <cctype>
 #include <format>
 #include <fstream>
 #include <iostream>
 #include <json/json.h>
 #include <numeric>
 #include <ranges>
-#include <regex>
+#include <sstream>
+#include <unordered_set>
 
 namespace sfs = std::filesystem;
 namespace str = std::ranges;
@@ -265,8 +267,10 @@ std::vector<std::pair<std::filesystem::path, int>> PluginDeployer::getExternally
 
 void PluginDeployer::keepOrRevertFileModifications(const FileChangeChoices& changes_to_keep) {}
 
-void PluginDeployer::updateDeployedFilesForMod(int mod_id,
-                                               std::optional<ProgressNode*> progress_node) const
+void PluginDeployer::updateDeployedFilesForMod(
+  int mod_id,
+  std::optional<ProgressNode*> progress_node,
+  const std::optional<std::set<sfs::path>>& changed_files) const
 {
   if(progress_node)
   {
@@ -313,47 +317,84 @@ std::vector<std::vector<int>> PluginDeployer::getValidModActions() const
 void PluginDeployer::updatePlugins()
 {
   std::vector<std::string> plugin_files;
-  std::vector<std::pair<std::string, bool>> new_plugins;
   for(const auto& dir_entry : sfs::directory_iterator(source_path_))
   {
     if(dir_entry.is_directory())
       continue;
-    const std::string file_name = dir_entry.path().filename().string();
-    if(std::regex_match(file_name, plugin_regex_))
-      plugin_files.push_back(file_name);
-  }
-  for(auto it = plugins_.begin(); it != plugins_.end(); it++)
-  {
-    if(str::find_if(plugin_files, [&it](const auto& s) { return it->first == s; }) !=
-       plugin_files.end())
-      new_plugins.emplace_back(*it);
+    std::string file_name = dir_entry.path().filename().string();
+    if(isPluginFile(file_name))
+      plugin_files.push_back(std::move(file_name));
   }
-  for(auto it = plugin_files.begin(); it != plugin_files.end(); it++)
+  reconcilePlugins(plugin_files);
+  writePlugins();
+}
+
+void PluginDeployer::reconcilePlugins(const std::vector<std::string>& available_plugins)
+{
+  const std::unordered_set<std::string_view> available(available_plugins.begin(),
+                                                       available_plugins.end());
+  std::erase_if(plugins_,
+                [&available](const auto& pair) { return !available.contains(pair.first); });
+  std::unordered_set<std::string> known;
+  known.reserve(plugins_.size());
+  for(const auto& [name, enabled] : plugins_)
+    known.insert(name);
+  for(const auto& plugin : available_plugins)
   {
-    if(str::find_if(new_plugins, [&it](auto& p) { return p.first == *it; }) == new_plugins.end())
-      new_plugins.emplace_back(*it, true);
+    if(known.insert(plugin).second)
+      plugins_.emplace_back(plugin, true);
   }
-  plugins_ = new_plugins;
-  writePlugins();
+}
+
+bool PluginDeployer::isPluginFile(std::string_view file_name) const
+{
+  return str::any_of(plugin_extensions_,
+                     [file_name](const std::string& extension)
+                     {
+                       return file_name.size() >= extension.size() &&
+                              str::equal(file_name.substr(file_name.size() - extension.size()),
+                                         extension,
+                                         [](unsigned char a, unsigned char b)
+                                         { return std::tolower(a) == b; });
+                     });
+}
+
+std::optional<std::pair<std::string, bool>> PluginDeployer::parsePluginFileLine(
+  std::string_view line) const
+{
+  if(line.ends_with('\r'))
+    line.remove_suffix(1);
+  const auto first = line.find_first_not_of(" \t\f\v");
+  if(first == std::string_view::npos || line.find('#') != std::string_view::npos)
+    return {};
+  line.remove_prefix(first);
+  const bool enabled = line.starts_with('*');
+  if(enabled)
+    line.remove_prefix(1);
+  if(line.empty() || (plugin_file_lines_require_extension_ && !isPluginFile(line)))
+    return {};
+  return std::pair<std::string, bool>{ line, enabled };
 }
 
 void PluginDeployer::loadPlugins()
 {
   plugins_.clear();
-  std::string line;
   std::ifstream plugin_file;
   plugin_file.open(dest_path_ / plugin_file_name_);
   if(!plugin_file.is_open())
     throw std::runtime_error("Could not open " + plugin_file_name_ +
                              "!\nMake sure you have launched the game at least once.");
 
-  while(getline(plugin_file, line))
+  std::stringstream buffer;
+  buffer << plugin_file.rdbuf();
+  plugin_file.close();
+  const std::string content = buffer.str();
+  for(const auto line : str::split_view(content, '\n'))
   {
-    std::smatch match;
-    if(std::regex_match(line, match, plugin_file_line_regex_))
-      plugins_.emplace_back(match[2], match[1] == "*");
+    auto plugin = parsePluginFileLine(std::string_view(line.begin(), line.end()));
+    if(plugin)
+      plugins_.push_back(std::move(*plugin));
   }
-  plugin_file.close();
 }
 
 void PluginDeployer::writePlugins() const
@@ -454,15 +495,15 @@ void PluginDeployer::updateSourceMods()
     log_(Log::LOG_ERROR,
          std::format("Deployer '{}': Could not find deployed files at '{}'",
                      name_,
-                     deployed_source_path->string()));
+                     source_path_.string()));
     return;
   }
-  auto deployed_files = loadDeployedFiles({}, *deployed_source_path);
+  const auto deployed_files = getDeployedFiles(*deployed_source_path);
   const sfs::path relative_path(pu::getRelativePath(source_path_, *deployed_source_path));
   for(const auto& [name, _] : plugins_)
   {
-    auto iter = deployed_files.find((relative_path / name).string());
-    if(iter != deployed_files.end())
+    auto iter = deployed_files->find((relative_path / name).string());
+    if(iter != deployed_files->end())
       source_mods_[name] = iter->second;
   }
   writeSourceMods();
@@ -6,7 +6,7 @@
 #pragma once
 
 #include "deployer.h"
-#include <regex>
+#include <string_view>
 
 /*!
  * \brief Base class for autonomous deployers that collects all files which match a given critereon,
@@ -177,10 +177,12 @@ public:
    * This is not supported for this deployer type.
    * \param mod_id Ignored.
    * \param progress_node Ignored.
+   * \param changed_files Ignored.
    */
   virtual void updateDeployedFilesForMod(
     int mod_id,
-    std::optional<ProgressNode*> progress_node = {}) const override;
+    std::optional<ProgressNode*> progress_node = {},
+    const std::optional<std::set<std::filesystem::path>>& changed_files = {}) const override;
   /*! \brief Since this deployer type does not use normal deployment methods, this does nothing. */
   virtual void fixInvalidLinkDeployMode() override;
   /*!
@@ -236,15 +238,40 @@ protected:
   std::vector<std::vector<std::string>> tags_;
   /*! \brief Maps every plugin to a source mod, if that plugin was created by another deployer. */
   std::map<std::string, int> source_mods_;
-  /*! \brief Regex used to match against files in the source directory. */
-  std::regex plugin_regex_;
-  /*! \brief Regex used to match against lines in the plugin file. */
-  std::regex plugin_file_line_regex_;
+  /*! \brief Lower case extensions, including the dot, of plugin files in the source directory. */
+  std::vector<std::string> plugin_extensions_;
+  /*!
+   * \brief If true: Lines in the plugin file are only accepted if they name a file with one of
+   * the extensions in \ref plugin_extensions_.
+   */
+  bool plugin_file_lines_require_extension_ = true;
   /*! \brief Name of the file containing loot tags. */
   std::string tags_file_name_ = ".plugin_tags";
 
   /*! \brief Updates current plugins to reflect plugins actually in the source directory. */
   virtual void updatePlugins();
+  /*!
+   * \brief Updates \ref plugins_ to contain exactly the given plugins. Plugins which are
+   * no longer available are removed, new plugins are appended and enabled. The order of all
+   * other plugins is preserved.
+   * \param available_plugins Names of all available plugins.
+   */
+  void reconcilePlugins(const std::vector<std::string>& available_plugins);
+  /*!
+   * \brief Checks if the given file name ends with one of the extensions in
+   * \ref plugin_extensions_, ignoring case.
+   * \param file_name File name to check.
+   * \return True if the file is a plugin.
+   */
+  bool isPluginFile(std::string_view file_name) const;
+  /*!
+   * \brief Parses one line of the plugin file. Valid lines consist of optional white space,
+   * an optional '*' marking the plugin as enabled and the plugin name. Lines containing
+   * a '#' are ignored.
+   * \param line Line to parse.
+   * \return The plugin name and status, or an empty optional if the line contains no plugin.
+   */
+  std::optional<std::pair<std::string, bool>> parsePluginFileLine(std::string_view line) const;
   /*! \brief Load plugins from the plugins file. */
   virtual void loadPlugins();
   /*! \brief Writes current load order to plugins file. */
@@ -0,0 +1,458 @@
+#include "pluginrecordindex.h"
+#include "binaryio.h"
+#include "hashutils.h"
+#include "mappedfile.h"
+#include "parseerror.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <ranges>
+#include <set>
+#include <thread>
+#include <xxhash.h>
+
+namespace sfs = std::filesystem;
+namespace str = std::ranges;
+
+
+namespace
+{
+/*!
+ * \brief Reads a little endian value from the given position.
+ * \param data Source data.
+ * \return The value.
+ */
+template<typename T>
+T readValue(const char* data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+/*!
+ * \brief Converts the given string to lower case.
+ * \param name String to convert.
+ * \return The converted string.
+ */
+std::string toLower(std::string name)
+{
+  str::transform(name, name.begin(), [](unsigned char c) { return std::tolower(c); });
+  return name;
+}
+}
+
+
+PluginRecordIndex::PluginRecordIndex(const sfs::path& cache_dir, TesPluginHeader::Format format) :
+  cache_dir_(cache_dir), format_(format)
+{
+  try
+  {
+    readState();
+  }
+  catch(const std::runtime_error&)
+  {
+    plugin_states_.clear();
+  }
+}
+
+std::vector<std::string> PluginRecordIndex::update(const sfs::path& source_path,
+                                                   const std::vector<std::string>& plugins,
+                                                   std::optional<ProgressNode*> progress_node)
+{
+  // plugins whose files did not change only have to be hashed again if their cache is missing
+  std::vector<int> changed_plugins;
+  std::vector<std::string> known_hashes;
+  for(int i = 0; i < plugins.size(); i++)
+  {
+    const sfs::path path = source_path / plugins[i];
+    auto iter = plugin_states_.find(plugins[i]);
+    const bool is_unchanged = iter != plugin_states_.end() && sfs::exists(path) &&
+                              iter->second.size == sfs::file_size(path) &&
+                              iter->second.time == sfs::last_write_time(path);
+    if(is_unchanged && records_.contains(iter->second.hash))
+      continue;
+    changed_plugins.push_back(i);
+    known_hashes.push_back(is_unchanged ? iter->second.hash : "");
+  }
+  if(progress_node)
+    (*progress_node)->setTotalSteps(changed_plugins.size() + 1);
+  if(changed_plugins.empty() && plugins == plugins_)
+  {
+    if(progress_node)
+      (*progress_node)->advance();
+    return {};
+  }
+
+  std::vector<std::optional<PluginState>> new_states(changed_plugins.size());
+  std::vector<std::shared_ptr<const PluginRecords>> new_records(changed_plugins.size());
+  std::vector<std::string> errors(changed_plugins.size());
+  {
+    ThreadPool pool;
+    std::vector<std::future<void>> results;
+    results.reserve(changed_plugins.size());
+    for(int i = 0; i < changed_plugins.size(); i++)
+    {
+      const sfs::path path = source_path / plugins[changed_plugins[i]];
+      results.push_back(pool.submit(
+        [this, path, i, &known_hashes, &new_states, &new_records, &errors]()
+        {
+          try
+          {
+            const auto time = sfs::last_write_time(path);
+            const auto size = sfs::file_size(path);
+            std::optional<PluginRecords> records;
+            std::string hash = known_hashes[i];
+            if(!hash.empty())
+              records = readCachedRecords(hash);
+            if(!records)
+            {
+              hash = hash_utils::hashFile(path);
+              records = readCachedRecords(hash);
+            }
+            if(!records)
+            {
+              // invalid plugins are cached without records to avoid reading them again
+              try
+              {
+                records = readPluginRecords(path);
+              }
+              catch(const ParseError& error)
+              {
+                errors[i] = error.what();
+                records = PluginRecords{};
+              }
+              writeCachedRecords(hash, *records);
+            }
+            new_states[i] = { size, time, hash };
+            new_records[i] = std::make_shared<const PluginRecords>(std::move(*records));
+          }
+          catch(const std::runtime_error& error)
+          {
+            errors[i] = error.what();
+          }
+        }));
+    }
+    for(auto& result : results)
+    {
+      result.get();
+      if(progress_node)
+        (*progress_node)->advance();
+    }
+  }
+
+  for(int i = 0; i < changed_plugins.size(); i++)
+  {
+    const std::string& name = plugins[changed_plugins[i]];
+    if(new_states[i])
+    {
+      plugin_states_[name] = *new_states[i];
+      records_[new_states[i]->hash] = new_records[i];
+    }
+    else
+      plugin_states_.erase(name);
+  }
+  const std::set<std::string> plugin_set(plugins.begin(), plugins.end());
+  std::erase_if(plugin_states_,
+                [&plugin_set](const auto& pair) { return !plugin_set.contains(pair.first); });
+  std::set<std::string> used_hashes;
+  for(const auto& [name, state] : plugin_states_)
+    used_hashes.insert(state.hash);
+  std::erase_if(records_,
+                [&used_hashes](const auto& pair) { return !used_hashes.contains(pair.first); });
+
+  plugins_ = plugins;
+  updateSharedRecords();
+  writeState();
+  if(progress_node)
+    (*progress_node)->advance();
+  std::erase_if(errors, [](const auto& error) { return error.empty(); });
+  return errors;
+}
+
+std::vector<int> PluginRecordIndex::getPluginsWithRecord(int plugin, uint32_t form_id) const
+{
+  if(format_ == TesPluginHeader::Format::tes3 || plugin < 0 || plugin >= plugins_.size())
+    return {};
+  auto state_iter = plugin_states_.find(plugins_[plugin]);
+  if(state_iter == plugin_states_.end())
+    return {};
+  std::vector<uint64_t> master_ids;
+  for(const auto& master : records_.at(state_iter->second.hash)->masters)
+    master_ids.push_back(plugin_ids_.at(toLower(master)));
+  const uint64_t record =
+    resolveFormId(form_id, plugin_ids_.at(toLower(plugins_[plugin])), master_ids);
+
+  auto [first, last] =
+    str::equal_range(shared_records_, record, {}, [](const auto& pair) { return pair.first; });
+  std::vector<int> result;
+  for(const auto& [id, other_plugin] : str::subrange(first, last))
+    result.push_back(other_plugin);
+  return result;
+}
+
+std::vector<int> PluginRecordIndex::getOverlappingPlugins(int plugin) const
+{
+  std::vector<int> result;
+  if(plugin < 0 || plugin >= overlaps_.size())
+    return result;
+  for(int i = 0; i < overlaps_.size(); i++)
+  {
+    if(overlaps_[plugin][i])
+      result.push_back(i);
+  }
+  return result;
+}
+
+bool PluginRecordIndex::pluginsOverlap(int plugin_a, int plugin_b) const
+{
+  if(plugin_a < 0 || plugin_b < 0 || plugin_a >= overlaps_.size() ||
+     plugin_b >= overlaps_.size())
+    return false;
+  return overlaps_[plugin_a][plugin_b];
+}
+
+std::vector<std::pair<int, int>> PluginRecordIndex::getOverlappingPluginPairs() const
+{
+  std::vector<std::pair<int, int>> pairs;
+  for(int i = 0; i < overlaps_.size(); i++)
+  {
+    for(int j = i + 1; j < overlaps_.size(); j++)
+    {
+      if(overlaps_[i][j])
+        pairs.emplace_back(i, j);
+    }
+  }
+  return pairs;
+}
+
+PluginRecordIndex::PluginRecords PluginRecordIndex::readPluginRecords(const sfs::path& path) const
+{
+  const TesPluginHeader header(path, format_);
+  PluginRecords plugin_records{ header.getMasters(), {} };
+  const MappedFile file(path, true);
+  const char* data = file.data();
+  const std::size_t size = file.size();
+
+  if(format_ == TesPluginHeader::Format::tes3)
+  {
+    // Morrowind records have no FormIDs, they are identified by their type and their id
+    constexpr std::size_t header_size = 16;
+    constexpr std::size_t subrecord_header_size = 8;
+    std::size_t pos = header_size + readValue<uint32_t>(data + 4);
+    while(pos + header_size <= size)
+    {
+      const std::size_t record_end = pos + header_size + readValue<uint32_t>(data + pos + 4);
+      if(record_end > size)
+        throw ParseError("Invalid record in \"" + path.string() + "\".");
+      std::size_t sub_pos = pos + header_size;
+      while(sub_pos + subrecord_header_size <= record_end)
+      {
+        const char* type = data + sub_pos;
+        const auto sub_size = readValue<uint32_t>(data + sub_pos + 4);
+        if(sub_pos + subrecord_header_size + sub_size > record_end)
+          break;
+        if(std::memcmp(type, "NAME", 4) == 0 || std::memcmp(type, "INDX", 4) == 0 ||
+           std::memcmp(type, "INTV", 4) == 0)
+        {
+          std::string id(data + pos, 4);
+          id.append(data + sub_pos + subrecord_header_size, sub_size);
+          plugin_records.records.push_back(XXH3_64bits(id.data(), id.size()));
+          break;
+        }
+        sub_pos += subrecord_header_size + sub_size;
+      }
+      pos = record_end;
+    }
+    return plugin_records;
+  }
+
+  // record headers are never compressed, so compressed record data can simply be skipped
+  const std::size_t header_size = format_ == TesPluginHeader::Format::tes4 ? 20 : 24;
+  std::size_t pos = header_size + readValue<uint32_t>(data + 4);
+  while(pos + header_size <= size)
+  {
+    // groups only contain other records, so their contents are read like top level records
+    if(std::memcmp(data + pos, "GRUP", 4) == 0)
+    {
+      pos += header_size;
+      continue;
+    }
+    plugin_records.records.push_back(readValue<uint32_t>(data + pos + 12));
+    pos += header_size + readValue<uint32_t>(data + pos + 4);
+  }
+  return plugin_records;
+}
+
+std::optional<PluginRecordIndex::PluginRecords> PluginRecordIndex::readCachedRecords(
+  const std::string& hash) const
+{
+  const sfs::path records_path = cache_dir_ / (hash + RECORDS_EXTENSION);
+  if(!sfs::exists(records_path))
+    return {};
+  try
+  {
+    BinaryReader reader(records_path);
+    if(reader.read<uint32_t>() != MAGIC_NUMBER || reader.read<uint32_t>() != FILE_VERSION ||
+       reader.read<uint32_t>() != static_cast<uint32_t>(format_))
+      return {};
+    PluginRecords plugin_records;
+    const auto num_masters = reader.read<uint32_t>();
+    for(uint32_t i = 0; i < num_masters; i++)
+      plugin_records.masters.push_back(reader.readString());
+    plugin_records.records.resize(reader.read<uint64_t>());
+    reader.readBytes(reinterpret_cast<char*>(plugin_records.records.data()),
+                     plugin_records.records.size() * sizeof(uint64_t));
+    return plugin_records;
+  }
+  catch(const std::runtime_error&)
+  {
+    return {};
+  }
+}
+
+void PluginRecordIndex::writeCachedRecords(const std::string& hash,
+                                           const PluginRecords& plugin_records) const
+{
+  sfs::create_directories(cache_dir_);
+  const sfs::path records_path = cache_dir_ / (hash + RECORDS_EXTENSION);
+  // identical plugins may be written by multiple threads at once
+  sfs::path temp_path = records_path;
+  temp_path += std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    BinaryWriter writer(temp_path);
+    writer.write<uint32_t>(MAGIC_NUMBER);
+    writer.write<uint32_t>(FILE_VERSION);
+    writer.write<uint32_t>(static_cast<uint32_t>(format_));
+    writer.write<uint32_t>(plugin_records.masters.size());
+    for(const auto& master : plugin_records.masters)
+      writer.writeString(master);
+    writer.write<uint64_t>(plugin_records.records.size());
+    writer.writeBytes(reinterpret_cast<const char*>(plugin_records.records.data()),
+                      plugin_records.records.size() * sizeof(uint64_t));
+    writer.flush();
+  }
+  sfs::rename(temp_path, records_path);
+}
+
+void PluginRecordIndex::readState()
+{
+  plugin_states_.clear();
+  const sfs::path state_path = cache_dir_ / STATE_FILE_NAME;
+  if(!sfs::exists(state_path))
+    return;
+  BinaryReader reader(state_path);
+  if(reader.read<uint32_t>() != MAGIC_NUMBER || reader.read<uint32_t>() != FILE_VERSION ||
+     reader.read<uint32_t>() != static_cast<uint32_t>(format_))
+    return;
+  const auto num_plugins = reader.read<uint32_t>();
+  for(uint32_t i = 0; i < num_plugins; i++)
+  {
+    const std::string name = reader.readString();
+    const auto size = reader.read<uint64_t>();
+    const auto time = reader.read<int64_t>();
+    const std::string hash = reader.readString();
+    plugin_states_[name] = {
+      size, sfs::file_time_type(sfs::file_time_type::duration(time)), hash
+    };
+  }
+}
+
+void PluginRecordIndex::writeState() const
+{
+  sfs::create_directories(cache_dir_);
+  const sfs::path state_path = cache_dir_ / STATE_FILE_NAME;
+  sfs::path temp_path = state_path;
+  temp_path += ".tmp";
+  {
+    BinaryWriter writer(temp_path);
+    writer.write<uint32_t>(MAGIC_NUMBER);
+    writer.write<uint32_t>(FILE_VERSION);
+    writer.write<uint32_t>(static_cast<uint32_t>(format_));
+    writer.write<uint32_t>(plugin_states_.size());
+    for(const auto& [name, state] : plugin_states_)
+    {
+      writer.writeString(name);
+      writer.write<uint64_t>(state.size);
+      writer.write<int64_t>(state.time.time_since_epoch().count());
+      writer.writeString(state.hash);
+    }
+    writer.flush();
+  }
+  sfs::rename(temp_path, state_path);
+
+  std::set<std::string> used_hashes;
+  for(const auto& [name, state] : plugin_states_)
+    used_hashes.insert(state.hash);
+  for(const auto& dir_entry : sfs::directory_iterator(cache_dir_))
+  {
+    const sfs::path& path = dir_entry.path();
+    if(path.extension() == RECORDS_EXTENSION && !used_hashes.contains(path.stem().string()))
+      sfs::remove(path);
+  }
+}
+
+void PluginRecordIndex::updateSharedRecords()
+{
+  plugin_ids_.clear();
+  auto get_id = [this](const std::string& name)
+  { return plugin_ids_.try_emplace(toLower(name), plugin_ids_.size()).first->second; };
+
+  std::vector<std::pair<uint64_t, int>> records;
+  for(const auto& [i, name] : str::enumerate_view(plugins_))
+  {
+    auto state_iter = plugin_states_.find(name);
+    if(state_iter == plugin_states_.end())
+      continue;
+    const auto& plugin_records = *records_.at(state_iter->second.hash);
+    if(format_ == TesPluginHeader::Format::tes3)
+    {
+      for(uint64_t record : plugin_records.records)
+        records.emplace_back(record, i);
+      continue;
+    }
+    const uint64_t plugin_id = get_id(name);
+    std::vector<uint64_t> master_ids;
+    for(const auto& master : plugin_records.masters)
+      master_ids.push_back(get_id(master));
+    for(uint64_t form_id : plugin_records.records)
+      records.emplace_back(resolveFormId(form_id, plugin_id, master_ids), i);
+  }
+  str::sort(records);
+  records.erase(std::unique(records.begin(), records.end()), records.end());
+
+  const int num_plugins = plugins_.size();
+  shared_records_.clear();
+  overlaps_.assign(num_plugins, std::vector<bool>(num_plugins, false));
+  for(auto first = records.begin(); first != records.end();)
+  {
+    auto last = std::find_if(
+      first, records.end(), [first](const auto& pair) { return pair.first != first->first; });
+    if(last - first > 1)
+    {
+      shared_records_.insert(shared_records_.end(), first, last);
+      for(auto a = first; a != last; a++)
+      {
+        for(auto b = a + 1; b != last; b++)
+        {
+          overlaps_[a->second][b->second] = true;
+          overlaps_[b->second][a->second] = true;
+        }
+      }
+    }
+    first = last;
+  }
+}
+
+uint64_t PluginRecordIndex::resolveFormId(uint32_t form_id,
+                                          uint64_t plugin_id,
+                                          const std::vector<uint64_t>& master_ids)
+{
+  // the highest byte of a FormID is an index into the masters of the containing plugin
+  const uint32_t master_index = form_id >> 24;
+  const uint64_t owner_id = master_index < master_ids.size() ? master_ids[master_index] : plugin_id;
+  return owner_id << 32 | (form_id & 0xffffff);
+}
@@ -0,0 +1,167 @@
+/*!
+ * \file pluginrecordindex.h
+ * \brief Header for the PluginRecordIndex class.
+ */
+
+#pragma once
+
+#include "progressnode.h"
+#include "tespluginheader.h"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/*!
+ * \brief Maps every record in a load order of plugins for a Bethesda game to the plugins
+ * which contain that record.
+ *
+ * The records of every plugin are read once and cached on disk, keyed by the content hash
+ * of the plugin. Updates are incremental: Only plugins whose files have changed since the
+ * last update are read again.
+ */
+class PluginRecordIndex
+{
+public:
+  /*!
+   * \brief Constructor. Loads the state of the last update from the cache directory.
+   * \param cache_dir Directory used to cache records.
+   * \param format Layout of all plugin files.
+   */
+  PluginRecordIndex(const std::filesystem::path& cache_dir, TesPluginHeader::Format format);
+
+  /*!
+   * \brief Updates the index to contain the given plugins. New or changed plugins are read in
+   * parallel.
+   * \param source_path Directory containing all plugins.
+   * \param plugins Names of all plugins in load order. Plugins are referred to by their
+   * index in this vector.
+   * \param progress_node Used to inform about the current progress.
+   * \return For every plugin which could not be read: An error message. Such plugins are
+   * treated as containing no records.
+   */
+  std::vector<std::string> update(const std::filesystem::path& source_path,
+                                  const std::vector<std::string>& plugins,
+                                  std::optional<ProgressNode*> progress_node = {});
+  /*!
+   * \brief Finds all plugins which contain the record with the given FormID. This is only
+   * supported by formats using FormIDs, i.e. not by Morrowind plugins.
+   * \param plugin Plugin which contains the record.
+   * \param form_id FormID of the record, as stored in the given plugin.
+   * \return Indices of all plugins containing the record, in load order. Empty if no other
+   * plugin contains the record.
+   */
+  std::vector<int> getPluginsWithRecord(int plugin, uint32_t form_id) const;
+  /*!
+   * \brief Finds all plugins which share at least one record with the given plugin.
+   * \param plugin Target plugin.
+   * \return Indices of all overlapping plugins, in load order.
+   */
+  std::vector<int> getOverlappingPlugins(int plugin) const;
+  /*!
+   * \brief Checks if the given plugins share at least one record.
+   * \param plugin_a First plugin.
+   * \param plugin_b Second plugin.
+   * \return True if the plugins overlap.
+   */
+  bool pluginsOverlap(int plugin_a, int plugin_b) const;
+  /*!
+   * \brief Finds all pairs of plugins which share at least one record.
+   * \return For every overlapping pair: The indices of both plugins, the smaller one first.
+   */
+  std::vector<std::pair<int, int>> getOverlappingPluginPairs() const;
+
+private:
+  /*! \brief Records read from one plugin file. */
+  struct PluginRecords
+  {
+    /*! \brief Masters of the plugin. Used to resolve FormIDs. */
+    std::vector<std::string> masters;
+    /*! \brief FormIDs of all records or, for Morrowind, hashes of record types and ids. */
+    std::vector<uint64_t> records;
+  };
+
+  /*! \brief Size, modification time and content hash of a plugin file. */
+  struct PluginState
+  {
+    /*! \brief File size. */
+    std::uintmax_t size;
+    /*! \brief Modification time. */
+    std::filesystem::file_time_type time;
+    /*! \brief Content hash. */
+    std::string hash;
+  };
+
+  /*! \brief Identifies cache files. */
+  static constexpr uint32_t MAGIC_NUMBER = 0x5249504c;
+  /*! \brief Current version of the cache file format. */
+  static constexpr uint32_t FILE_VERSION = 1;
+  /*! \brief Name of the file containing the state of all indexed plugins. */
+  static constexpr std::string STATE_FILE_NAME = "plugins.bin";
+  /*! \brief Extension used for files containing the records of one plugin. */
+  static constexpr std::string RECORDS_EXTENSION = ".records";
+
+  /*! \brief Directory used to cache records. */
+  std::filesystem::path cache_dir_;
+  /*! \brief Layout of all plugin files. */
+  TesPluginHeader::Format format_;
+  /*! \brief Names of all indexed plugins, in load order. */
+  std::vector<std::string> plugins_;
+  /*! \brief Maps plugin names to the state of their files when they were last read. */
+  std::map<std::string, PluginState> plugin_states_;
+  /*! \brief Maps content hashes to records read from the plugin with that hash. */
+  std::map<std::string, std::shared_ptr<const PluginRecords>> records_;
+  /*! \brief Maps lower case names of all plugins and their masters to ids. */
+  std::map<std::string, uint64_t> plugin_ids_;
+  /*!
+   * \brief For every record which is contained in more than one plugin: Every pair of
+   * record id and plugin index. Sorted by record id, then plugin index.
+   */
+  std::vector<std::pair<uint64_t, int>> shared_records_;
+  /*! \brief For every pair of plugins: True if they share at least one record. */
+  std::vector<std::vector<bool>> overlaps_;
+
+  /*!
+   * \brief Reads all records of the given plugin file.
+   * \param path Path to the plugin.
+   * \return The records.
+   * \throws ParseError When the file is not a valid plugin.
+   */
+  PluginRecords readPluginRecords(const std::filesystem::path& path) const;
+  /*!
+   * \brief Reads records of a plugin from the cache.
+   * \param hash Content hash of the plugin.
+   * \return The records, or an empty optional if they are not cached.
+   */
+  std::optional<PluginRecords> readCachedRecords(const std::string& hash) const;
+  /*!
+   * \brief Writes records of a plugin to the cache.
+   * \param hash Content hash of the plugin.
+   * \param records Records to write.
+   */
+  void writeCachedRecords(const std::string& hash, const PluginRecords& records) const;
+  /*! \brief Reads \ref plugin_states_ from the cache directory. */
+  void readState();
+  /*! \brief Writes \ref plugin_states_ to the cache directory and deletes unused files. */
+  void writeState() const;
+  /*!
+   * \brief Converts the records of all plugins to ids which do not depend on the load order
+   * and updates \ref shared_records_ and \ref overlaps_.
+   */
+  void updateSharedRecords();
+  /*!
+   * \brief Converts the given FormID to an id which does not depend on the load order.
+   * \param form_id FormID as stored in a plugin.
+   * \param plugin_id Id of the plugin containing the FormID.
+   * \param master_ids Ids of all masters of the plugin.
+   * \return The id.
+   */
+  static uint64_t resolveFormId(uint32_t form_id,
+                                uint64_t plugin_id,
+                                const std::vector<uint64_t>& master_ids);
+};
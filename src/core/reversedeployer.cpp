@@ -1,4 +1,5 @@
 #include "reversedeployer.h"
+#include "binaryio.h"
 #include "pathutils.h"
 #include "json/json.h"
 #include <algorithm>
@@ -8,6 +9,7 @@
 #include <iostream>
 #include <numeric>
 #include <ranges>
+#include <unordered_map>
 
 namespace sfs = std::filesystem;
 namespace pu = path_utils;
@@ -20,15 +22,18 @@ ReverseDeployer::ReverseDeployer(const sfs::path& source_path,
                                  DeployMode deploy_mode,
                                  bool separate_profile_dirs,
                                  bool update_ignore_list) :
-  Deployer(source_path, dest_path, name, deploy_mode), separate_profile_dirs_(separate_profile_dirs)
+  Deployer(source_path, dest_path, name, deploy_mode),
+  content_store_(source_path / store_dir_name_), separate_profile_dirs_(separate_profile_dirs)
 {
   type_ = "Reverse Deployer";
   is_autonomous_ = true;
-  if(sfs::exists(source_path_ / managed_files_name_))
+  if(sfs::exists(source_path_ / managed_files_name_) ||
+     sfs::exists(source_path_ / legacy_managed_files_name_))
     readManagedFiles();
   else
     writeManagedFiles();
-  if(sfs::exists(dest_path_ / ignore_list_file_name_))
+  if(sfs::exists(dest_path_ / ignore_list_file_name_) ||
+     sfs::exists(dest_path_ / legacy_ignore_list_file_name_))
     readIgnoredFiles();
   else if(update_ignore_list)
     updateIgnoredFiles(true);
@@ -65,14 +70,21 @@ std::map<int, unsigned long> ReverseDeployer::deploy(std::optional<ProgressNode*
     const int cur_profile = current_profile_;
     current_profile_ = deployed_profile_;
     if(separate_profile_dirs_)
-      updateManagedFiles(false, { &(*progress_node)->child(1) });
-    unDeploy();
+    {
+      if(progress_node)
+        updateManagedFiles(false, { &(*progress_node)->child(1) });
+      else
+        updateManagedFiles(false);
+      shareProfileFiles(current_profile_);
+    }
+    unDeployChangedFiles(cur_profile);
     current_profile_ = cur_profile;
   }
   if(progress_node)
     updateManagedFiles(false, { &(*progress_node)->child(0) });
   else
     updateManagedFiles(false);
+  shareProfileFiles(current_profile_);
   deployManagedFiles();
   writeManagedFiles();
   return {};
@@ -113,7 +125,7 @@ void ReverseDeployer::setModStatus(int mod_id, bool status)
 
   current_loadorder_[mod_id].second = status;
   managed_files_[current_profile_][current_loadorder_[mod_id].first] = status;
-  writeManagedFiles();
+  logModStatusChange(current_profile_, current_loadorder_[mod_id].first, status);
 }
 
 std::vector<std::vector<int>> ReverseDeployer::getConflictGroups() const
@@ -135,11 +147,30 @@ std::vector<std::string> ReverseDeployer::getModNames() const
 void ReverseDeployer::addProfile(int source)
 {
   managed_files_.push_back({});
+  file_hashes_.resize(managed_files_.size());
   if(source != -1)
   {
     managed_files_.back() = managed_files_[source];
     if(separate_profile_dirs_)
-      sfs::create_directories(source_path_ / std::to_string(managed_files_.size() - 1));
+    {
+      const int new_profile = managed_files_.size() - 1;
+      sfs::create_directories(source_path_ / std::to_string(new_profile));
+      shareProfileFiles(source);
+      ContentStore& store = getContentStore();
+      for(const auto& path : std::views::keys(managed_files_[source]))
+      {
+        const sfs::path full_source_path = getSourcePath(path, source);
+        const sfs::path full_dest_path = getSourcePath(path, new_profile);
+        const auto iter = file_hashes_[source].find(path);
+        if(iter != file_hashes_[source].end() && store.linkFile(iter->second, full_dest_path))
+          file_hashes_[new_profile][path] = iter->second;
+        else if(pu::exists(full_source_path))
+        {
+          sfs::create_directories(full_dest_path.parent_path());
+          sfs::copy(full_source_path, full_dest_path, sfs::copy_options::copy_symlinks);
+        }
+      }
+    }
   }
   writeManagedFiles();
 }
@@ -164,6 +195,10 @@ void ReverseDeployer::removeProfile(int profile)
   }
 
   managed_files_.erase(managed_files_.begin() + profile);
+  if(profile < file_hashes_.size())
+    file_hashes_.erase(file_hashes_.begin() + profile);
+  if(separate_profile_dirs_)
+    collectStoreGarbage();
   if(profile == current_profile_)
   {
     current_profile_ = 0;
@@ -393,8 +428,10 @@ void ReverseDeployer::keepOrRevertFileModifications(const FileChangeChoices& cha
   writeManagedFiles();
 }
 
-void ReverseDeployer::updateDeployedFilesForMod(int mod_id,
-                                                std::optional<ProgressNode*> progress_node) const
+void ReverseDeployer::updateDeployedFilesForMod(
+  int mod_id,
+  std::optional<ProgressNode*> progress_node,
+  const std::optional<std::set<sfs::path>>& changed_files) const
 {
   if(progress_node)
   {
@@ -455,8 +492,9 @@ void ReverseDeployer::enableSeparateDirs(bool enabled)
     sfs::create_directories(temp_path);
     for(const auto& dir_entry : sfs::directory_iterator(source_path_))
     {
-      if(dir_entry.path() != temp_path &&
-         dir_entry.path().string() != (source_path_ / managed_files_name_).string())
+      const sfs::path file_name = dir_entry.path().filename();
+      if(dir_entry.path() != temp_path && file_name != managed_files_name_ &&
+         file_name != managed_files_log_name_ && file_name != store_dir_name_)
       {
         const std::string relative_path = pu::getRelativePath(dir_entry.path(), source_path_);
         sfs::rename(dir_entry.path(), source_path_ / temp_path / relative_path);
@@ -491,12 +529,14 @@ void ReverseDeployer::enableSeparateDirs(bool enabled)
       sfs::rename(dir_entry.path(), source_path_ / relative_path);
     }
     sfs::remove_all(source_path_ / temp_dir);
+    getContentStore().clear();
   }
   for(int prof = 0; prof < managed_files_.size(); prof++)
   {
     if(prof != current_profile_)
       managed_files_[prof].clear();
   }
+  file_hashes_.assign(managed_files_.size(), {});
   separate_profile_dirs_ = enabled;
   writeManagedFiles();
 }
@@ -581,8 +621,46 @@ std::vector<std::vector<int>> ReverseDeployer::getValidModActions() const
 
 void ReverseDeployer::readIgnoredFiles()
 {
+  const sfs::path ignored_list_path = dest_path_ / ignore_list_file_name_;
+  if(!sfs::exists(ignored_list_path))
+  {
+    readLegacyIgnoredFiles();
+    writeIgnoredFiles();
+    sfs::remove(dest_path_ / legacy_ignore_list_file_name_);
+    return;
+  }
+
   ignored_files_.clear();
+  BinaryReader reader(ignored_list_path);
+  if(reader.read<uint32_t>() != ignore_list_magic_number_ ||
+     reader.read<uint32_t>() != state_file_version_)
+    throw ParseError("Unsupported file format: \"" + ignored_list_path.string() + "\".");
+  const auto num_files = reader.read<uint32_t>();
+  for(uint32_t i = 0; i < num_files; i++)
+    ignored_files_.insert(reader.readString());
+}
+
+void ReverseDeployer::writeIgnoredFiles() const
+{
   const sfs::path ignored_list_path = dest_path_ / ignore_list_file_name_;
+  sfs::path temp_path = ignored_list_path;
+  temp_path += ".tmp";
+  {
+    BinaryWriter writer(temp_path);
+    writer.write<uint32_t>(ignore_list_magic_number_);
+    writer.write<uint32_t>(state_file_version_);
+    writer.write<uint32_t>(ignored_files_.size());
+    for(const auto& file : ignored_files_)
+      writer.writeString(file);
+    writer.flush();
+  }
+  sfs::rename(temp_path, ignored_list_path);
+}
+
+void ReverseDeployer::readLegacyIgnoredFiles()
+{
+  ignored_files_.clear();
+  const sfs::path ignored_list_path = dest_path_ / legacy_ignore_list_file_name_;
   std::ifstream file(ignored_list_path, std::ios::binary);
   if(!file.is_open())
     throw std::runtime_error("Could not read \"" + ignored_list_path.string() + "\".");
@@ -592,22 +670,164 @@ void ReverseDeployer::readIgnoredFiles()
     ignored_files_.insert(json_object["ignored_files"][i].asString());
 }
 
-void ReverseDeployer::writeIgnoredFiles() const
+void ReverseDeployer::readManagedFiles()
 {
-  Json::Value json_object;
-  for(const auto& [i, file] : str::enumerate_view(ignored_files_))
-    json_object["ignored_files"][(int)i] = file;
+  const sfs::path managed_files_path = source_path_ / managed_files_name_;
+  if(!sfs::exists(managed_files_path))
+  {
+    readLegacyManagedFiles();
+    writeManagedFiles();
+    sfs::remove(source_path_ / legacy_managed_files_name_);
+    return;
+  }
 
-  const sfs::path ignored_list_path = dest_path_ / ignore_list_file_name_;
-  std::ofstream file(ignored_list_path, std::ios::binary);
-  if(!file.is_open())
-    throw std::runtime_error("Could not write to \"" + ignored_list_path.string() + "\".");
-  file << json_object;
+  BinaryReader reader(managed_files_path);
+  if(reader.read<uint32_t>() != managed_files_magic_number_ ||
+     reader.read<uint32_t>() != state_file_version_)
+    throw ParseError("Unsupported file format: \"" + managed_files_path.string() + "\".");
+
+  separate_profile_dirs_ = reader.read<uint8_t>();
+  deployed_profile_ = reader.read<int32_t>();
+  number_of_files_in_target_ = reader.read<int32_t>();
+
+  std::vector<sfs::path> paths(reader.read<uint32_t>());
+  for(auto& path : paths)
+    path = reader.readString();
+
+  managed_files_.clear();
+  file_hashes_.clear();
+  const auto num_profiles = reader.read<uint32_t>();
+  for(uint32_t prof = 0; prof < num_profiles; prof++)
+  {
+    managed_files_.push_back({});
+    file_hashes_.push_back({});
+    const std::vector<bool> is_managed = reader.readBits();
+    const std::vector<bool> is_enabled = reader.readBits();
+    if(is_managed.size() != paths.size() || is_enabled.size() != paths.size())
+      throw ParseError("Invalid profile data in \"" + managed_files_path.string() + "\".");
+    for(int i = 0; i < paths.size(); i++)
+    {
+      if(is_managed[i])
+        managed_files_[prof].emplace(paths[i], is_enabled[i]);
+    }
+    const auto num_hashes = reader.read<uint32_t>();
+    for(uint32_t i = 0; i < num_hashes; i++)
+    {
+      const auto path_id = reader.read<uint32_t>();
+      const std::string hash = reader.readString();
+      if(path_id < paths.size())
+        file_hashes_[prof][paths[path_id]] = hash;
+    }
+  }
+
+  deployed_loadorder_.clear();
+  const auto num_deployed_files = reader.read<uint32_t>();
+  deployed_loadorder_.reserve(num_deployed_files);
+  for(uint32_t i = 0; i < num_deployed_files; i++)
+  {
+    const auto path_id = reader.read<uint32_t>();
+    if(path_id >= paths.size())
+      throw ParseError("Invalid path id in \"" + managed_files_path.string() + "\".");
+    deployed_loadorder_.emplace_back(paths[path_id], false);
+  }
+  const std::vector<bool> deployed_status = reader.readBits();
+  if(deployed_status.size() != deployed_loadorder_.size())
+    throw ParseError("Invalid load order data in \"" + managed_files_path.string() + "\".");
+  for(int i = 0; i < deployed_status.size(); i++)
+    deployed_loadorder_[i].second = deployed_status[i];
+
+  num_log_entries_ = 0;
+  if(sfs::exists(source_path_ / managed_files_log_name_))
+    replayManagedFilesLog();
+  updateCurrentLoadorder();
 }
 
-void ReverseDeployer::readManagedFiles()
+void ReverseDeployer::writeManagedFiles()
 {
+  std::vector<std::string> paths;
+  std::unordered_map<sfs::path, uint32_t> path_ids;
+  auto get_path_id = [&paths, &path_ids](const sfs::path& path)
+  {
+    const auto [iter, inserted] = path_ids.try_emplace(path, paths.size());
+    if(inserted)
+      paths.push_back(path.string());
+    return iter->second;
+  };
+  for(const auto& files : managed_files_)
+  {
+    for(const auto& path : std::views::keys(files))
+      get_path_id(path);
+  }
+  for(const auto& path : std::views::keys(deployed_loadorder_))
+    get_path_id(path);
+
   const sfs::path managed_files_path = source_path_ / managed_files_name_;
+  if(!sfs::exists(managed_files_path.parent_path()))
+    sfs::create_directories(managed_files_path.parent_path());
+  sfs::path temp_path = managed_files_path;
+  temp_path += ".tmp";
+  {
+    BinaryWriter writer(temp_path);
+    writer.write<uint32_t>(managed_files_magic_number_);
+    writer.write<uint32_t>(state_file_version_);
+    writer.write<uint8_t>(separate_profile_dirs_);
+    writer.write<int32_t>(deployed_profile_);
+    writer.write<int32_t>(number_of_files_in_target_);
+    writer.write<uint32_t>(paths.size());
+    for(const auto& path : paths)
+      writer.writeString(path);
+
+    writer.write<uint32_t>(managed_files_.size());
+    for(int prof = 0; prof < managed_files_.size(); prof++)
+    {
+      std::vector<bool> is_managed(paths.size(), false);
+      std::vector<bool> is_enabled(paths.size(), false);
+      for(const auto& [path, enabled] : managed_files_[prof])
+      {
+        const uint32_t path_id = path_ids.at(path);
+        is_managed[path_id] = true;
+        is_enabled[path_id] = enabled;
+      }
+      writer.writeBits(is_managed);
+      writer.writeBits(is_enabled);
+
+      std::vector<std::pair<uint32_t, std::string>> hashes;
+      if(prof < file_hashes_.size())
+      {
+        for(const auto& [path, hash] : file_hashes_[prof])
+        {
+          const auto iter = path_ids.find(path);
+          if(iter != path_ids.end())
+            hashes.emplace_back(iter->second, hash);
+        }
+      }
+      writer.write<uint32_t>(hashes.size());
+      for(const auto& [path_id, hash] : hashes)
+      {
+        writer.write<uint32_t>(path_id);
+        writer.writeString(hash);
+      }
+    }
+
+    writer.write<uint32_t>(deployed_loadorder_.size());
+    std::vector<bool> deployed_status;
+    deployed_status.reserve(deployed_loadorder_.size());
+    for(const auto& [path, enabled] : deployed_loadorder_)
+    {
+      writer.write<uint32_t>(path_ids.at(path));
+      deployed_status.push_back(enabled);
+    }
+    writer.writeBits(deployed_status);
+    writer.flush();
+  }
+  sfs::rename(temp_path, managed_files_path);
+  sfs::remove(source_path_ / managed_files_log_name_);
+  num_log_entries_ = 0;
+}
+
+void ReverseDeployer::readLegacyManagedFiles()
+{
+  const sfs::path managed_files_path = source_path_ / legacy_managed_files_name_;
   std::ifstream file(managed_files_path, std::ios::binary);
   if(!file.is_open())
     throw std::runtime_error("Could not read \"" + managed_files_path.string() + "\".");
@@ -615,12 +835,14 @@ void ReverseDeployer::readManagedFiles()
   file >> json_object;
 
   managed_files_.clear();
+  file_hashes_.clear();
   deployed_profile_ = json_object["deployed_profile"].asInt();
   separate_profile_dirs_ = json_object["separate_profile_dirs"].asBool();
   number_of_files_in_target_ = json_object["number_of_files_in_target"].asInt();
   for(int prof = 0; prof < json_object["managed_files"].size(); prof++)
   {
     managed_files_.push_back({});
+    file_hashes_.push_back({});
     for(int i = 0; i < json_object["managed_files"][prof]["files"].size(); i++)
     {
       const sfs::path path = json_object["managed_files"][prof]["files"][i]["path"].asString();
@@ -637,36 +859,45 @@ void ReverseDeployer::readManagedFiles()
   updateCurrentLoadorder();
 }
 
-void ReverseDeployer::writeManagedFiles() const
+void ReverseDeployer::logModStatusChange(int profile, const sfs::path& path, bool status)
 {
-  Json::Value json_object;
-  json_object["separate_profile_dirs"] = separate_profile_dirs_;
-  json_object["deployed_profile"] = deployed_profile_;
-  json_object["number_of_files_in_target"] = number_of_files_in_target_;
-  for(int prof = 0; prof < managed_files_.size(); prof++)
   {
-    json_object["managed_files"][prof]["profile"] = prof;
-    for(const auto& [i, pair] : str::enumerate_view(managed_files_[prof]))
+    BinaryWriter writer(source_path_ / managed_files_log_name_, true);
+    writer.write<int32_t>(profile);
+    writer.writeString(path.string());
+    writer.write<uint8_t>(status);
+    writer.flush();
+  }
+  num_log_entries_++;
+  if(num_log_entries_ >= max_log_entries_)
+    writeManagedFiles();
+}
+
+void ReverseDeployer::replayManagedFilesLog()
+{
+  BinaryReader reader(source_path_ / managed_files_log_name_);
+  try
+  {
+    while(!reader.atEnd())
     {
-      const auto& [path, enabled] = pair;
-      json_object["managed_files"][prof]["files"][(int)i]["path"] = path.string();
-      json_object["managed_files"][prof]["files"][(int)i]["enabled"] = enabled;
+      const auto profile = reader.read<int32_t>();
+      const sfs::path path = reader.readString();
+      const bool status = reader.read<uint8_t>();
+      num_log_entries_++;
+      if(profile < 0 || profile >= managed_files_.size())
+        continue;
+      auto iter = managed_files_[profile].find(path);
+      if(iter != managed_files_[profile].end())
+        iter->second = status;
     }
   }
-  for(const auto& [i, pair] : str::enumerate_view(deployed_loadorder_))
+  catch(const ParseError&)
   {
-    const auto& [path, enabled] = pair;
-    json_object["deployed_loadorder"][(int)i]["path"] = path.string();
-    json_object["deployed_loadorder"][(int)i]["enabled"] = enabled;
+    log_(Log::LOG_WARNING,
+         std::format("Deployer '{}': Ignoring incomplete entry in '{}'.",
+                     name_,
+                     managed_files_log_name_));
   }
-
-  const sfs::path managed_files_path = source_path_ / managed_files_name_;
-  if(!sfs::exists(managed_files_path.parent_path()))
-    sfs::create_directories(managed_files_path.parent_path());
-  std::ofstream f_stream(managed_files_path, std::ios::binary);
-  if(!f_stream.is_open())
-    throw std::runtime_error("Could not open \"" + managed_files_path.string() + "\".");
-  f_stream << json_object;
 }
 
 int ReverseDeployer::updateFilesInDir(const sfs::path& target_dir,
@@ -684,7 +915,8 @@ int ReverseDeployer::updateFilesInDir(const sfs::path& target_dir,
   {
     current_deployer_path = target_dir;
     found_new_deployer = true;
-    for(const auto& path : std::views::keys(loadDeployedFiles({}, target_dir)))
+    const auto deployed_files_in_dir = getDeployedFiles(target_dir);
+    for(const auto& path : std::views::keys(*deployed_files_in_dir))
       new_deployed_files.insert(target_dir / path);
   }
   const std::unordered_set<sfs::path>& current_deployed_files =
@@ -706,6 +938,7 @@ int ReverseDeployer::updateFilesInDir(const sfs::path& target_dir,
     const sfs::path file_name = file.filename();
     const sfs::path path_relative_to_target = pu::getRelativePath(file, dest_path_);
     if(file_name == deployed_files_name_ || file_name == ignore_list_file_name_ ||
+       file_name == legacy_ignore_list_file_name_ ||
        file_name.extension() == backup_extension_ || file_name == managed_dir_file_name_)
       continue;
     if(ignored_files_.contains(path_relative_to_target) || current_deployed_files.contains(file))
@@ -813,11 +1046,15 @@ void ReverseDeployer::updateCurrentLoadorder()
 void ReverseDeployer::deployManagedFiles()
 {
   log_(Log::LOG_INFO, std::format("Deployer '{}': Deploying managed files...", name_));
+  int num_updated_files = 0;
   for(const auto& [path, enabled] : current_loadorder_)
   {
     const sfs::path full_dest_path = dest_path_ / path;
     const sfs::path full_source_path = getSourcePath(path, current_profile_);
 
+    if(fileIsDeployed(path, enabled, current_profile_))
+      continue;
+
     if(!sfs::exists(full_source_path))
     {
       log_(Log::LOG_ERROR,
@@ -827,6 +1064,7 @@ void ReverseDeployer::deployManagedFiles()
       continue;
     }
 
+    num_updated_files++;
     sfs::remove(full_dest_path);
     if(!enabled)
       continue;
@@ -838,10 +1076,52 @@ void ReverseDeployer::deployManagedFiles()
     else
       sfs::copy(full_source_path, full_dest_path);
   }
+  log_(Log::LOG_DEBUG,
+       std::format("Deployer '{}': Updated {} of {} managed files.",
+                   name_,
+                   num_updated_files,
+                   current_loadorder_.size()));
   deployed_profile_ = current_profile_;
   deployed_loadorder_ = current_loadorder_;
 }
 
+void ReverseDeployer::unDeployChangedFiles(int next_profile)
+{
+  if(deployed_profile_ < 0 || deployed_profile_ >= managed_files_.size())
+    return;
+  if(next_profile < 0 || next_profile >= managed_files_.size())
+  {
+    unDeploy();
+    return;
+  }
+
+  const auto& next_files = managed_files_[next_profile];
+  for(const auto& [path, _] : managed_files_[deployed_profile_])
+  {
+    const auto iter = next_files.find(path);
+    if(iter != next_files.end() && fileIsDeployed(path, iter->second, next_profile))
+      continue;
+    sfs::remove(dest_path_ / path);
+  }
+  deployed_profile_ = -1;
+  deployed_loadorder_.clear();
+}
+
+bool ReverseDeployer::fileIsDeployed(const sfs::path& path, bool enabled, int profile) const
+{
+  const sfs::path full_dest_path = dest_path_ / path;
+  if(!enabled)
+    return !pu::exists(full_dest_path);
+
+  const sfs::path full_source_path = getSourcePath(path, profile);
+  if(deploy_mode_ == hard_link)
+    return sfs::exists(full_dest_path) && sfs::exists(full_source_path) &&
+           sfs::equivalent(full_source_path, full_dest_path);
+  if(deploy_mode_ == sym_link)
+    return sfs::is_symlink(full_dest_path) && sfs::read_symlink(full_dest_path) == full_source_path;
+  return false;
+}
+
 sfs::path ReverseDeployer::getSourcePath(const sfs::path& path, int profile) const
 {
   if(separate_profile_dirs_)
@@ -849,6 +1129,73 @@ sfs::path ReverseDeployer::getSourcePath(const sfs::path& path, int profile) con
   return source_path_ / path;
 }
 
+ContentStore& ReverseDeployer::getContentStore()
+{
+  if(content_store_.storePath() != source_path_ / store_dir_name_)
+    content_store_ = ContentStore(source_path_ / store_dir_name_);
+  return content_store_;
+}
+
+void ReverseDeployer::shareProfileFiles(int profile)
+{
+  if(!separate_profile_dirs_ || profile < 0 || profile >= managed_files_.size())
+    return;
+
+  file_hashes_.resize(managed_files_.size());
+  auto& hashes = file_hashes_[profile];
+  ContentStore& store = getContentStore();
+  if(!store.supportsReflinks())
+  {
+    if(!hashes.empty())
+    {
+      hashes.clear();
+      collectStoreGarbage();
+    }
+    return;
+  }
+  const int num_removed_hashes = std::erase_if(
+    hashes, [this, profile](const auto& pair) { return !managed_files_[profile].contains(pair.first); });
+  int num_shared_files = 0;
+  for(const auto& path : std::views::keys(managed_files_[profile]))
+  {
+    const sfs::path full_source_path = getSourcePath(path, profile);
+    if(!sfs::is_regular_file(sfs::symlink_status(full_source_path)) ||
+       sfs::file_size(full_source_path) < min_shared_file_size_)
+    {
+      hashes.erase(path);
+      continue;
+    }
+    const auto iter = hashes.find(path);
+    if(iter != hashes.end() && store.isLinked(full_source_path, iter->second))
+      continue;
+    hashes[path] = store.addFile(full_source_path);
+    num_shared_files++;
+  }
+  if(num_shared_files > 0)
+    log_(Log::LOG_DEBUG,
+         std::format("Deployer '{}': Added {} files of profile {} to the store.",
+                     name_,
+                     num_shared_files,
+                     profile));
+  if(num_shared_files > 0 || num_removed_hashes > 0)
+    collectStoreGarbage();
+}
+
+void ReverseDeployer::collectStoreGarbage()
+{
+  std::unordered_set<std::string> referenced_hashes;
+  for(const auto& hashes : file_hashes_)
+  {
+    for(const auto& hash : std::views::values(hashes))
+      referenced_hashes.insert(hash);
+  }
+  const int num_deleted_files = getContentStore().collectGarbage(referenced_hashes);
+  if(num_deleted_files > 0)
+    log_(Log::LOG_DEBUG,
+         std::format(
+           "Deployer '{}': Deleted {} unused files from the store.", name_, num_deleted_files));
+}
+
 void ReverseDeployer::deleteFile(const sfs::path& path, int profile)
 {
   sfs::remove(dest_path_ / path);
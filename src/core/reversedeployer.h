@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "contentstore.h"
 #include "deployer.h"
 
 
@@ -203,10 +204,12 @@ public:
    * \brief This is not supported for this deployer type.
    * \param mod_id Ignored.
    * \param progress_node Ignored.
+   * \param changed_files Ignored.
    */
   virtual void updateDeployedFilesForMod(
     int mod_id,
-    std::optional<ProgressNode*> progress_node = {}) const override;
+    std::optional<ProgressNode*> progress_node = {},
+    const std::optional<std::set<std::filesystem::path>>& changed_files = {}) const override;
   /*!
    * \brief Adds all files currently in the target directory and not managed by another deployer
    * to the list of ignored files.
@@ -289,13 +292,48 @@ public:
 
 private:
   /*! \brief Name of the file containing paths of ignored files. */
-  const std::string ignore_list_file_name_ = ".revdepl-ignored_files.json";
-  /*! \brief Name of the file containing file paths and activation status for every profile. */
-  const std::string managed_files_name_ = ".revdepl-managed_files.json";
-  /*! \brief Name of the file containing the currently deployed load order. */
-  const std::string deployed_loadorder_name_ = ".revdepl-deployed_files.json";
+  const std::string ignore_list_file_name_ = ".revdepl-ignored_files.bin";
+  /*! \brief Name of the JSON file which contained paths of ignored files in older versions. */
+  const std::string legacy_ignore_list_file_name_ = ".revdepl-ignored_files.json";
+  /*!
+   * \brief Name of the file containing file paths and activation status for every profile
+   * as well as the currently deployed load order.
+   */
+  const std::string managed_files_name_ = ".revdepl-managed_files.bin";
+  /*! \brief Name of the JSON file which contained managed files in older versions. */
+  const std::string legacy_managed_files_name_ = ".revdepl-managed_files.json";
+  /*!
+   * \brief Name of the file to which changes of activation status are appended until they are
+   * written to the managed files file.
+   */
+  const std::string managed_files_log_name_ = ".revdepl-managed_files.log";
+  /*! \brief Identifies the managed files file. */
+  static constexpr uint32_t managed_files_magic_number_ = 0x4d44524c;
+  /*! \brief Identifies the ignored files file. */
+  static constexpr uint32_t ignore_list_magic_number_ = 0x4944524c;
+  /*! \brief Version of the managed and ignored files file formats. */
+  static constexpr uint32_t state_file_version_ = 1;
+  /*! \brief After this many logged changes, the log is merged into the managed files file. */
+  static constexpr int max_log_entries_ = 1000;
+  /*!
+   * \brief Name of the directory in source_path_ in which files shared by profiles are stored,
+   * when separate profile directories are used.
+   */
+  const std::string store_dir_name_ = ".revdepl-store";
+  /*!
+   * \brief Files smaller than this are not shared between profiles, since they gain little
+   * from it and are often edited in place.
+   */
+  static constexpr std::uintmax_t min_shared_file_size_ = 1 << 20;
   /*! \brief For every profile: A vector containing every file that is not to be deployed. */
   std::vector<std::map<std::filesystem::path, bool>> managed_files_;
+  /*!
+   * \brief For every profile: Maps files which are shared with other profiles to their
+   * content hash in the store.
+   */
+  std::vector<std::map<std::filesystem::path, std::string>> file_hashes_;
+  /*! \brief Stores files shared by profiles. Kept to avoid probing for reflink support twice. */
+  ContentStore content_store_;
   /*! \brief Contains all files and their enabled status for the current load order. */
   std::vector<std::pair<std::filesystem::path, bool>> current_loadorder_;
   /*! \brief Contains all files and their enabled status for the currently deployed load order. */
@@ -313,15 +351,41 @@ private:
   const int deploy_priority_ = 2;
   /*! \brief The total number of files in the target directory during previous deployment. */
   int number_of_files_in_target_ = 0;
+  /*! \brief Number of changes in the managed files log. */
+  int num_log_entries_ = 0;
 
-  /*! \brief Reads a list of ignored files from the ignore list file. */
+  /*!
+   * \brief Reads a list of ignored files from the ignore list file.
+   * Converts files in the legacy JSON format to the current format.
+   */
   void readIgnoredFiles();
   /*! \brief Writes the list of ignored files to disk. */
   void writeIgnoredFiles() const;
-  /*! \brief Reads all files for every profile from a file in source_path_. */
+  /*! \brief Reads a list of ignored files from the legacy JSON ignore list file. */
+  void readLegacyIgnoredFiles();
+  /*!
+   * \brief Reads all files for every profile from a file in source_path_, then applies all
+   * logged changes. Converts files in the legacy JSON format to the current format.
+   */
   void readManagedFiles();
-  /*! \brief Writes all files for every profile to a file in source_path_. */
-  void writeManagedFiles() const;
+  /*!
+   * \brief Writes all files for every profile to a file in source_path_.
+   * Paths are stored once for all profiles, activation states as one bit per path and profile.
+   * Clears the log of changes.
+   */
+  void writeManagedFiles();
+  /*! \brief Reads all files for every profile from the legacy JSON file in source_path_. */
+  void readLegacyManagedFiles();
+  /*!
+   * \brief Appends the given activation status change to the log. Writes the managed files
+   * file once the log becomes too large.
+   * \param profile Profile containing the file.
+   * \param path Relative path to the file.
+   * \param status The new status.
+   */
+  void logModStatusChange(int profile, const std::filesystem::path& path, bool status);
+  /*! \brief Applies all changes in the log to managed_files_. */
+  void replayManagedFilesLog();
   /*!
    * \brief Recursively adds all files not ignored or handled by other deployers in
    * dir to profile_files_ for the current profile.
@@ -340,8 +404,26 @@ private:
   void moveFilesFromTargetToSource() const;
   /*! \brief Updates current_loadorder_ to reflect managed_files_[current_profile_]. */
   void updateCurrentLoadorder();
-  /*! \brief Uses the operation specified in deploy mode to copy/ link files from source to target.*/
+  /*!
+   * \brief Uses the operation specified in deploy mode to copy/ link files from source to target.
+   * Files which are already deployed for the current profile are not touched.
+   */
   void deployManagedFiles();
+  /*!
+   * \brief Removes all files of the currently deployed profile from the target directory,
+   * except those which are deployed exactly as they would be for the given profile.
+   * \param next_profile The profile which is to be deployed next.
+   */
+  void unDeployChangedFiles(int next_profile);
+  /*!
+   * \brief Checks if the given file is currently deployed in the target directory exactly
+   * as it would be deployed for the given profile.
+   * \param path Relative path to the file.
+   * \param enabled Whether or not the file is enabled in the given profile.
+   * \param profile Profile from which the file would be deployed.
+   * \return True if the file does not need to be updated.
+   */
+  bool fileIsDeployed(const std::filesystem::path& path, bool enabled, int profile) const;
   /*!
    * \brief Returns the full path pointing to the given file in source_path_.
    * \param path Relative path to to convert.
@@ -349,6 +431,22 @@ private:
    * \return The full path.
    */
   std::filesystem::path getSourcePath(const std::filesystem::path& path, int profile) const;
+  /*!
+   * \brief Returns the store used to share identical files between profiles.
+   * Moves the store to the current source path, if it has changed.
+   * \return The store.
+   */
+  ContentStore& getContentStore();
+  /*!
+   * \brief Replaces every file of the given profile with a link to an identical file in the
+   * content store, then deletes all stored files no longer used by any profile.
+   * Does nothing if separate directories are not used or if the file system does not support
+   * reflinks.
+   * \param profile Target profile.
+   */
+  void shareProfileFiles(int profile);
+  /*! \brief Deletes all stored files which are no longer used by any profile. */
+  void collectStoreGarbage();
   /*!
    * \brief Deletes the given file from disk and the given profile. If separate directories are NOT used:
    * Deletes the file from all profiles.
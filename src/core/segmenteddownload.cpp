@@ -0,0 +1,290 @@
+#include "segmenteddownload.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cpr/cpr.h>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <json/json.h>
+
+namespace sfs = std::filesystem;
+namespace str = std::ranges;
+
+
+SegmentedDownload::SegmentedDownload(const std::string& url,
+                                     const sfs::path& file_path,
+                                     int num_connections,
+                                     uint64_t segment_size) :
+  url_(url), file_path_(file_path), num_connections_(std::max(1, num_connections)),
+  segment_size_(std::max<uint64_t>(1, segment_size))
+{
+  part_path_ = file_path_;
+  part_path_ += PART_EXTENSION;
+  state_path_ = file_path_;
+  state_path_ += STATE_EXTENSION;
+}
+
+void SegmentedDownload::download(const std::function<void(uint64_t, uint64_t)>& progress_callback,
+                                 const std::function<void(uint64_t)>& data_callback)
+{
+  const cpr::Response head = cpr::Head(cpr::Url(url_));
+  if(head.error.code != cpr::ErrorCode::OK)
+    throw std::runtime_error(std::format("Download failed: {}", head.error.message));
+  const auto length = head.header.find("Content-Length");
+  const auto ranges = head.header.find("Accept-Ranges");
+  if(head.status_code != 200 || length == head.header.end() || ranges == head.header.end() ||
+     ranges->second != "bytes")
+  {
+    downloadSingle(progress_callback, data_callback);
+    return;
+  }
+  size_ = std::stoull(length->second);
+  validator_.clear();
+  if(auto etag = head.header.find("ETag"); etag != head.header.end())
+    validator_ = etag->second;
+  else if(auto modified = head.header.find("Last-Modified"); modified != head.header.end())
+    validator_ = modified->second;
+
+  const int num_segments = (size_ + segment_size_ - 1) / segment_size_;
+  downloaded_bytes_ = 0;
+  first_missing_segment_ = 0;
+  aborted_ = false;
+  if(readState())
+  {
+    for(int segment = 0; segment < num_segments; segment++)
+    {
+      if(completed_segments_[segment])
+        downloaded_bytes_ += std::min(segment_size_, size_ - segment * segment_size_);
+    }
+  }
+  else
+  {
+    completed_segments_.assign(num_segments, false);
+    std::ofstream part_file(part_path_, std::ios::binary | std::ios::trunc);
+    if(!part_file.is_open())
+      throw std::runtime_error(std::format("Could not write to '{}'.", part_path_.string()));
+    part_file.close();
+    sfs::resize_file(part_path_, size_);
+    std::lock_guard lock(mutex_);
+    writeState();
+  }
+  addProgress(0, progress_callback);
+  {
+    std::lock_guard lock(mutex_);
+    updateDownloadedPrefix(data_callback);
+  }
+
+  std::exception_ptr first_error;
+  {
+    ThreadPool pool(std::min(num_connections_, std::max(1, num_segments)));
+    std::vector<std::future<void>> results;
+    for(int segment = 0; segment < num_segments; segment++)
+    {
+      if(!completed_segments_[segment])
+        results.push_back(
+          pool.submit([this, segment, &progress_callback, &data_callback]()
+                      { downloadSegment(segment, progress_callback, data_callback); }));
+    }
+    for(auto& result : results)
+    {
+      try
+      {
+        result.get();
+      }
+      catch(...)
+      {
+        if(!first_error)
+          first_error = std::current_exception();
+      }
+    }
+  }
+  if(first_error)
+    std::rethrow_exception(first_error);
+
+  if(!str::all_of(completed_segments_, [](bool completed) { return completed; }) ||
+     sfs::file_size(part_path_) != size_)
+    throw std::runtime_error(
+      std::format("Downloaded data for '{}' does not match the expected size of {} bytes.",
+                  file_path_.filename().string(),
+                  size_));
+  sfs::rename(part_path_, file_path_);
+  sfs::remove(state_path_);
+}
+
+uint64_t SegmentedDownload::size() const
+{
+  return size_;
+}
+
+void SegmentedDownload::downloadSingle(
+  const std::function<void(uint64_t, uint64_t)>& progress_callback,
+  const std::function<void(uint64_t)>& data_callback)
+{
+  sfs::remove(state_path_);
+  std::ofstream file(part_path_, std::ios::binary | std::ios::trunc);
+  if(!file.is_open())
+    throw std::runtime_error(std::format("Could not write to '{}'.", part_path_.string()));
+  const cpr::Response response = cpr::Download(
+    file,
+    cpr::Url(url_),
+    cpr::ProgressCallback(
+      [this, &file, &progress_callback, &data_callback](auto download_total,
+                                                        auto download_now,
+                                                        auto upload_total,
+                                                        auto upload_now,
+                                                        intptr_t user_data)
+      {
+        size_ = download_total;
+        if(progress_callback)
+          progress_callback(download_now, download_total);
+        if(data_callback && download_now > 0 && file.flush())
+          data_callback(download_now);
+        return true;
+      }));
+  file.close();
+  if(response.status_code != 200 || !file)
+  {
+    sfs::remove(part_path_);
+    throw std::runtime_error("Download failed with response: \"" + response.status_line +
+                             "\" (code " + std::to_string(response.status_code) + ").");
+  }
+  if(size_ > 0 && sfs::file_size(part_path_) != size_)
+  {
+    sfs::remove(part_path_);
+    throw std::runtime_error(
+      std::format("Downloaded data for '{}' does not match the expected size of {} bytes.",
+                  file_path_.filename().string(),
+                  size_));
+  }
+  sfs::rename(part_path_, file_path_);
+}
+
+void SegmentedDownload::downloadSegment(
+  int segment,
+  const std::function<void(uint64_t, uint64_t)>& progress_callback,
+  const std::function<void(uint64_t)>& data_callback)
+{
+  const uint64_t begin = segment * segment_size_;
+  const uint64_t length = std::min(segment_size_, size_ - begin);
+  const std::string content_range = std::format("bytes {}-{}/{}", begin, begin + length - 1, size_);
+  cpr::Header header{ { "Range", std::format("bytes={}-{}", begin, begin + length - 1) } };
+  // servers answer with the full file instead of a range if the file has changed
+  if(!validator_.empty())
+    header["If-Range"] = validator_;
+
+  std::string error = "Download was aborted.";
+  for(int attempt = 0; attempt < MAX_ATTEMPTS && !aborted_; attempt++)
+  {
+    std::fstream file(part_path_, std::ios::binary | std::ios::in | std::ios::out);
+    if(!file.is_open())
+      throw std::runtime_error(std::format("Could not write to '{}'.", part_path_.string()));
+    file.seekp(begin);
+    uint64_t received = 0;
+    const cpr::Response response =
+      cpr::Get(cpr::Url(url_),
+               header,
+               cpr::WriteCallback(
+                 [this, &file, &received, length, &progress_callback](std::string_view data,
+                                                                      intptr_t user_data)
+                 {
+                   if(aborted_ || received + data.size() > length)
+                     return false;
+                   file.write(data.data(), data.size());
+                   received += data.size();
+                   addProgress(data.size(), progress_callback);
+                   return static_cast<bool>(file);
+                 }));
+    file.close();
+    const auto range = response.header.find("Content-Range");
+    if(response.status_code == 206 && received == length && file &&
+       range != response.header.end() && range->second == content_range)
+    {
+      std::lock_guard lock(mutex_);
+      completed_segments_[segment] = true;
+      writeState();
+      updateDownloadedPrefix(data_callback);
+      return;
+    }
+    addProgress(-static_cast<int64_t>(received), progress_callback);
+    if(response.error.code != cpr::ErrorCode::OK)
+      error = response.error.message;
+    else
+      error = std::format("\"{}\" (code {})", response.status_line, response.status_code);
+    // the remote file has changed, retrying would not help
+    if(response.status_code == 200)
+      break;
+  }
+  aborted_ = true;
+  throw std::runtime_error(
+    std::format("Download of bytes {} to {} failed: {}", begin, begin + length - 1, error));
+}
+
+void SegmentedDownload::addProgress(int64_t bytes,
+                                    const std::function<void(uint64_t, uint64_t)>& progress_callback)
+{
+  std::lock_guard lock(mutex_);
+  downloaded_bytes_ += bytes;
+  if(progress_callback)
+    progress_callback(downloaded_bytes_, size_);
+}
+
+void SegmentedDownload::updateDownloadedPrefix(const std::function<void(uint64_t)>& data_callback)
+{
+  const int old_first_missing_segment = first_missing_segment_;
+  while(first_missing_segment_ < completed_segments_.size() &&
+        completed_segments_[first_missing_segment_])
+    first_missing_segment_++;
+  if(data_callback && first_missing_segment_ > old_first_missing_segment)
+    data_callback(std::min(first_missing_segment_ * segment_size_, size_));
+}
+
+bool SegmentedDownload::readState()
+{
+  // without a validator, a changed remote file of the same size would go unnoticed
+  if(validator_.empty() || !sfs::exists(state_path_) || !sfs::exists(part_path_) ||
+     sfs::file_size(part_path_) != size_)
+    return false;
+  Json::Value state;
+  try
+  {
+    std::ifstream file(state_path_, std::fstream::binary);
+    if(!file.is_open())
+      return false;
+    file >> state;
+  }
+  catch(Json::Exception&)
+  {
+    return false;
+  }
+  const int num_segments = (size_ + segment_size_ - 1) / segment_size_;
+  const Json::Value& completed = state["completed_segments"];
+  if(state["version"].asInt() != STATE_VERSION || state["size"].asUInt64() != size_ ||
+     state["validator"].asString() != validator_ ||
+     state["segment_size"].asUInt64() != segment_size_ || !completed.isArray() ||
+     completed.size() != num_segments)
+    return false;
+  completed_segments_.assign(num_segments, false);
+  for(int segment = 0; segment < num_segments; segment++)
+    completed_segments_[segment] = completed[segment].asBool();
+  return true;
+}
+
+void SegmentedDownload::writeState() const
+{
+  Json::Value state;
+  state["version"] = STATE_VERSION;
+  state["size"] = Json::UInt64(size_);
+  state["validator"] = validator_;
+  state["segment_size"] = Json::UInt64(segment_size_);
+  state["completed_segments"] = Json::arrayValue;
+  for(int segment = 0; segment < completed_segments_.size(); segment++)
+    state["completed_segments"][segment] = static_cast<bool>(completed_segments_[segment]);
+  sfs::path tmp_path = state_path_;
+  tmp_path += ".tmp";
+  std::ofstream file(tmp_path, std::fstream::binary);
+  if(!file.is_open())
+    throw std::runtime_error(std::format("Could not write to '{}'.", tmp_path.string()));
+  file << state;
+  file.close();
+  sfs::rename(tmp_path, state_path_);
+}
@@ -0,0 +1,139 @@
+/*!
+ * \file segmenteddownload.h
+ * \brief Header for the SegmentedDownload class.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/*!
+ * \brief Downloads a file over multiple connections using HTTP range requests.
+ *
+ * The file is split into fixed size segments. Data is written to a partial file next to
+ * the target file and completed segments are recorded in a state file. If a download is
+ * interrupted, downloading to the same path again only fetches missing segments, as long as the
+ * remote file has the same size and the same ETag or Last-Modified value. The URL is not part of
+ * the state, since download URLs are often signed and change with every request. Servers without
+ * support for range requests are downloaded over one connection.
+ */
+class SegmentedDownload
+{
+public:
+  /*! \brief Default size of one segment. */
+  static constexpr uint64_t DEFAULT_SEGMENT_SIZE = 8 << 20;
+  /*! \brief Default number of parallel connections. */
+  static constexpr int DEFAULT_CONNECTIONS = 4;
+  /*! \brief Extension appended to the target path for the partial file. */
+  static inline const std::string PART_EXTENSION = ".part";
+  /*! \brief Extension appended to the target path for the state file. */
+  static inline const std::string STATE_EXTENSION = ".partstate";
+
+  /*!
+   * \brief Constructor.
+   * \param url URL of the file.
+   * \param file_path Path to which the file is to be written.
+   * \param num_connections Maximum number of parallel connections.
+   * \param segment_size Size of one segment in bytes.
+   */
+  SegmentedDownload(const std::string& url,
+                    const std::filesystem::path& file_path,
+                    int num_connections = DEFAULT_CONNECTIONS,
+                    uint64_t segment_size = DEFAULT_SEGMENT_SIZE);
+
+  /*!
+   * \brief Downloads the file. On failure, the partial file and state are kept, so that the
+   * download can be resumed.
+   * \param progress_callback Called with the number of bytes downloaded so far and the total
+   * size of the file, or 0 if the size is not known. Calls are serialized.
+   * \param data_callback Called with the number of bytes at the beginning of the partial file
+   * which have been downloaded and written, whenever that number grows. Calls are serialized.
+   * \throws std::runtime_error When the download fails or the downloaded data does not match
+   * the size announced by the server.
+   */
+  void download(const std::function<void(uint64_t, uint64_t)>& progress_callback = {},
+                const std::function<void(uint64_t)>& data_callback = {});
+  /*!
+   * \brief Getter for the size of the file, as announced by the server.
+   * \return The size, or 0 if it is not yet known.
+   */
+  uint64_t size() const;
+
+private:
+  /*! \brief Number of attempts made to download one segment. */
+  static constexpr int MAX_ATTEMPTS = 3;
+  /*! \brief Version of the state file format. */
+  static constexpr int STATE_VERSION = 2;
+
+  /*! \brief URL of the file. */
+  std::string url_;
+  /*! \brief Target path. */
+  std::filesystem::path file_path_;
+  /*! \brief Path to the partial file. */
+  std::filesystem::path part_path_;
+  /*! \brief Path to the state file. */
+  std::filesystem::path state_path_;
+  /*! \brief Maximum number of parallel connections. */
+  int num_connections_;
+  /*! \brief Size of one segment. */
+  uint64_t segment_size_;
+  /*! \brief Size of the file. */
+  uint64_t size_ = 0;
+  /*! \brief ETag or Last-Modified value identifying the remote file version, or empty. */
+  std::string validator_;
+  /*! \brief For every segment: True if it has been downloaded. */
+  std::vector<bool> completed_segments_;
+  /*! \brief Number of bytes downloaded so far. */
+  uint64_t downloaded_bytes_ = 0;
+  /*! \brief Index of the first segment which has not been downloaded. */
+  int first_missing_segment_ = 0;
+  /*! \brief Guards all segment data, downloaded_bytes_ and all callbacks. */
+  std::mutex mutex_;
+  /*! \brief Set when a segment failed, causes all other segments to abort. */
+  std::atomic<bool> aborted_ = false;
+
+  /*!
+   * \brief Downloads the file over one connection.
+   * \param progress_callback Receives the current progress.
+   * \param data_callback Receives the number of bytes written so far.
+   */
+  void downloadSingle(const std::function<void(uint64_t, uint64_t)>& progress_callback,
+                      const std::function<void(uint64_t)>& data_callback);
+  /*!
+   * \brief Downloads one segment into the partial file and records it in the state file.
+   * \param segment Index of the segment.
+   * \param progress_callback Receives the current progress.
+   * \param data_callback Receives the size of the downloaded data at the start of the file.
+   * \throws std::runtime_error When all attempts failed.
+   */
+  void downloadSegment(int segment,
+                       const std::function<void(uint64_t, uint64_t)>& progress_callback,
+                       const std::function<void(uint64_t)>& data_callback);
+  /*!
+   * \brief Advances \ref first_missing_segment_ past all completed segments and informs the
+   * callback if it has moved. Must be called with mutex_ held.
+   * \param data_callback Receives the size of the downloaded data at the start of the file.
+   */
+  void updateDownloadedPrefix(const std::function<void(uint64_t)>& data_callback);
+  /*!
+   * \brief Adds the given number of bytes to the progress and informs the callback.
+   * \param bytes Bytes to add, negative when discarding data.
+   * \param progress_callback Receives the current progress.
+   */
+  void addProgress(int64_t bytes, const std::function<void(uint64_t, uint64_t)>& progress_callback);
+  /*!
+   * \brief Restores completed segments from the state file. Downloads are only resumed if the
+   * server identified the remote file by an ETag or Last-Modified value.
+   * \return True if a state file exists and matches the current remote file.
+   */
+  bool readState();
+  /*! \brief Writes the state file. Must be called with mutex_ held. */
+  void writeState() const;
+};
@@ -0,0 +1,156 @@
+#include "tespluginheader.h"
+#include "parseerror.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sfs = std::filesystem;
+
+
+namespace
+{
+/*!
+ * \brief Reads a little endian value from the given position.
+ * \param data Source data.
+ * \return The value.
+ */
+template<typename T>
+T readValue(const char* data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+/*!
+ * \brief Reads a string which ends at the first null character or after the given size.
+ * \param data Source data.
+ * \param size Maximal length of the string.
+ * \return The string.
+ */
+std::string readString(const char* data, std::size_t size)
+{
+  return std::string(data, strnlen(data, size));
+}
+}
+
+
+TesPluginHeader::TesPluginHeader(const sfs::path& path, Format format)
+{
+  const std::size_t header_size = format == Format::tes3 ? 16 : format == Format::tes4 ? 20 : 24;
+  const int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    throw ParseError("Could not open \"" + path.string() + "\".");
+  struct stat file_stats;
+  uint32_t data_size = 0;
+  if(fstat(fd, &file_stats) != 0 || static_cast<std::size_t>(file_stats.st_size) < header_size ||
+     pread(fd, &data_size, sizeof(data_size), 4) != sizeof(data_size))
+  {
+    close(fd);
+    throw ParseError("Invalid plugin header in \"" + path.string() + "\".");
+  }
+  // the record size is stored at the same offset in every format
+  const std::size_t record_size =
+    std::min<std::size_t>(header_size + data_size, file_stats.st_size);
+  void* data = mmap(nullptr, record_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED)
+    throw ParseError("Could not read \"" + path.string() + "\".");
+  try
+  {
+    if(format == Format::tes3)
+      parseTes3Header(static_cast<const char*>(data), record_size, path);
+    else
+      parseTes4Header(static_cast<const char*>(data), record_size, header_size, path);
+  }
+  catch(...)
+  {
+    munmap(data, record_size);
+    throw;
+  }
+  munmap(data, record_size);
+}
+
+uint32_t TesPluginHeader::getFlags() const
+{
+  return flags_;
+}
+
+bool TesPluginHeader::hasFlag(uint32_t flag) const
+{
+  return (flags_ & flag) != 0;
+}
+
+const std::vector<std::string>& TesPluginHeader::getMasters() const
+{
+  return masters_;
+}
+
+const std::string& TesPluginHeader::getDescription() const
+{
+  return description_;
+}
+
+void TesPluginHeader::parseTes3Header(const char* data, std::size_t size, const sfs::path& path)
+{
+  constexpr std::size_t header_size = 16;
+  constexpr std::size_t subrecord_header_size = 8;
+  if(std::memcmp(data, "TES3", 4) != 0)
+    throw ParseError("\"" + path.string() + "\" is not a Morrowind plugin.");
+  flags_ = readValue<uint32_t>(data + 12);
+  std::size_t pos = header_size;
+  while(pos + subrecord_header_size <= size)
+  {
+    const char* type = data + pos;
+    const auto subrecord_size = readValue<uint32_t>(data + pos + 4);
+    pos += subrecord_header_size;
+    if(pos + subrecord_size > size)
+      throw ParseError("Invalid plugin header in \"" + path.string() + "\".");
+    if(std::memcmp(type, "HEDR", 4) == 0 && subrecord_size >= 296)
+    {
+      // the file flags in HEDR mark the plugin as master
+      flags_ |= readValue<uint32_t>(data + pos + 4) & MASTER_FLAG;
+      description_ = readString(data + pos + 40, 256);
+    }
+    else if(std::memcmp(type, "MAST", 4) == 0)
+      masters_.push_back(readString(data + pos, subrecord_size));
+    pos += subrecord_size;
+  }
+}
+
+void TesPluginHeader::parseTes4Header(const char* data,
+                                      std::size_t size,
+                                      std::size_t header_size,
+                                      const sfs::path& path)
+{
+  constexpr std::size_t subrecord_header_size = 6;
+  if(std::memcmp(data, "TES4", 4) != 0)
+    throw ParseError("\"" + path.string() + "\" is not a valid plugin.");
+  flags_ = readValue<uint32_t>(data + 8);
+  std::size_t pos = header_size;
+  uint32_t large_subrecord_size = 0;
+  while(pos + subrecord_header_size <= size)
+  {
+    const char* type = data + pos;
+    uint32_t subrecord_size = readValue<uint16_t>(data + pos + 4);
+    pos += subrecord_header_size;
+    // XXXX subrecords contain the size of the next subrecord, if it exceeds 16 bits
+    if(large_subrecord_size > 0)
+    {
+      subrecord_size = large_subrecord_size;
+      large_subrecord_size = 0;
+    }
+    if(pos + subrecord_size > size)
+      throw ParseError("Invalid plugin header in \"" + path.string() + "\".");
+    if(std::memcmp(type, "XXXX", 4) == 0 && subrecord_size == 4)
+      large_subrecord_size = readValue<uint32_t>(data + pos);
+    else if(std::memcmp(type, "SNAM", 4) == 0)
+      description_ = readString(data + pos, subrecord_size);
+    else if(std::memcmp(type, "MAST", 4) == 0)
+      masters_.push_back(readString(data + pos, subrecord_size));
+    pos += subrecord_size;
+  }
+}
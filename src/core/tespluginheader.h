@@ -0,0 +1,93 @@
+/*!
+ * \file tespluginheader.h
+ * \brief Header for the TesPluginHeader class.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+/*!
+ * \brief Parses and represents the header record of a plugin for a game using a Bethesda
+ * engine, e.g. Morrowind, Oblivion, Skyrim, Fallout or Starfield.
+ *
+ * Only the header record at the start of the file is mapped into memory and read.
+ */
+class TesPluginHeader
+{
+public:
+  /*! \brief Describes the layout of a plugin file. */
+  enum class Format
+  {
+    /*! \brief Morrowind and OpenMW. */
+    tes3,
+    /*! \brief Oblivion. Records have 20 byte headers. */
+    tes4,
+    /*! \brief Fallout 3 and newer games. Records have 24 byte headers. */
+    tes5
+  };
+
+  /*! \brief Flag indicating a master plugin. */
+  static constexpr uint32_t MASTER_FLAG = 0x1;
+
+  /*!
+   * \brief Reads the header record of the given plugin.
+   * \param path Path to the plugin file.
+   * \param format Layout of the plugin file.
+   * \throws ParseError When the file can not be read or is not a valid plugin.
+   */
+  TesPluginHeader(const std::filesystem::path& path, Format format);
+
+  /*!
+   * \brief Getter for the flags of the header record.
+   * \return The flags.
+   */
+  uint32_t getFlags() const;
+  /*!
+   * \brief Checks if the given flag is set in the header record.
+   * \param flag Flag to check.
+   * \return True if the flag is set.
+   */
+  bool hasFlag(uint32_t flag) const;
+  /*!
+   * \brief Getter for the file names of all masters of this plugin, in load order.
+   * \return The masters.
+   */
+  const std::vector<std::string>& getMasters() const;
+  /*!
+   * \brief Getter for the plugin description.
+   * \return The description.
+   */
+  const std::string& getDescription() const;
+
+private:
+  /*! \brief Flags of the header record. */
+  uint32_t flags_ = 0;
+  /*! \brief File names of all masters. */
+  std::vector<std::string> masters_;
+  /*! \brief Plugin description. */
+  std::string description_;
+
+  /*!
+   * \brief Parses a Morrowind header record.
+   * \param data Start of the record.
+   * \param size Size of the record, including its header.
+   * \param path Path to the plugin file. Used for error messages.
+   */
+  void parseTes3Header(const char* data, std::size_t size, const std::filesystem::path& path);
+  /*!
+   * \brief Parses an Oblivion or newer header record.
+   * \param data Start of the record.
+   * \param size Size of the record, including its header.
+   * \param header_size Size of the record header.
+   * \param path Path to the plugin file. Used for error messages.
+   */
+  void parseTes4Header(const char* data,
+                       std::size_t size,
+                       std::size_t header_size,
+                       const std::filesystem::path& path);
+};
@@ -0,0 +1,44 @@
+#include "threadpool.h"
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+{
+  if(num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  workers_.reserve(num_threads);
+  for(unsigned int i = 0; i < num_threads; i++)
+    workers_.emplace_back([this]() { runWorker(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard lock(mutex_);
+    stopped_ = true;
+  }
+  condition_.notify_all();
+  workers_.clear();
+}
+
+unsigned int ThreadPool::numThreads() const
+{
+  return workers_.size();
+}
+
+void ThreadPool::runWorker()
+{
+  while(true)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      condition_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+      if(tasks_.empty())
+        return;
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
@@ -0,0 +1,74 @@
+/*!
+ * \file threadpool.h
+ * \brief Header for the ThreadPool class.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/*!
+ * \brief Executes tasks on a fixed number of worker threads.
+ */
+class ThreadPool
+{
+public:
+  /*!
+   * \brief Starts the worker threads.
+   * \param num_threads Number of worker threads. If 0: Use one thread per hardware thread.
+   */
+  ThreadPool(unsigned int num_threads = 0);
+  /*! \brief Waits for all queued tasks to finish, then stops all worker threads. */
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /*!
+   * \brief Queues the given task for execution.
+   * \param task Task to be executed.
+   * \return A future holding the result of the task. Exceptions thrown by the task are
+   * rethrown when calling get on this future.
+   */
+  template<typename F>
+  std::future<std::invoke_result_t<F>> submit(F&& task)
+  {
+    using R = std::invoke_result_t<F>;
+    auto packaged_task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+    std::future<R> future = packaged_task->get_future();
+    {
+      std::lock_guard lock(mutex_);
+      tasks_.emplace([packaged_task]() { (*packaged_task)(); });
+    }
+    condition_.notify_one();
+    return future;
+  }
+  /*!
+   * \brief Returns the number of worker threads.
+   * \return The number of threads.
+   */
+  unsigned int numThreads() const;
+
+private:
+  /*! \brief The worker threads. */
+  std::vector<std::jthread> workers_;
+  /*! \brief Tasks waiting to be executed. */
+  std::queue<std::function<void()>> tasks_;
+  /*! \brief Guards tasks_ and stopped_. */
+  std::mutex mutex_;
+  /*! \brief Used to notify workers about new tasks. */
+  std::condition_variable condition_;
+  /*! \brief If true: Workers exit once all tasks are done. */
+  bool stopped_ = false;
+
+  /*! \brief Executes queued tasks until the pool is stopped. */
+  void runWorker();
+};
@@ -23,6 +23,7 @@ AddAppDialog::AddAppDialog(bool is_flatpak, QWidget* parent) :
 {
   ui->setupUi(this);
   ui->move_dir_box->setVisible(false);
+  ui->content_store_box->setVisible(false);
   ui->import_checkbox->setVisible(false);
   ui->import_tags_checkbox->setVisible(false);
   enableOkButton(false);
@@ -304,7 +305,8 @@ void AddAppDialog::setEditMode(const QString& name,
                                const QString& command,
                                const QString& icon_path,
                                int app_id,
-                               long steam_app_id)
+                               long steam_app_id,
+                               bool uses_content_store)
 {
   deployers_.clear();
   auto_tags_.clear();
@@ -323,6 +325,8 @@ void AddAppDialog::setEditMode(const QString& name,
   enableOkButton(true);
   edit_mode_ = true;
   ui->move_dir_box->setVisible(true);
+  ui->content_store_box->setChecked(uses_content_store);
+  ui->content_store_box->setVisible(true);
   setWindowTitle("Edit " + name_);
   ui->name_field->setText(name);
   ui->version_field->setText(app_version);
@@ -356,6 +360,7 @@ void AddAppDialog::setAddMode()
   enableOkButton(false);
   edit_mode_ = false;
   ui->move_dir_box->setVisible(false);
+  ui->content_store_box->setVisible(false);
   dialog_completed_ = false;
 }
 
@@ -374,6 +379,7 @@ void AddAppDialog::on_buttonBox_accepted()
   if(edit_mode_)
   {
     info.move_staging_dir = ui->move_dir_box->checkState() == Qt::Checked;
+    info.use_content_store = ui->content_store_box->isChecked();
     emit applicationEdited(info, app_id_);
   }
   else
@@ -130,6 +130,7 @@ public:
    * \param command Current command to run the edited \ref ModdedApplication "application".
    * \param app_id Id of the edited \ref ModdedApplication "application".
    * \param steam_app_id Steam app id. Or -1 if not a Steam app.
+   * \param uses_content_store Whether identical mod files are currently stored only once.
    */
   void setEditMode(const QString& name,
                    const QString& app_version,
@@ -137,7 +138,8 @@ public:
                    const QString& command,
                    const QString& icon_path,
                    int app_id,
-                   long steam_app_id);
+                   long steam_app_id,
+                   bool uses_content_store);
   /*!
    *  \brief Initializes this dialog to allow creating a new
    *  \ref ModdedApplication "application".
@@ -1,12 +1,17 @@
 #include "applicationmanager.h"
 #include "../core/deployerfactory.h"
+#include "../core/downloadindex.h"
+#include "../core/growingfilereader.h"
+#include "../core/hashutils.h"
 #include "../core/installer.h"
 #include "../core/pathutils.h"
+#include "../core/segmenteddownload.h"
 #include <QCoreApplication>
 #include <QDebug>
 #include <QMessageBox>
 #include <QSettings>
 #include <QUrl>
+#include <future>
 #include <regex>
 
 namespace sfs = std::filesystem;
@@ -23,6 +28,16 @@ bool performDownload(ImportModInfo& info, ApplicationManager* app_mgr)
   sfs::path download_path = info.target_path;
   if(!sfs::exists(download_path))
     sfs::create_directories(download_path);
+  DownloadIndex download_index(download_path);
+  if(auto archive_path = download_index.findRemoteFile(info.remote_mod_id, info.remote_file_id))
+  {
+    app_mgr->sendLogMessage(
+      Log::LOG_INFO,
+      std::format("Using previously downloaded archive \"{}\".", archive_path->filename().string()));
+    info.local_source = *archive_path;
+    info.current_path = info.local_source;
+    return true;
+  }
   sfs::path file_name = match[1].str();
   const std::string file_name_prefix = file_name.stem();
   const std::string extension = file_name.extension();
@@ -41,20 +56,63 @@ bool performDownload(ImportModInfo& info, ApplicationManager* app_mgr)
   }
   file_name = file_name_str;
 
-  auto progress_callback = [app_mgr](float progress) { app_mgr->sendUpdateProgress(progress); };
-  std::ofstream fstream(download_path / file_name, std::ios::binary);
-  if(!fstream.is_open())
-    throw std::runtime_error("Failed to write to disk.");
+  // streamable archives are extracted while downloading, reading data from the partial file
+  const sfs::path extraction_path =
+    download_path / (file_name.string() + ApplicationManager::STREAM_EXTRACTION_EXTENSION);
+  sfs::path part_path = download_path / file_name;
+  part_path += SegmentedDownload::PART_EXTENSION;
+  std::optional<GrowingFileReader> reader;
+  std::future<bool> extraction;
+  // the downloaded data is hashed in order while the remaining segments are still being fetched
+  GrowingFileReader hash_reader(part_path);
+  std::future<std::optional<std::pair<std::string, std::string>>> hashing;
   bool message_sent = false;
-  cpr::Response response = cpr::Download(
-    fstream,
-    cpr::Url(info.remote_download_url),
-    cpr::ProgressCallback(
-      [app_mgr, &message_sent, &file_name, progress_callback](auto download_total,
-                                                              auto download_now,
-                                                              auto upload_total,
-                                                              auto upload_now,
-                                                              intptr_t user_data)
+  uint64_t file_size = 0;
+  // both readers must be finished on every error, otherwise waiting on their tasks never returns
+  try
+  {
+    if(Installer::isStreamable(file_name))
+    {
+      sfs::remove_all(extraction_path);
+      reader.emplace(part_path);
+      extraction = std::async(
+        std::launch::async,
+        [&reader, &extraction_path, app_mgr]()
+        {
+          try
+          {
+            Installer::extractStream([&reader](char* buffer, size_t size)
+                                     { return reader->read(buffer, size); },
+                                     extraction_path);
+            return true;
+          }
+          catch(std::exception& error)
+          {
+            app_mgr->sendLogMessage(
+              Log::LOG_DEBUG, std::format("Extraction during download failed: {}", error.what()));
+            sfs::remove_all(extraction_path);
+            return false;
+          }
+        });
+    }
+    hashing = std::async(
+      std::launch::async,
+      [&hash_reader]() -> std::optional<std::pair<std::string, std::string>>
+      {
+        constexpr size_t buffer_size = 1 << 20;
+        auto buffer = std::make_unique<char[]>(buffer_size);
+        hash_utils::StreamHash hash;
+        int64_t size;
+        while((size = hash_reader.read(buffer.get(), buffer_size)) > 0)
+          hash.update(buffer.get(), size);
+        if(size < 0)
+          return {};
+        return std::pair{ hash.xxh3(), hash.md5() };
+      });
+
+    SegmentedDownload download(info.remote_download_url, download_path / file_name);
+    download.download(
+      [app_mgr, &message_sent, &file_name](uint64_t download_now, uint64_t download_total)
       {
         if(!message_sent && download_total > 0)
         {
@@ -86,27 +144,125 @@ bool performDownload(ImportModInfo& info, ApplicationManager* app_mgr)
           message_sent = true;
         }
         if(download_total != 0)
-          progress_callback((float)download_now / (float)download_total);
-        return true;
-      }));
-  if(response.status_code != 200)
+          app_mgr->sendUpdateProgress((float)download_now / (float)download_total);
+      },
+      [&reader, &hash_reader](uint64_t available_bytes)
+      {
+        if(reader)
+          reader->setAvailable(available_bytes);
+        hash_reader.setAvailable(available_bytes);
+      });
+    // the data callback is not guaranteed to have announced the last bytes of the file
+    file_size = sfs::file_size(download_path / file_name);
+  }
+  catch(...)
+  {
+    hash_reader.finish(false);
+    if(hashing.valid())
+      hashing.wait();
+    if(reader)
+    {
+      reader->finish(false);
+      if(extraction.valid())
+        extraction.wait();
+    }
+    throw;
+  }
+  hash_reader.setAvailable(file_size);
+  hash_reader.finish(true);
+  if(reader)
   {
-    sfs::remove(download_path / file_name);
-    throw std::runtime_error("Download failed with response: \"" + response.status_line +
-                             "\" (code " + std::to_string(response.status_code) + ").");
+    reader->setAvailable(file_size);
+    reader->finish(true);
+    if(extraction.get())
+      info.streamed_extraction_path = extraction_path;
+  }
+
+  sfs::path archive_path = download_path / file_name;
+  const auto hashes = hashing.get();
+  if(hashes)
+  {
+    const auto& [hash, md5] = *hashes;
+    if(info.remote_type == ImportModInfo::nexus)
+    {
+      bool is_valid = true;
+      try
+      {
+        const auto matches =
+          nexus::Api::fileMatchesMd5(info.remote_source, info.remote_file_id, md5);
+        if(matches)
+          is_valid = *matches;
+        else
+          app_mgr->sendLogMessage(
+            Log::LOG_WARNING,
+            std::format("Could not verify \"{}\": NexusMods does not list its checksum.",
+                        file_name.string()));
+      }
+      catch(std::exception& error)
+      {
+        app_mgr->sendLogMessage(
+          Log::LOG_WARNING,
+          std::format("Could not verify \"{}\": {}", file_name.string(), error.what()));
+      }
+      if(!is_valid)
+      {
+        sfs::remove(archive_path);
+        sfs::remove_all(extraction_path);
+        info.streamed_extraction_path.clear();
+        throw std::runtime_error(std::format(
+          "Checksum of \"{}\" does not match the file on NexusMods.", file_name.string()));
+      }
+    }
+    if(auto existing_path = download_index.findHash(hash))
+    {
+      app_mgr->sendLogMessage(Log::LOG_INFO,
+                              std::format("\"{}\" is identical to \"{}\", keeping only one copy.",
+                                          file_name.string(),
+                                          existing_path->filename().string()));
+      sfs::remove(archive_path);
+      archive_path = *existing_path;
+    }
+    try
+    {
+      download_index.addArchive(archive_path, hash, md5, info.remote_mod_id, info.remote_file_id);
+    }
+    catch(std::exception& error)
+    {
+      app_mgr->sendLogMessage(Log::LOG_WARNING,
+                              std::format("Could not update download index: {}", error.what()));
+    }
   }
-  fstream.close();
-  info.local_source = download_path / file_name;
+  else
+    app_mgr->sendLogMessage(
+      Log::LOG_DEBUG, std::format("Could not hash \"{}\" during download.", file_name.string()));
+  info.local_source = archive_path;
   info.current_path = info.local_source;
   return true;
 }
 
-bool performExtraction(ImportModInfo& info, ApplicationManager* app_mgr)
+bool performExtraction(ImportModInfo& info,
+                       ApplicationManager* app_mgr,
+                       const sfs::path& index_cache_dir)
 {
   info.last_action_was_successful = false;
   auto progress_callback = [app_mgr](float progress) { app_mgr->sendUpdateProgress(progress); };
   ProgressNode node(progress_callback);
-  Installer::extract(info.local_source, info.target_path, &node);
+  if(!info.streamed_extraction_path.empty() && sfs::exists(info.streamed_extraction_path))
+  {
+    sfs::remove_all(info.target_path);
+    sfs::create_directories(info.target_path.parent_path());
+    sfs::rename(info.streamed_extraction_path, info.target_path);
+    info.streamed_extraction_path.clear();
+    info.is_fomod_preview = false;
+  }
+  else
+  {
+    // fomod installers only need their configuration, files are installed from the archive
+    info.is_fomod_preview =
+      Installer::extractFomodPreview(info.local_source, info.target_path, &node, index_cache_dir);
+    if(!info.is_fomod_preview)
+      Installer::extract(info.local_source, info.target_path, &node, index_cache_dir);
+  }
   info.current_path = info.target_path;
   info.last_action_was_successful = true;
   return true;
@@ -463,6 +619,14 @@ void ApplicationManager::installMod(int app_id, ImportModInfo info)
   emit modInstallationComplete(!has_thrown);
 }
 
+void ApplicationManager::installMods(int app_id, std::vector<ImportModInfo> infos)
+{
+  bool has_thrown = false;
+  if(appIndexIsValid(app_id))
+    has_thrown = handleExceptions<&ModdedApplication::installMods>(app_id, infos);
+  emit modInstallationComplete(!has_thrown);
+}
+
 void ApplicationManager::uninstallMods(int app_id,
                                        std::vector<int> mod_ids,
                                        std::string installer_type)
@@ -616,6 +780,8 @@ void ApplicationManager::editApplication(EditApplicationInfo info, int app_id)
       handleExceptions<&ModdedApplication::setCommand>(app_id, info.command);
       handleExceptions<&ModdedApplication::setIconPath>(app_id, info.icon_path);
       handleExceptions<&ModdedApplication::setAppVersion>(app_id, info.app_version);
+      if(info.use_content_store != apps_[app_id].usesContentStore())
+        handleExceptions<&ModdedApplication::setUseContentStore>(app_id, info.use_content_store);
     }
     updateSettings();
   }
@@ -728,7 +894,10 @@ void ApplicationManager::sortModsByConflicts(int app_id, int deployer)
 
 void ApplicationManager::extractArchive(ImportModInfo info)
 {
-  handleExceptionsForFunction(performExtraction, info, this);
+  sfs::path index_cache_dir;
+  if(appIndexIsValid(info.app_id, false))
+    index_cache_dir = apps_[info.app_id].getArchiveIndexDir();
+  handleExceptionsForFunction(performExtraction, info, this, index_cache_dir);
   emit extractionComplete(info);
 }
 
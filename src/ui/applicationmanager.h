@@ -34,6 +34,12 @@ class ApplicationManager : public QObject
 {
   Q_OBJECT
 public:
+  /*!
+   * \brief Appended to the path of a downloaded archive to get the directory to which the
+   * archive is extracted during the download.
+   */
+  static inline const std::string STREAM_EXTRACTION_EXTENSION = ".extract";
+
   /*!
    * \brief Constructor. Only one instance of this class is support at a time.
    * \param parent This is passed to the constructor of QObject.
@@ -568,6 +574,13 @@ public slots:
    * \param info Contains all data needed to install the mod.
    */
   void installMod(int app_id, ImportModInfo info);
+  /*!
+   * \brief Installs multiple mods for one \ref ModdedApplication "application". Mods are
+   * extracted concurrently.
+   * \param app_id The target \ref ModdedApplication "application".
+   * \param infos Contains all data needed to install each mod.
+   */
+  void installMods(int app_id, std::vector<ImportModInfo> infos);
   /*!
    * \brief Uninstalls the given mods for one \ref ModdedApplication "application", this includes
    * deleting all installed files.
@@ -63,7 +63,11 @@ QVariant ConflictsModel::data(const QModelIndex& index, int role) const
   }
 
   if(role == Qt::ForegroundRole)
+  {
+    if(conflicts_[row].is_identical)
+      return colors::GRAY;
     return conflicts_[row].mod_ids.back() == base_id_ ? colors::GREEN : colors::RED;
+  }
 
   return QVariant();
 }
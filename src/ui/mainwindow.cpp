@@ -65,6 +65,7 @@ Q_DECLARE_METATYPE(ExternalChangesInfo);
 Q_DECLARE_METATYPE(FileChangeChoices);
 Q_DECLARE_METATYPE(Tool);
 Q_DECLARE_METATYPE(ImportModInfo);
+Q_DECLARE_METATYPE(std::vector<ImportModInfo>);
 
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), ui(new Ui::MainWindow)
@@ -186,6 +187,7 @@ void MainWindow::setupConnections()
   qRegisterMetaType<FileChangeChoices>();
   qRegisterMetaType<Tool>();
   qRegisterMetaType<ImportModInfo>();
+  qRegisterMetaType<std::vector<ImportModInfo>>();
 
   connect(this, &MainWindow::getModInfo,
           app_manager_, &ApplicationManager::getModInfo);
@@ -197,6 +199,8 @@ void MainWindow::setupConnections()
           this, &MainWindow::onGetDeployerInfo);
   connect(this, &MainWindow::installMod,
           app_manager_, &ApplicationManager::installMod);
+  connect(this, &MainWindow::installMods,
+          app_manager_, &ApplicationManager::installMods);
   connect(this, &MainWindow::updateModDeployers,
           app_manager_, &ApplicationManager::updateModDeployers);
   connect(this, &MainWindow::uninstallMods,
@@ -861,6 +865,8 @@ void MainWindow::importMod()
       setBusyStatus(false);
       if(!mod_import_queue_.empty())
         importMod();
+      else
+        installPendingMods();
       return;
     }
     setStatusMessage("Downloading mod");
@@ -889,6 +895,29 @@ void MainWindow::importMod()
   }
 }
 
+void MainWindow::installPendingMods()
+{
+  if(pending_installs_.empty())
+    return;
+  const int app_id = pending_installs_.front().app_id;
+  setBusyStatus(true);
+  if(pending_installs_.size() == 1)
+  {
+    const ImportModInfo& info = pending_installs_.front();
+    setStatusMessage(QString("Installing \"") + info.name.c_str() + "\"");
+    Log::info("Installing mod '" + info.name + "'");
+    emit installMod(app_id, info);
+  }
+  else
+  {
+    setStatusMessage(std::format("Installing {} mods", pending_installs_.size()).c_str());
+    Log::info(std::format("Installing {} mods", pending_installs_.size()));
+    emit installMods(app_id, pending_installs_);
+  }
+  pending_installs_.clear();
+  emit getDeployerInfo(app_id, currentDeployer());
+}
+
 void MainWindow::setBusyStatus(bool busy, bool show_progress_bar, bool disable_app_launch)
 {
   enableModifyApps(!busy);
@@ -1448,11 +1477,31 @@ void MainWindow::onModAdded(QList<QUrl> paths)
 
 void MainWindow::onAddModDialogAccept(int app_id, ImportModInfo info)
 {
-  setBusyStatus(true);
-  setStatusMessage(QString("Installing \"") + info.name.c_str() + "\"");
-  Log::info("Installing mod '" + info.name + "'");
-  emit installMod(app_id, info);
-  emit getDeployerInfo(app_id, currentDeployer());
+  if(!mod_import_queue_.empty())
+  {
+    // the next import reuses the temporary directory, so the extracted files are moved
+    std::filesystem::path pending_path = info.current_path;
+    pending_path += "_" + std::to_string(pending_installs_.size());
+    try
+    {
+      if(std::filesystem::exists(pending_path))
+        std::filesystem::remove_all(pending_path);
+      std::filesystem::rename(info.current_path, pending_path);
+      info.current_path = pending_path;
+      Log::info("Mod '" + info.name + "' will be installed after all pending imports");
+      pending_installs_.push_back(info);
+      importMod();
+      return;
+    }
+    catch(std::filesystem::filesystem_error& error)
+    {
+      Log::error(std::format("Failed to move '{}' to '{}'. Installing mod immediately.",
+                             info.current_path.string(),
+                             pending_path.string()));
+    }
+  }
+  pending_installs_.push_back(info);
+  installPendingMods();
 }
 
 void MainWindow::onDeployerBoxChange(int mod_id, bool status)
@@ -2034,6 +2083,7 @@ void MainWindow::onAddModAborted(QString temp_dir)
     ui->mod_list->setAcceptDrops(true);
     ui->deployer_list->setAcceptDrops(true);
     setBusyStatus(false);
+    installPendingMods();
   }
   else
     importMod();
@@ -2062,6 +2112,8 @@ void MainWindow::onExtractionComplete(ImportModInfo info)
   {
     if(!mod_import_queue_.empty())
       importMod();
+    else
+      installPendingMods();
     setStatusMessage("Import failed", 3000);
     Log::error("Failed to import mod \"" + info.local_source.string() + "\"");
     return;
@@ -2092,8 +2144,12 @@ void MainWindow::onExtractionComplete(ImportModInfo info)
     add_mod_dialog_->show();
   }
   else
+  {
     onReceiveError("Error",
                    ("Failed to import mod from \"" + info.local_source.string() + "\"").c_str());
+    if(mod_import_queue_.empty())
+      installPendingMods();
+  }
 }
 
 void MainWindow::onSettingsDialogComplete()
@@ -2482,7 +2538,8 @@ void MainWindow::on_edit_app_button_clicked()
                                ui->info_command_label->text(),
                                ui->app_selection_box->currentData(Qt::UserRole).toString(),
                                currentApp(),
-                               app_info_.steam_app_id);
+                               app_info_.steam_app_id,
+                               app_info_.uses_content_store);
   setBusyStatus(true, false);
   add_app_dialog_->show();
 }
@@ -3268,6 +3325,8 @@ void MainWindow::onDownloadFailed()
   mod_import_queue_.pop();
   if(!mod_import_queue_.empty())
     importMod();
+  else
+    installPendingMods();
 }
 
 void MainWindow::on_actionReinstall_From_Local_triggered()
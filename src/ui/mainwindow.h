@@ -227,6 +227,11 @@ private:
   int last_mod_list_index_ = -1;
   /*! \brief Contains all queued mods to be downloaded or extracted. */
   std::priority_queue<ImportModInfo> mod_import_queue_;
+  /*!
+   * \brief Mods accepted in the add mod dialog while more imports were queued. These are
+   * installed together once the queue is empty.
+   */
+  std::vector<ImportModInfo> pending_installs_;
   /*! \brief Last position of the scroll bar for ui->deployer_list */
   int deployer_list_slider_pos_ = 0;
   /*! \brief Last position of the scroll bar for ui->mod_list */
@@ -375,6 +380,11 @@ private:
    * \brief Extracts or downloads the next mod in mod_import_targets_.
    */
   void importMod();
+  /*!
+   * \brief Installs all mods in pending_installs_. Uses a single batch installation if more
+   * than one mod is pending.
+   */
+  void installPendingMods();
   /*!
    * \brief Sets the visibility status of the progress bar and disabled various UI elements while
    * the \ref ApplicationManager is busy.
@@ -1145,6 +1155,13 @@ signals:
    * \param info Contains all data needed to install the mod.
    */
   void installMod(int app_id, ImportModInfo info);
+  /*!
+   * \brief Installs multiple mods for one \ref ModdedApplication "application". Mods are
+   * extracted concurrently.
+   * \param app_id The target \ref ModdedApplication "application".
+   * \param infos Contains all data needed to install each mod.
+   */
+  void installMods(int app_id, std::vector<ImportModInfo> infos);
   /*!
    * \brief Uninstalls the given mods for one \ref ModdedApplication "application", this includes
    * deleting all installed files.
@@ -0,0 +1,83 @@
+#include "../src/core/archiveindex.h"
+#include "test_utils.h"
+#include <algorithm>
+#include <archive_entry.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace str = std::ranges;
+
+
+TEST_CASE("Archive indices list all entries", "[archiveindex]")
+{
+  resetStagingDir();
+  const sfs::path archive_path = DATA_DIR / "staging" / "mod.tar.gz";
+  const sfs::path cache_dir = DATA_DIR / "staging" / "index";
+  sfs::copy_file(DATA_DIR / "source" / "mod0.tar.gz", archive_path);
+
+  const auto index = ArchiveIndex::get(archive_path, cache_dir);
+  REQUIRE(index->entries().size() == 12);
+  REQUIRE(str::count_if(index->entries(),
+                        [](const auto& entry) { return entry.type == AE_IFDIR; }) == 3);
+  REQUIRE(index->entries()[2].path == "a/b/1.txt");
+  REQUIRE(index->entries()[2].size == 2);
+  REQUIRE(ArchiveIndex::get(archive_path, cache_dir) == index);
+  REQUIRE(str::distance(sfs::directory_iterator(cache_dir), sfs::directory_iterator()) == 1);
+
+  sfs::copy_file(
+    DATA_DIR / "source" / "mod2.tar.gz", archive_path, sfs::copy_options::overwrite_existing);
+  const auto new_index = ArchiveIndex::get(archive_path, cache_dir);
+  REQUIRE(new_index != index);
+  REQUIRE(str::none_of(new_index->entries(),
+                       [](const auto& entry) { return entry.path == "a-Fil _3"; }));
+}
+
+TEST_CASE("Archive indices are evicted from memory", "[archiveindex]")
+{
+  resetStagingDir();
+  const sfs::path cache_dir = DATA_DIR / "staging" / "index";
+  std::vector<sfs::path> archive_paths;
+  for(int i = 0; i < 65; i++)
+  {
+    archive_paths.push_back(DATA_DIR / "staging" / (std::to_string(i) + ".tar.gz"));
+    sfs::copy_file(DATA_DIR / "source" / "mod0.tar.gz", archive_paths.back());
+  }
+
+  REQUIRE_FALSE(ArchiveIndex::getCached(archive_paths[0]));
+  ArchiveIndex::get(archive_paths[0], cache_dir);
+  REQUIRE(ArchiveIndex::getCached(archive_paths[0]));
+  for(int i = 1; i < archive_paths.size(); i++)
+    ArchiveIndex::get(archive_paths[i]);
+  REQUIRE_FALSE(ArchiveIndex::getCached(archive_paths[0]));
+  REQUIRE(ArchiveIndex::getCached(archive_paths.back()));
+  // evicted indices can still be read from disk
+  REQUIRE(ArchiveIndex::getCached(archive_paths[0], cache_dir));
+  REQUIRE(str::distance(sfs::directory_iterator(cache_dir), sfs::directory_iterator()) == 1);
+}
+
+TEST_CASE("Index files of removed archives are pruned", "[archiveindex]")
+{
+  resetStagingDir();
+  const sfs::path cache_dir = DATA_DIR / "staging" / "index";
+  std::vector<sfs::path> archive_paths;
+  for(int i = 0; i < 3; i++)
+  {
+    archive_paths.push_back(DATA_DIR / "staging" / (std::to_string(i) + ".tar.gz"));
+    sfs::copy_file(DATA_DIR / "source" / "mod0.tar.gz", archive_paths.back());
+  }
+  auto count_index_files = [&cache_dir]()
+  { return str::distance(sfs::directory_iterator(cache_dir), sfs::directory_iterator()); };
+
+  ArchiveIndex::get(archive_paths[0], cache_dir);
+  ArchiveIndex::get(archive_paths[1], cache_dir);
+  REQUIRE(count_index_files() == 2);
+  REQUIRE(ArchiveIndex::pruneCache(cache_dir) == 0);
+  sfs::remove(archive_paths[0]);
+  ArchiveIndex::get(archive_paths[2], cache_dir);
+  REQUIRE(count_index_files() == 2);
+  REQUIRE(ArchiveIndex::getCached(archive_paths[1], cache_dir));
+
+  sfs::remove(archive_paths[1]);
+  sfs::remove(archive_paths[2]);
+  REQUIRE(ArchiveIndex::pruneCache(cache_dir) == 2);
+  REQUIRE(count_index_files() == 0);
+}
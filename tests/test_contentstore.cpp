@@ -0,0 +1,56 @@
+#include "../src/core/contentstore.h"
+#include "test_utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+
+void writeStoreTestFile(const sfs::path& path, const std::string& content)
+{
+  sfs::create_directories(path.parent_path());
+  std::ofstream file(path, std::ios::binary);
+  file << content;
+}
+
+TEST_CASE("Identical files are stored once", "[store]")
+{
+  resetStagingDir();
+  const sfs::path dir = DATA_DIR / "staging" / "store";
+  writeStoreTestFile(dir / "0" / "a.txt", "some content");
+  writeStoreTestFile(dir / "1" / "a.txt", "some content");
+  writeStoreTestFile(dir / "1" / "b.txt", "other content");
+
+  ContentStore store(dir / "store");
+  const std::string hash_0 = store.addFile(dir / "0" / "a.txt");
+  const std::string hash_1 = store.addFile(dir / "1" / "a.txt");
+  const std::string hash_2 = store.addFile(dir / "1" / "b.txt");
+  REQUIRE(hash_0 == hash_1);
+  REQUIRE(hash_0 != hash_2);
+  REQUIRE(store.contains(hash_0));
+  REQUIRE(store.isLinked(dir / "0" / "a.txt", hash_0));
+  REQUIRE(store.isLinked(dir / "1" / "a.txt", hash_0));
+  REQUIRE_FALSE(store.isLinked(dir / "1" / "b.txt", hash_0));
+  verifyFilesAreEqual(dir / "0" / "a.txt", dir / "1" / "a.txt");
+  verifyFilesAreEqual(dir / "0" / "a.txt", store.getStoredFilePath(hash_0));
+
+  REQUIRE(store.linkFile(hash_2, dir / "2" / "b.txt"));
+  verifyFilesAreEqual(dir / "1" / "b.txt", dir / "2" / "b.txt");
+  REQUIRE_FALSE(store.linkFile("0123456789abcdef0123456789abcdef", dir / "2" / "c.txt"));
+}
+
+TEST_CASE("Unused stored files are deleted", "[store]")
+{
+  resetStagingDir();
+  const sfs::path dir = DATA_DIR / "staging" / "store";
+  writeStoreTestFile(dir / "a.txt", "some content");
+  writeStoreTestFile(dir / "b.txt", "other content");
+
+  ContentStore store(dir / "store");
+  const std::string hash_a = store.addFile(dir / "a.txt");
+  const std::string hash_b = store.addFile(dir / "b.txt");
+  REQUIRE(store.collectGarbage({ hash_a, hash_b }) == 0);
+  REQUIRE(store.collectGarbage({ hash_a }) == 1);
+  REQUIRE(store.contains(hash_a));
+  REQUIRE_FALSE(store.contains(hash_b));
+  verifyFilesAreEqual(dir / "a.txt", store.getStoredFilePath(hash_a));
+  REQUIRE(sfs::exists(dir / "b.txt"));
+}
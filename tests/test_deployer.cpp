@@ -4,6 +4,7 @@
 #include "test_utils.h"
 #include <catch2/catch_test_macros.hpp>
 #include <filesystem>
+#include <fstream>
 #include <set>
 #include <ranges>
 
@@ -286,3 +287,37 @@ TEST_CASE("Files are deployed as sym links", "[deployer]")
         REQUIRE(std::filesystem::is_symlink(dir_entry.path()));
   }
 }
+
+TEST_CASE("Deployed files are shared through a registry", "[deployer]")
+{
+  resetAppDir();
+  auto registry = std::make_shared<DeployedFilesRegistry>();
+  const auto manifest_path = DATA_DIR / "app" / ".lmmfiles";
+  Deployer depl = Deployer(DATA_DIR / "source", DATA_DIR / "app", "");
+  depl.setDeployedFilesRegistry(registry);
+  depl.addProfile();
+  depl.addMod(0, true);
+  depl.addMod(1, true);
+  depl.addMod(2, true);
+  depl.deploy();
+  auto deployed_files = registry->get(manifest_path);
+  REQUIRE(deployed_files);
+  REQUIRE_FALSE(deployed_files->empty());
+  REQUIRE(std::ranges::all_of(*deployed_files,
+                              [](const auto& pair)
+                              { return std::filesystem::exists(DATA_DIR / "app" / pair.first); }));
+
+  depl.setModStatus(0, false);
+  depl.setModStatus(2, false);
+  depl.deploy();
+  verifyDirsAreEqual(DATA_DIR / "app", DATA_DIR / "target" / "mod1", true);
+  deployed_files = registry->get(manifest_path);
+  REQUIRE(deployed_files);
+  REQUIRE(std::ranges::all_of(*deployed_files, [](const auto& pair) { return pair.second == 1; }));
+
+  std::ofstream(manifest_path, std::ios::app) << "\n";
+  REQUIRE_FALSE(registry->get(manifest_path));
+
+  depl.cleanup();
+  REQUIRE_FALSE(registry->get(manifest_path));
+}
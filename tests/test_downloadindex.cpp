@@ -0,0 +1,56 @@
+#include "../src/core/downloadindex.h"
+#include "../src/core/hashutils.h"
+#include "test_utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+
+TEST_CASE("Streamed hashes match file hashes", "[downloadindex]")
+{
+  hash_utils::StreamHash md5_hash;
+  md5_hash.update("ab", 2);
+  md5_hash.update("c", 1);
+  REQUIRE(md5_hash.md5() == "900150983cd24fb0d6963f7d28e17f72");
+
+  const sfs::path archive_path = DATA_DIR / "source" / "mod0.tar.gz";
+  std::ifstream file(archive_path, std::ios::binary);
+  hash_utils::StreamHash file_hash;
+  char buffer[100];
+  while(file)
+  {
+    file.read(buffer, sizeof(buffer));
+    file_hash.update(buffer, file.gcount());
+  }
+  REQUIRE(file_hash.xxh3() == hash_utils::hashFile(archive_path));
+}
+
+TEST_CASE("Downloaded archives are indexed", "[downloadindex]")
+{
+  resetStagingDir();
+  const sfs::path download_dir = DATA_DIR / "staging";
+  sfs::copy_file(DATA_DIR / "source" / "mod0.tar.gz", download_dir / "mod0.tar.gz");
+  sfs::copy_file(DATA_DIR / "source" / "mod2.tar.gz", download_dir / "mod2.tar.gz");
+  const std::string hash0 = hash_utils::hashFile(download_dir / "mod0.tar.gz");
+  const std::string hash2 = hash_utils::hashFile(download_dir / "mod2.tar.gz");
+
+  DownloadIndex index(download_dir);
+  REQUIRE_FALSE(index.findHash(hash0));
+  index.addArchive(download_dir / "mod0.tar.gz", hash0, "md5_0", 10, 100);
+  index.addArchive(download_dir / "mod2.tar.gz", hash2, "md5_2", 10, 102);
+  index.addArchive(download_dir / "mod0.tar.gz", hash0, "md5_0", 11, 110);
+  REQUIRE(index.findRemoteFile(10, 100) == download_dir / "mod0.tar.gz");
+  REQUIRE(index.findRemoteFile(11, 110) == download_dir / "mod0.tar.gz");
+  REQUIRE(index.findHash(hash2) == download_dir / "mod2.tar.gz");
+  REQUIRE_FALSE(index.findRemoteFile(10, 101));
+  REQUIRE_FALSE(index.findRemoteFile(-1, -1));
+
+  DownloadIndex loaded_index(download_dir);
+  REQUIRE(loaded_index.findRemoteFile(10, 102) == download_dir / "mod2.tar.gz");
+  REQUIRE(loaded_index.findHash(hash0) == download_dir / "mod0.tar.gz");
+
+  sfs::remove(download_dir / "mod0.tar.gz");
+  REQUIRE_FALSE(loaded_index.findRemoteFile(10, 100));
+  REQUIRE_FALSE(loaded_index.findHash(hash0));
+  std::ofstream(download_dir / "mod2.tar.gz", std::ios::binary | std::ios::app) << "a";
+  REQUIRE_FALSE(DownloadIndex(download_dir).findHash(hash2));
+}
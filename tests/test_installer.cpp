@@ -1,8 +1,12 @@
+#include "../src/core/archiveindex.h"
+#include "../src/core/growingfilereader.h"
 #include "../src/core/installer.h"
 #include "test_utils.h"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_vector.hpp>
+#include <fstream>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 
@@ -13,6 +17,54 @@ TEST_CASE("Files are extracted", "[installer]")
   verifyDirsAreEqual(DATA_DIR / "source" / "0", DATA_DIR / "staging" / "extract");
 }
 
+TEST_CASE("Zip archives are extracted", "[installer]")
+{
+  resetStagingDir();
+  Installer::extract(DATA_DIR / "source" / "mod1.zip", DATA_DIR / "staging" / "extract");
+  verifyDirsAreEqual(DATA_DIR / "source" / "1", DATA_DIR / "staging" / "extract");
+}
+
+TEST_CASE("Archives are extracted while being written", "[installer]")
+{
+  resetStagingDir();
+  for(const auto& [archive, source_dir] : { std::pair{ "mod0.tar.gz", "0" },
+                                            std::pair{ "mod1.zip", "1" } })
+  {
+    const sfs::path archive_path = DATA_DIR / "staging" / archive;
+    const sfs::path dest_path = DATA_DIR / "staging" / ("stream_" + std::string(source_dir));
+    REQUIRE(Installer::isStreamable(archive_path));
+    GrowingFileReader reader(archive_path);
+    std::jthread writer(
+      [&reader, &archive_path, archive]()
+      {
+        std::ifstream source(DATA_DIR / "source" / archive, std::ios::binary);
+        std::ofstream dest(archive_path, std::ios::binary);
+        char buffer[64];
+        uint64_t written = 0;
+        while(source.read(buffer, sizeof(buffer)) || source.gcount() > 0)
+        {
+          dest.write(buffer, source.gcount());
+          dest.flush();
+          written += source.gcount();
+          reader.setAvailable(written);
+        }
+        reader.finish(true);
+      });
+    Installer::extractStream([&reader](char* buffer, size_t size)
+                             { return reader.read(buffer, size); },
+                             dest_path);
+    verifyDirsAreEqual(DATA_DIR / "source" / source_dir, dest_path);
+  }
+
+  GrowingFileReader reader(DATA_DIR / "source" / "mod0.tar.gz");
+  reader.setAvailable(10);
+  reader.finish(false);
+  REQUIRE_THROWS(Installer::extractStream([&reader](char* buffer, size_t size)
+                                          { return reader.read(buffer, size); },
+                                          DATA_DIR / "staging" / "failed"));
+  REQUIRE_FALSE(Installer::isStreamable("mod.7z"));
+}
+
 TEST_CASE("Mods are (un)installed", "[installer]")
 {
   resetStagingDir();
@@ -62,6 +114,27 @@ TEST_CASE("Installer options", "[installer]")
   }
 }
 
+TEST_CASE("Options are applied during extraction", "[installer]")
+{
+  resetStagingDir();
+  const auto size = Installer::install(DATA_DIR / "source" / "mod0.tar.gz",
+                                       DATA_DIR / "staging" / "lower_single",
+                                       Installer::lower_case | Installer::single_directory,
+                                       Installer::SIMPLEINSTALLER,
+                                       0);
+  for(const auto& dir_entry : sfs::directory_iterator(DATA_DIR / "staging"))
+    REQUIRE(dir_entry.path().filename() == "lower_single");
+  unsigned long actual_size = 0;
+  for(const auto& dir_entry : sfs::directory_iterator(DATA_DIR / "staging" / "lower_single"))
+  {
+    REQUIRE(dir_entry.is_regular_file());
+    const std::string name = dir_entry.path().filename().string();
+    REQUIRE(std::ranges::none_of(name, [](unsigned char c) { return std::isupper(c); }));
+    actual_size += dir_entry.file_size();
+  }
+  REQUIRE(size == actual_size);
+}
+
 TEST_CASE("Root levels", "[installer]")
 {
   resetStagingDir();
@@ -102,3 +175,98 @@ TEST_CASE("Root levels", "[installer]")
     verifyDirsAreEqual(DATA_DIR / "target" / "root_level" / "3", DATA_DIR / "staging" / "3");
   }
 }
+
+TEST_CASE("Fomod files are extracted selectively", "[installer]")
+{
+  resetStagingDir();
+  const std::vector<std::pair<sfs::path, sfs::path>> fomod_files{ { "b", "x" },
+                                                                  { "0.txt", "y/z.txt" },
+                                                                  { "a/b/1.txt", "" },
+                                                                  { "a/0.txt", "x/3" },
+                                                                  { "a/0.txt", "a.txt" } };
+  const auto size = Installer::install(DATA_DIR / "source" / "mod0.tar.gz",
+                                       DATA_DIR / "staging" / "archive",
+                                       Installer::preserve_case,
+                                       Installer::FOMODINSTALLER,
+                                       0,
+                                       fomod_files);
+  // directories are extracted completely before the selected files are moved
+  const auto expected_size = Installer::install(DATA_DIR / "source" / "0",
+                                                DATA_DIR / "staging" / "dir",
+                                                Installer::preserve_case,
+                                                Installer::FOMODINSTALLER,
+                                                0,
+                                                fomod_files);
+  verifyDirsAreEqual(DATA_DIR / "staging" / "dir", DATA_DIR / "staging" / "archive");
+  REQUIRE(size == expected_size);
+  REQUIRE_FALSE(sfs::exists(DATA_DIR / "staging" / "archive" / "a"));
+  REQUIRE_THROWS(Installer::install(DATA_DIR / "source" / "mod0.tar.gz",
+                                    DATA_DIR / "staging" / "missing",
+                                    Installer::preserve_case,
+                                    Installer::FOMODINSTALLER,
+                                    0,
+                                    { { "c", "" } }));
+  REQUIRE_FALSE(sfs::exists(DATA_DIR / "staging" / "missing"));
+}
+
+TEST_CASE("Fomod previews contain only installer files", "[installer]")
+{
+  resetStagingDir();
+  const sfs::path preview_dir = DATA_DIR / "staging" / "preview";
+  REQUIRE_FALSE(Installer::extractFomodPreview(DATA_DIR / "source" / "mod0.tar.gz", preview_dir));
+  REQUIRE_FALSE(sfs::exists(preview_dir));
+
+  // compressed tar archives are only listed if a cached index exists
+  const sfs::path archive_path = DATA_DIR / "staging" / "fomod.tar.gz";
+  sfs::copy_file(DATA_DIR / "source" / "fomod.tar.gz", archive_path);
+  REQUIRE_FALSE(Installer::extractFomodPreview(archive_path, preview_dir));
+  REQUIRE_FALSE(sfs::exists(preview_dir));
+  ArchiveIndex::get(archive_path);
+  REQUIRE(Installer::extractFomodPreview(archive_path, preview_dir));
+  const auto [root_level, prefix, type] = Installer::detectInstallerSignature(preview_dir);
+  REQUIRE(type == Installer::FOMODINSTALLER);
+  REQUIRE(root_level == 1);
+  REQUIRE(sfs::file_size(preview_dir / "Mod" / "fomod" / "ModuleConfig.xml") > 0);
+  REQUIRE(sfs::file_size(preview_dir / "Mod" / "fomod" / "info.xml") > 0);
+  REQUIRE(sfs::file_size(preview_dir / "Mod" / "images" / "preview.png") > 0);
+  REQUIRE(sfs::file_size(preview_dir / "Mod" / "option_a" / "plugin.esp") == 0);
+  REQUIRE(sfs::file_size(preview_dir / "Mod" / "option_b" / "plugin.esp") == 0);
+
+  Installer::install(DATA_DIR / "source" / "fomod.tar.gz",
+                     DATA_DIR / "staging" / "mod",
+                     Installer::preserve_case,
+                     Installer::FOMODINSTALLER,
+                     root_level,
+                     { { "option_b", "" } });
+  REQUIRE(sfs::file_size(DATA_DIR / "staging" / "mod" / "plugin.esp") > 0);
+}
+
+TEST_CASE("Mod updates only replace changed files", "[installer]")
+{
+  resetStagingDir();
+  const sfs::path mod_dir = DATA_DIR / "staging" / "mod";
+  const sfs::path update_dir = DATA_DIR / "staging" / "update";
+  sfs::copy(DATA_DIR / "source" / "0", mod_dir, sfs::copy_options::recursive);
+  sfs::copy(DATA_DIR / "source" / "0", update_dir, sfs::copy_options::recursive);
+  sfs::create_hard_link(mod_dir / "0.txt", DATA_DIR / "staging" / "unchanged_link");
+  sfs::create_hard_link(mod_dir / "1.txt", DATA_DIR / "staging" / "changed_link");
+  std::ofstream(update_dir / "1.txt", std::ios::binary) << "2\n";
+  std::ofstream(update_dir / "a" / "new.txt", std::ios::binary) << "new\n";
+  sfs::remove_all(update_dir / "a" / "b");
+  const sfs::path expected_dir = DATA_DIR / "staging" / "expected";
+  sfs::copy(update_dir, expected_dir, sfs::copy_options::recursive);
+
+  const auto [changed_files, file_list_changed] = Installer::applyModUpdate(update_dir, mod_dir);
+  REQUIRE(changed_files ==
+          std::set<sfs::path>{ "1.txt", "a/new.txt", "a/b/1.txt", "a/b/2.txt" });
+  REQUIRE(file_list_changed);
+  REQUIRE_FALSE(sfs::exists(update_dir));
+  verifyDirsAreEqual(mod_dir, expected_dir);
+  REQUIRE(sfs::equivalent(mod_dir / "0.txt", DATA_DIR / "staging" / "unchanged_link"));
+  REQUIRE_FALSE(sfs::equivalent(mod_dir / "1.txt", DATA_DIR / "staging" / "changed_link"));
+
+  sfs::copy(expected_dir, update_dir, sfs::copy_options::recursive);
+  const auto [no_changes, no_list_change] = Installer::applyModUpdate(update_dir, mod_dir);
+  REQUIRE(no_changes.empty());
+  REQUIRE_FALSE(no_list_change);
+}
@@ -110,3 +110,32 @@ TEST_CASE("Profiles are managed", "[loot]")
   verifyDirsAreEqual(
     DATA_DIR / "target" / "loot" / "target", DATA_DIR / "target" / "loot" / "profiles", true);
 }
+
+TEST_CASE("Plugin types are detected", "[loot]")
+{
+  resetStagingDir();
+  const sfs::path source_dir = DATA_DIR / "staging" / "loot" / "source";
+  const sfs::path target_dir = DATA_DIR / "staging" / "loot" / "target";
+  sfs::create_directories(target_dir);
+  std::string data;
+  appendSubrecord(data, "HEDR", std::string(12, '\0'));
+  writePlugin(source_dir / "Starfield.esm", "TES4", TesPluginHeader::MASTER_FLAG, data, 24);
+  // games with light plugins treat .esl and .esm files as masters regardless of their flags
+  writePlugin(source_dir / "unflagged.esl", "TES4", 0, data, 24);
+  writePlugin(source_dir / "unflagged.esm", "TES4", 0, data, 24);
+  writePlugin(source_dir / "light.esp", "TES4", 0x100, data, 24);
+  writePlugin(source_dir / "standard.esp", "TES4", 0, data, 24);
+
+  LootDeployer depl(source_dir, target_dir, "", true);
+  const auto names = depl.getModNames();
+  const auto tags = depl.getAutoTags();
+  REQUIRE(names.size() == tags.size());
+  std::map<std::string, std::vector<std::string>> tag_map;
+  for(int i = 0; i < names.size(); i++)
+    tag_map[names[i]] = tags[i];
+  REQUIRE(tag_map["Starfield.esm"] == std::vector<std::string>{ "Master" });
+  REQUIRE(tag_map["unflagged.esl"] == std::vector<std::string>{ "Light" });
+  REQUIRE(tag_map["unflagged.esm"] == std::vector<std::string>{ "Master" });
+  REQUIRE(tag_map["light.esp"] == std::vector<std::string>{ "Light" });
+  REQUIRE(tag_map["standard.esp"] == std::vector<std::string>{ "Standard" });
+}
@@ -0,0 +1,47 @@
+#include "../src/core/lspakextractor.h"
+#include "../src/core/lspakwriter.h"
+#include "test_utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+
+TEST_CASE("Pak archives are extracted", "[lspak]")
+{
+  resetStagingDir();
+  const sfs::path target_dir = DATA_DIR / "staging" / "pak";
+  LsPakExtractor extractor(DATA_DIR / "source" / "bg3" / "source" / "mod1.pak");
+  extractor.init();
+  extractor.extractAll(target_dir);
+  const auto file_list = extractor.getFileList();
+  REQUIRE_FALSE(file_list.empty());
+  for(int i = 0; i < file_list.size(); i++)
+  {
+    std::ifstream file(target_dir / file_list[i], std::ios::binary);
+    REQUIRE(file.is_open());
+    const std::string content((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    REQUIRE(content == extractor.extractFile(i));
+  }
+}
+
+TEST_CASE("Pak archives are packed", "[lspak]")
+{
+  resetStagingDir();
+  const sfs::path source_dir = DATA_DIR / "source" / "1";
+  for(int compression_type : { LsPakExtractor::COMPRESSION_NONE,
+                                LsPakExtractor::COMPRESSION_ZLIB,
+                                LsPakExtractor::COMPRESSION_LZ4,
+                                LsPakExtractor::COMPRESSION_ZSTD })
+  {
+    const sfs::path archive_path = DATA_DIR / "staging" / "packed.pak";
+    const sfs::path target_dir = DATA_DIR / "staging" / std::to_string(compression_type);
+    LsPakWriter writer(archive_path, compression_type);
+    writer.addDirectory(source_dir);
+    writer.write();
+
+    LsPakExtractor extractor(archive_path);
+    extractor.init();
+    extractor.extractAll(target_dir);
+    verifyDirsAreEqual(source_dir, target_dir, true);
+  }
+}
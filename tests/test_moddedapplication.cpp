@@ -1,10 +1,15 @@
 #include "../src/core/deployerfactory.h"
+#include "../src/core/hashutils.h"
 #include "../src/core/installer.h"
 #include "../src/core/moddedapplication.h"
 #include "matcher.h"
 #include "test_utils.h"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_vector.hpp>
+#include <algorithm>
+#include <fstream>
+
+namespace str = std::ranges;
 
 ImportModInfo createImportModInfo(const std::string& name,
                                              const std::string& version,
@@ -93,6 +98,175 @@ TEST_CASE("Deployers are added", "[app]")
   verifyDirsAreEqual(DATA_DIR / "app", DATA_DIR / "target" / "mod012", true);
 }
 
+TEST_CASE("Mods are installed in batches", "[app]")
+{
+  resetStagingDir();
+  resetAppDir();
+  ModdedApplication app(DATA_DIR / "staging", "test");
+  app.addDeployer({ DeployerFactory::SIMPLEDEPLOYER, "depl0", DATA_DIR / "app", Deployer::hard_link });
+  std::vector<ImportModInfo> infos;
+  for(const auto& [name, archive] : { std::pair{ "mod 0", "mod0.tar.gz" },
+                                      std::pair{ "mod 1", "mod1.zip" },
+                                      std::pair{ "mod 2", "mod2.tar.gz" } })
+    infos.push_back(createImportModInfo(name,
+                                        "1.0",
+                                        DATA_DIR / "source" / archive,
+                                        Installer::SIMPLEINSTALLER,
+                                        INSTALLER_FLAGS,
+                                        { 0 },
+                                        0,
+                                        -1,
+                                        false));
+  app.installMods(infos);
+  verifyDirsAreEqual(DATA_DIR / "staging" / "0", DATA_DIR / "source" / "0");
+  verifyDirsAreEqual(DATA_DIR / "staging" / "1", DATA_DIR / "source" / "1");
+  verifyDirsAreEqual(DATA_DIR / "staging" / "2", DATA_DIR / "source" / "2");
+  auto mod_info = app.getModInfo();
+  REQUIRE(mod_info.size() == 3);
+  REQUIRE(mod_info[1].mod.name == "mod 1");
+  app.deployMods();
+  verifyDirsAreEqual(DATA_DIR / "app", DATA_DIR / "target" / "mod012", true);
+
+  infos[0].name = "missing";
+  infos[0].current_path = DATA_DIR / "source" / "missing.tar.gz";
+  infos[0].deployers = {};
+  infos[1].name = "mod 3";
+  infos[1].deployers = {};
+  REQUIRE_THROWS(app.installMods({ infos[0], infos[1] }));
+  mod_info = app.getModInfo();
+  REQUIRE(mod_info.size() == 4);
+  REQUIRE(mod_info[3].mod.name == "mod 3");
+  REQUIRE(mod_info[3].mod.id == 4);
+  REQUIRE_FALSE(sfs::exists(DATA_DIR / "staging" / "3"));
+
+  infos[0] = infos[1];
+  infos[0].name = "invalid replacement";
+  infos[0].replace_mod = true;
+  infos[0].target_group_id = 100;
+  infos[1].name = "mod 4";
+  REQUIRE_THROWS(app.installMods({ infos[0], infos[1] }));
+  mod_info = ModdedApplication(DATA_DIR / "staging", "test").getModInfo();
+  REQUIRE(mod_info.size() == 5);
+  REQUIRE(mod_info[4].mod.name == "mod 4");
+}
+
+TEST_CASE("Identical mod files are stored once", "[app]")
+{
+  resetStagingDir();
+  resetAppDir();
+  ModdedApplication app(DATA_DIR / "staging", "test");
+  app.addDeployer({ DeployerFactory::SIMPLEDEPLOYER, "depl0", DATA_DIR / "app", Deployer::hard_link });
+  auto info = createImportModInfo("mod 0",
+                                  "1.0",
+                                  DATA_DIR / "source" / "mod0.tar.gz",
+                                  Installer::SIMPLEINSTALLER,
+                                  INSTALLER_FLAGS,
+                                  { 0 },
+                                  0,
+                                  -1,
+                                  false);
+  app.installMod(info);
+  const sfs::path store_dir = DATA_DIR / "staging" / ".mod_store" / "files";
+  if(!ContentStore(store_dir).supportsReflinks())
+  {
+    REQUIRE_THROWS(app.setUseContentStore(true));
+    REQUIRE_FALSE(app.usesContentStore());
+    return;
+  }
+  app.setUseContentStore(true);
+  info.name = "mod 0 copy";
+  app.installMod(info);
+  verifyDirsAreEqual(DATA_DIR / "staging" / "0", DATA_DIR / "source" / "0");
+  verifyDirsAreEqual(DATA_DIR / "staging" / "1", DATA_DIR / "source" / "0");
+
+  std::set<std::string> unique_hashes;
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(DATA_DIR / "source" / "0"))
+  {
+    if(dir_entry.is_regular_file())
+      unique_hashes.insert(hash_utils::hashFile(dir_entry.path()));
+  }
+  auto count_stored_files = [&store_dir]()
+  {
+    return str::count_if(sfs::recursive_directory_iterator(store_dir),
+                         [](const auto& dir_entry) { return dir_entry.is_regular_file(); });
+  };
+  REQUIRE(count_stored_files() == unique_hashes.size());
+
+  auto conflicts = app.getFileConflicts(0, 1, false);
+  REQUIRE_FALSE(conflicts.empty());
+  REQUIRE(str::all_of(conflicts, [](const auto& conflict) { return conflict.is_identical; }));
+  REQUIRE(ModdedApplication(DATA_DIR / "staging", "test").usesContentStore());
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(store_dir))
+  {
+    if(dir_entry.is_regular_file())
+      REQUIRE((dir_entry.status().permissions() & sfs::perms::owner_write) == sfs::perms::none);
+  }
+
+  // an in place edit keeps size and modification time, but must not be treated as identical
+  const std::string edited_file = conflicts[0].file;
+  const sfs::path edited_path = DATA_DIR / "staging" / "1" / edited_file;
+  const auto write_time = sfs::last_write_time(edited_path);
+  std::string content;
+  {
+    std::ifstream file(edited_path, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  REQUIRE_FALSE(content.empty());
+  content[0] = ~content[0];
+  std::ofstream(edited_path, std::ios::binary | std::ios::trunc) << content;
+  sfs::last_write_time(edited_path, write_time);
+  conflicts = app.getFileConflicts(0, 1, false);
+  const auto edited_conflict = str::find_if(
+    conflicts, [&edited_file](const auto& conflict) { return conflict.file == edited_file; });
+  REQUIRE(edited_conflict != conflicts.end());
+  REQUIRE_FALSE(edited_conflict->is_identical);
+  verifyDirsAreEqual(DATA_DIR / "staging" / "0", DATA_DIR / "source" / "0", true);
+
+  app.uninstallMods({ 0 });
+  REQUIRE(count_stored_files() == unique_hashes.size());
+  app.uninstallMods({ 1 });
+  REQUIRE(count_stored_files() == 0);
+}
+
+TEST_CASE("Hard link deployments remain valid when sharing files", "[app]")
+{
+  resetStagingDir();
+  resetAppDir();
+  ModdedApplication app(DATA_DIR / "staging", "test");
+  app.addDeployer({ DeployerFactory::SIMPLEDEPLOYER, "depl0", DATA_DIR / "app", Deployer::hard_link });
+  auto info = createImportModInfo("mod 0",
+                                  "1.0",
+                                  DATA_DIR / "source" / "mod0.tar.gz",
+                                  Installer::SIMPLEINSTALLER,
+                                  INSTALLER_FLAGS,
+                                  { 0 },
+                                  0,
+                                  -1,
+                                  false);
+  app.installMod(info);
+  info.name = "mod 0 copy";
+  app.installMod(info);
+  app.deployMods();
+  if(!ContentStore(DATA_DIR / "staging" / ".mod_store" / "files").supportsReflinks())
+  {
+    REQUIRE_THROWS(app.setUseContentStore(true));
+    return;
+  }
+  app.setUseContentStore(true);
+
+  for(const auto& dir_entry : sfs::recursive_directory_iterator(DATA_DIR / "source" / "0"))
+  {
+    if(!dir_entry.is_regular_file())
+      continue;
+    const sfs::path path = dir_entry.path().lexically_relative(DATA_DIR / "source" / "0");
+    CAPTURE(path.string());
+    const sfs::path deployed_path = DATA_DIR / "app" / path;
+    REQUIRE(sfs::exists(deployed_path));
+    REQUIRE((sfs::equivalent(deployed_path, DATA_DIR / "staging" / "0" / path) ||
+             sfs::equivalent(deployed_path, DATA_DIR / "staging" / "1" / path)));
+  }
+}
+
 TEST_CASE("State is saved", "[app]")
 {
   resetStagingDir();
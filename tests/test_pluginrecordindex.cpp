@@ -0,0 +1,69 @@
+#include "../src/core/pluginrecordindex.h"
+#include "test_utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_vector.hpp>
+
+
+std::string makeRecord(uint32_t form_id)
+{
+  const std::string data = "EDID";
+  const uint32_t size = data.size();
+  const uint32_t flags = 0;
+  std::string record = "WEAP";
+  record.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  record.append(reinterpret_cast<const char*>(&flags), sizeof(flags));
+  record.append(reinterpret_cast<const char*>(&form_id), sizeof(form_id));
+  record += std::string(8, '\0');
+  return record + data;
+}
+
+void writeRecordPlugin(const sfs::path& path,
+                       const std::vector<std::string>& masters,
+                       const std::vector<uint32_t>& form_ids)
+{
+  std::string data;
+  appendSubrecord(data, "HEDR", std::string(12, '\0'));
+  for(const auto& master : masters)
+  {
+    appendSubrecord(data, "MAST", master + '\0');
+    appendSubrecord(data, "DATA", std::string(8, '\0'));
+  }
+  std::string records;
+  for(uint32_t form_id : form_ids)
+    records += makeRecord(form_id);
+  writePlugin(path, "TES4", 0, data, 24, records);
+}
+
+TEST_CASE("Plugin records are indexed", "[plugin_records]")
+{
+  resetStagingDir();
+  const sfs::path dir = DATA_DIR / "staging" / "plugins";
+  const sfs::path cache_dir = DATA_DIR / "staging" / "records";
+  const std::vector<std::string> plugins = { "a.esm", "b.esp", "c.esp", "d.esp" };
+  writeRecordPlugin(dir / "a.esm", {}, { 0x800, 0x801 });
+  writeRecordPlugin(dir / "b.esp", { "a.esm" }, { 0x800, 0x01000900 });
+  writeRecordPlugin(dir / "c.esp", { "A.esm", "b.esp" }, { 0x01000900, 0x02000001 });
+  writeRecordPlugin(dir / "d.esp", {}, { 0x900 });
+
+  PluginRecordIndex index(cache_dir, TesPluginHeader::Format::tes5);
+  REQUIRE(index.update(dir, plugins).empty());
+  REQUIRE(index.pluginsOverlap(0, 1));
+  REQUIRE(index.pluginsOverlap(2, 1));
+  REQUIRE_FALSE(index.pluginsOverlap(0, 2));
+  REQUIRE_FALSE(index.pluginsOverlap(3, 1));
+  REQUIRE_THAT(index.getOverlappingPlugins(1), Catch::Matchers::Equals(std::vector<int>{ 0, 2 }));
+  REQUIRE_THAT(index.getPluginsWithRecord(1, 0x800),
+               Catch::Matchers::Equals(std::vector<int>{ 0, 1 }));
+  REQUIRE_THAT(index.getPluginsWithRecord(2, 0x01000900),
+               Catch::Matchers::Equals(std::vector<int>{ 1, 2 }));
+  REQUIRE(index.getPluginsWithRecord(0, 0x801).empty());
+  REQUIRE(index.getOverlappingPluginPairs() == std::vector<std::pair<int, int>>{ { 0, 1 }, { 1, 2 } });
+
+  writeRecordPlugin(dir / "d.esp", { "a.esm" }, { 0x801 });
+  PluginRecordIndex cached_index(cache_dir, TesPluginHeader::Format::tes5);
+  REQUIRE(cached_index.update(dir, plugins).empty());
+  REQUIRE(cached_index.getOverlappingPluginPairs() ==
+          std::vector<std::pair<int, int>>{ { 0, 1 }, { 0, 3 }, { 1, 2 } });
+  REQUIRE_THAT(cached_index.getPluginsWithRecord(3, 0x801),
+               Catch::Matchers::Equals(std::vector<int>{ 0, 3 }));
+}
@@ -1,3 +1,4 @@
+#include "../src/core/contentstore.h"
 #include "../src/core/deployer.h"
 #include "../src/core/reversedeployer.h"
 #include "../src/core/pathutils.h"
@@ -5,6 +6,7 @@
 #include "test_utils.h"
 #include <catch2/catch_test_macros.hpp>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 
 namespace sfs = std::filesystem;
@@ -197,3 +199,212 @@ TEST_CASE("Managed files are deployed", "[revdepl]")
   verifyDirsAreEqual(DATA_DIR / "target" / "revdepl" / "target",
                      DATA_DIR / "target" / "revdepl" / "managed_1", false);
 }
+
+TEST_CASE("Profiles are switched", "[revdepl]")
+{
+  resetDirs();
+  Deployer depl(DATA_DIR / "source" / "revdepl" / "data",
+                DATA_DIR / "target" / "revdepl" / "target",
+                "depl");
+  depl.addProfile();
+  depl.addMod(0);
+  depl.deploy();
+
+  ReverseDeployer rev_depl(DATA_DIR / "source" / "revdepl" / "source",
+                           DATA_DIR / "target" / "revdepl" / "target",
+                           "depl",
+                           Deployer::hard_link,
+                           false,
+                           true);
+  rev_depl.addProfile();
+  sfs::copy(DATA_DIR / "target" / "revdepl" / "extra_files",
+            DATA_DIR / "target" / "revdepl" / "target",
+            sfs::copy_options::skip_existing | sfs::copy_options::recursive);
+  rev_depl.updateManagedFiles(true);
+  rev_depl.addProfile(0);
+  rev_depl.deploy();
+  // managed_1 with all managed files enabled
+  resetStagingDir();
+  const sfs::path all_enabled_dir = DATA_DIR / "staging" / "all_enabled";
+  sfs::copy(DATA_DIR / "target" / "revdepl" / "managed_1",
+            all_enabled_dir,
+            sfs::copy_options::recursive);
+  sfs::copy_file(DATA_DIR / "target" / "revdepl" / "extra_files" / "a" / "1",
+                 all_enabled_dir / "a" / "1");
+  verifyDirsAreEqual(DATA_DIR / "target" / "revdepl" / "target", all_enabled_dir, false);
+
+  const sfs::path unchanged_file = DATA_DIR / "target" / "revdepl" / "target" / "1";
+  const sfs::path source_file = DATA_DIR / "source" / "revdepl" / "source" / "1";
+  REQUIRE(sfs::equivalent(unchanged_file, source_file));
+
+  rev_depl.setProfile(1);
+  const auto mod_names = rev_depl.getModNames();
+  const int id = std::ranges::find(mod_names, "a/1") - mod_names.begin();
+  rev_depl.setModStatus(id, false);
+  rev_depl.deploy();
+  verifyDirsAreEqual(DATA_DIR / "target" / "revdepl" / "target",
+                     DATA_DIR / "target" / "revdepl" / "managed_1", false);
+  REQUIRE(sfs::equivalent(unchanged_file, source_file));
+
+  rev_depl.setProfile(0);
+  rev_depl.deploy();
+  verifyDirsAreEqual(DATA_DIR / "target" / "revdepl" / "target", all_enabled_dir, false);
+  REQUIRE(sfs::equivalent(unchanged_file, source_file));
+}
+
+TEST_CASE("Profiles with separate directories are switched", "[revdepl]")
+{
+  resetDirs();
+  Deployer depl(DATA_DIR / "source" / "revdepl" / "data",
+                DATA_DIR / "target" / "revdepl" / "target",
+                "depl");
+  depl.addProfile();
+  depl.addMod(0);
+  depl.deploy();
+
+  const sfs::path source_dir = DATA_DIR / "source" / "revdepl" / "source";
+  const sfs::path target_dir = DATA_DIR / "target" / "revdepl" / "target";
+  ReverseDeployer rev_depl(source_dir, target_dir, "depl", Deployer::hard_link, true, true);
+  rev_depl.addProfile();
+  sfs::copy(DATA_DIR / "target" / "revdepl" / "extra_files",
+            target_dir,
+            sfs::copy_options::skip_existing | sfs::copy_options::recursive);
+  rev_depl.updateManagedFiles(true);
+  rev_depl.addProfile(0);
+  rev_depl.deploy();
+  REQUIRE(sfs::equivalent(target_dir / "1", source_dir / "0" / "1"));
+  REQUIRE(sfs::equivalent(target_dir / "a" / "1", source_dir / "0" / "a" / "1"));
+
+  // the new profile starts with copies of the files of its source profile
+  rev_depl.setProfile(1);
+  rev_depl.deploy();
+  REQUIRE(sfs::equivalent(target_dir / "1", source_dir / "1" / "1"));
+  REQUIRE(sfs::equivalent(target_dir / "a" / "1", source_dir / "1" / "a" / "1"));
+  verifyFilesAreEqual(target_dir / "1", DATA_DIR / "target" / "revdepl" / "extra_files" / "1");
+  sfs::remove(target_dir / "1");
+  std::ofstream(target_dir / "1") << "profile 1";
+  rev_depl.deploy();
+
+  rev_depl.setProfile(0);
+  rev_depl.deploy();
+  REQUIRE(sfs::equivalent(target_dir / "1", source_dir / "0" / "1"));
+  REQUIRE(sfs::equivalent(target_dir / "a" / "1", source_dir / "0" / "a" / "1"));
+  verifyFilesAreEqual(target_dir / "1", DATA_DIR / "target" / "revdepl" / "extra_files" / "1");
+
+  rev_depl.setProfile(1);
+  rev_depl.deploy();
+  REQUIRE(sfs::equivalent(target_dir / "1", source_dir / "1" / "1"));
+  std::ifstream file(target_dir / "1");
+  REQUIRE(std::string(std::istreambuf_iterator<char>(file), {}) == "profile 1");
+}
+
+TEST_CASE("Profiles share identical files", "[revdepl]")
+{
+  resetDirs();
+  const sfs::path source_dir = DATA_DIR / "source" / "revdepl" / "source";
+  const sfs::path target_dir = DATA_DIR / "target" / "revdepl" / "target";
+  const sfs::path store_dir = source_dir / ".revdepl-store";
+  ReverseDeployer rev_depl(source_dir, target_dir, "depl", Deployer::hard_link, true, true);
+  rev_depl.addProfile();
+  std::ofstream(target_dir / "large") << std::string(2 << 20, 'a');
+  rev_depl.updateManagedFiles(true);
+  rev_depl.deploy();
+  rev_depl.addProfile(0);
+
+  auto getNumStoredFiles = [&store_dir]()
+  {
+    if(!sfs::exists(store_dir))
+      return 0l;
+    return std::ranges::count_if(sfs::recursive_directory_iterator(store_dir),
+                                 [](const auto& entry) { return entry.is_regular_file(); });
+  };
+  const bool reflinks_supported = ContentStore(store_dir).supportsReflinks();
+  REQUIRE(getNumStoredFiles() == (reflinks_supported ? 1 : 0));
+  REQUIRE_FALSE(sfs::equivalent(source_dir / "0" / "large", source_dir / "1" / "large"));
+  verifyFilesAreEqual(source_dir / "0" / "large", source_dir / "1" / "large");
+
+  // editing a deployed file in place must not change the file of the other profile
+  std::fstream(target_dir / "large", std::ios::in | std::ios::out | std::ios::binary) << 'b';
+  rev_depl.deploy();
+  REQUIRE(getNumStoredFiles() == (reflinks_supported ? 2 : 0));
+  rev_depl.setProfile(1);
+  rev_depl.deploy();
+  std::ifstream file(target_dir / "large", std::ios::binary);
+  REQUIRE(file.get() == 'a');
+  file.close();
+  rev_depl.setProfile(0);
+  rev_depl.deploy();
+  file.open(target_dir / "large", std::ios::binary);
+  REQUIRE(file.get() == 'b');
+}
+
+TEST_CASE("Managed file states are persisted", "[revdepl]")
+{
+  resetDirs();
+  ReverseDeployer rev_depl(DATA_DIR / "source" / "revdepl" / "source",
+                           DATA_DIR / "target" / "revdepl" / "target",
+                           "depl",
+                           Deployer::hard_link,
+                           false,
+                           true);
+  rev_depl.addProfile();
+  sfs::copy(DATA_DIR / "target" / "revdepl" / "extra_files",
+            DATA_DIR / "target" / "revdepl" / "target",
+            sfs::copy_options::skip_existing | sfs::copy_options::recursive);
+  rev_depl.updateManagedFiles(true);
+  const auto mod_names = rev_depl.getModNames();
+  const int id = std::ranges::find(mod_names, "a/1") - mod_names.begin();
+  rev_depl.setModStatus(id, false);
+
+  ReverseDeployer rev_depl_2(DATA_DIR / "source" / "revdepl" / "source",
+                             DATA_DIR / "target" / "revdepl" / "target",
+                             "depl",
+                             Deployer::hard_link,
+                             false,
+                             true);
+  REQUIRE_THAT(rev_depl_2.getModNames(), Catch::Matchers::UnorderedEquals(mod_names));
+  REQUIRE_THAT(rev_depl_2.getIgnoredFiles(),
+               Catch::Matchers::UnorderedEquals(rev_depl.getIgnoredFiles()));
+  rev_depl_2.deploy();
+  REQUIRE_FALSE(sfs::exists(DATA_DIR / "target" / "revdepl" / "target" / "a" / "1"));
+  REQUIRE(sfs::exists(DATA_DIR / "target" / "revdepl" / "target" / "c" / "1"));
+}
+
+TEST_CASE("Legacy state files are converted", "[revdepl]")
+{
+  resetDirs();
+  const sfs::path source_dir = DATA_DIR / "source" / "revdepl" / "source";
+  const sfs::path target_dir = DATA_DIR / "target" / "revdepl" / "target";
+  const sfs::path legacy_dir = DATA_DIR / "target" / "revdepl" / "legacy";
+  sfs::copy_file(legacy_dir / ".revdepl-managed_files.json",
+                 source_dir / ".revdepl-managed_files.json");
+  sfs::copy_file(legacy_dir / ".revdepl-ignored_files.json",
+                 target_dir / ".revdepl-ignored_files.json");
+
+  ReverseDeployer rev_depl(source_dir, target_dir, "depl", Deployer::hard_link, false, true);
+  REQUIRE_FALSE(sfs::exists(source_dir / ".revdepl-managed_files.json"));
+  REQUIRE_FALSE(sfs::exists(target_dir / ".revdepl-ignored_files.json"));
+  REQUIRE(sfs::exists(source_dir / ".revdepl-managed_files.bin"));
+  REQUIRE(sfs::exists(target_dir / ".revdepl-ignored_files.bin"));
+
+  const std::vector<std::string> ignored_files = {
+    "c/3", "b/2", "b/1", "a/a/some file.txt", "a/some file.txt", "some file.txt"
+  };
+  REQUIRE_THAT(rev_depl.getIgnoredFiles(), Catch::Matchers::UnorderedEquals(ignored_files));
+  REQUIRE_THAT(rev_depl.getModNames(),
+               Catch::Matchers::UnorderedEquals(std::vector<std::string>{ "1", "a/1" }));
+
+  ReverseDeployer rev_depl_2(source_dir, target_dir, "depl", Deployer::hard_link, false, true);
+  REQUIRE_THAT(rev_depl_2.getIgnoredFiles(), Catch::Matchers::UnorderedEquals(ignored_files));
+  REQUIRE_THAT(rev_depl_2.getModNames(), Catch::Matchers::UnorderedEquals(rev_depl.getModNames()));
+  rev_depl_2.setProfile(1);
+  REQUIRE_THAT(rev_depl_2.getModNames(),
+               Catch::Matchers::UnorderedEquals(std::vector<std::string>{ "c/1" }));
+  rev_depl_2.setProfile(0);
+  sfs::copy(DATA_DIR / "target" / "revdepl" / "extra_files",
+            source_dir,
+            sfs::copy_options::recursive);
+  rev_depl_2.deploy();
+  REQUIRE(sfs::exists(target_dir / "1"));
+  REQUIRE_FALSE(sfs::exists(target_dir / "a" / "1"));
+}
@@ -0,0 +1,205 @@
+#include "../src/core/segmenteddownload.h"
+#include "test_utils.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <netinet/in.h>
+#include <regex>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+
+/*!
+ * \brief Minimal HTTP server on localhost, which serves one file and supports range requests.
+ */
+class TestServer
+{
+public:
+  TestServer(const std::string& content, bool supports_ranges) :
+    content_(content), supports_ranges_(supports_ranges)
+  {
+    socket_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t address_size = sizeof(address);
+    REQUIRE(bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    REQUIRE(listen(socket_, 16) == 0);
+    REQUIRE(getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &address_size) == 0);
+    port_ = ntohs(address.sin_port);
+    server_thread_ = std::jthread(
+      [this]()
+      {
+        int connection;
+        while((connection = accept(socket_, nullptr, nullptr)) >= 0)
+        {
+          std::lock_guard lock(mutex_);
+          connection_threads_.emplace_back([this, connection]() { handle(connection); });
+        }
+      });
+  }
+
+  ~TestServer()
+  {
+    shutdown(socket_, SHUT_RDWR);
+    close(socket_);
+    server_thread_.join();
+    std::lock_guard lock(mutex_);
+    connection_threads_.clear();
+  }
+
+  std::string url(const std::string& query = "") const
+  {
+    return std::format("http://127.0.0.1:{}/mod.7z{}", port_, query);
+  }
+
+  /*! \brief Range requests starting at or after this offset fail. */
+  std::atomic<uint64_t> fail_from = std::numeric_limits<uint64_t>::max();
+  /*! \brief Number of range requests served. */
+  std::atomic<int> num_range_requests = 0;
+  /*! \brief Version of the served file, sent as ETag. */
+  std::atomic<int> version = 1;
+
+private:
+  std::string content_;
+  bool supports_ranges_;
+  int socket_;
+  int port_;
+  std::jthread server_thread_;
+  std::vector<std::jthread> connection_threads_;
+  std::mutex mutex_;
+
+  void handle(int connection)
+  {
+    std::string request;
+    char buffer[4096];
+    while(!request.contains("\r\n\r\n"))
+    {
+      const ssize_t size = read(connection, buffer, sizeof(buffer));
+      if(size <= 0)
+        break;
+      request.append(buffer, size);
+    }
+    const bool is_head = request.starts_with("HEAD");
+    std::string response;
+    std::smatch match;
+    if(supports_ranges_ && std::regex_search(request, match, std::regex(R"(Range: bytes=(\d+)-(\d+))")))
+    {
+      num_range_requests++;
+      const uint64_t begin = std::stoull(match[1]);
+      const uint64_t end = std::stoull(match[2]);
+      if(begin >= fail_from)
+        response = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+      else
+        response = std::format("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes {}-{}/{}\r\n"
+                               "Content-Length: {}\r\nConnection: close\r\n\r\n{}",
+                               begin,
+                               end,
+                               content_.size(),
+                               end - begin + 1,
+                               content_.substr(begin, end - begin + 1));
+    }
+    else
+      response = std::format("HTTP/1.1 200 OK\r\nContent-Length: {}\r\n{}ETag: \"{}\"\r\n"
+                             "Connection: close\r\n\r\n{}",
+                             content_.size(),
+                             supports_ranges_ ? "Accept-Ranges: bytes\r\n" : "",
+                             version.load(),
+                             is_head ? "" : content_);
+    for(size_t written = 0; written < response.size();)
+    {
+      const ssize_t size = write(connection, response.data() + written, response.size() - written);
+      if(size <= 0)
+        break;
+      written += size;
+    }
+    close(connection);
+  }
+};
+
+std::string readFile(const sfs::path& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::string createContent(int size)
+{
+  std::string content(size, '\0');
+  for(int i = 0; i < size; i++)
+    content[i] = static_cast<char>((i * 31 + i / 7) % 251);
+  return content;
+}
+
+TEST_CASE("Files are downloaded in segments", "[download]")
+{
+  resetStagingDir();
+  const std::string content = createContent(100000);
+  const sfs::path file_path = DATA_DIR / "staging" / "mod.7z";
+
+  TestServer server(content, true);
+  SegmentedDownload download(server.url(), file_path, 4, 4096);
+  uint64_t last_progress = 0;
+  // callbacks run on worker threads, so values are only checked after the download
+  std::vector<uint64_t> available_bytes;
+  download.download([&last_progress](uint64_t now, uint64_t total) { last_progress = now; },
+                    [&available_bytes](uint64_t available)
+                    { available_bytes.push_back(available); });
+  REQUIRE(download.size() == content.size());
+  REQUIRE(last_progress == content.size());
+  REQUIRE_FALSE(available_bytes.empty());
+  REQUIRE(std::ranges::adjacent_find(available_bytes, std::greater_equal<uint64_t>()) ==
+          available_bytes.end());
+  REQUIRE(available_bytes.back() == content.size());
+  REQUIRE(server.num_range_requests == 25);
+  REQUIRE(readFile(file_path) == content);
+  REQUIRE_FALSE(sfs::exists(DATA_DIR / "staging" / ("mod.7z" + SegmentedDownload::PART_EXTENSION)));
+  REQUIRE_FALSE(sfs::exists(DATA_DIR / "staging" / ("mod.7z" + SegmentedDownload::STATE_EXTENSION)));
+
+  TestServer single_server(content, false);
+  sfs::remove(file_path);
+  SegmentedDownload single_download(single_server.url(), file_path);
+  single_download.download();
+  REQUIRE(readFile(file_path) == content);
+}
+
+TEST_CASE("Interrupted downloads are resumed", "[download]")
+{
+  resetStagingDir();
+  const std::string content = createContent(100000);
+  const sfs::path file_path = DATA_DIR / "staging" / "mod.7z";
+
+  TestServer server(content, true);
+  server.fail_from = 50000;
+  SegmentedDownload download(server.url(), file_path, 1, 4096);
+  REQUIRE_THROWS(download.download());
+  REQUIRE_FALSE(sfs::exists(file_path));
+  REQUIRE(sfs::exists(DATA_DIR / "staging" / ("mod.7z" + SegmentedDownload::STATE_EXTENSION)));
+
+  // signed download links change with every request
+  server.fail_from = std::numeric_limits<uint64_t>::max();
+  server.num_range_requests = 0;
+  SegmentedDownload resumed_download(server.url("?expires=2"), file_path, 4, 4096);
+  resumed_download.download();
+  REQUIRE(server.num_range_requests == 12);
+  REQUIRE(readFile(file_path) == content);
+
+  sfs::remove(file_path);
+  server.fail_from = 50000;
+  REQUIRE_THROWS(SegmentedDownload(server.url(), file_path, 1, 4096).download());
+  server.fail_from = std::numeric_limits<uint64_t>::max();
+  server.num_range_requests = 0;
+  server.version = 2;
+  SegmentedDownload changed_download(server.url(), file_path, 4, 4096);
+  changed_download.download();
+  REQUIRE(server.num_range_requests == 25);
+  REQUIRE(readFile(file_path) == content);
+}
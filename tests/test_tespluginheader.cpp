@@ -0,0 +1,62 @@
+#include "../src/core/parseerror.h"
+#include "../src/core/tespluginheader.h"
+#include "test_utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_vector.hpp>
+
+
+TEST_CASE("Plugin headers are read", "[plugin_header]")
+{
+  resetStagingDir();
+  const sfs::path dir = DATA_DIR / "staging" / "plugins";
+  std::string data;
+  appendSubrecord(data, "HEDR", std::string(12, '\0'));
+  appendSubrecord(data, "CNAM", std::string("author\0", 7));
+  appendSubrecord(data, "SNAM", std::string("a description\0", 14));
+  appendSubrecord(data, "MAST", std::string("Skyrim.esm\0", 11));
+  appendSubrecord(data, "DATA", std::string(8, '\0'));
+  appendSubrecord(data, "MAST", std::string("Update.esm\0", 11));
+  appendSubrecord(data, "DATA", std::string(8, '\0'));
+  writePlugin(dir / "a.esp", "TES4", 0x201, data, 24);
+
+  TesPluginHeader header(dir / "a.esp", TesPluginHeader::Format::tes5);
+  REQUIRE(header.getFlags() == 0x201);
+  REQUIRE(header.hasFlag(TesPluginHeader::MASTER_FLAG));
+  REQUIRE(header.getDescription() == "a description");
+  REQUIRE_THAT(header.getMasters(),
+               Catch::Matchers::Equals(std::vector<std::string>{ "Skyrim.esm", "Update.esm" }));
+
+  writePlugin(dir / "b.esp", "TES4", 0, data, 20);
+  TesPluginHeader oblivion_header(dir / "b.esp", TesPluginHeader::Format::tes4);
+  REQUIRE_FALSE(oblivion_header.hasFlag(TesPluginHeader::MASTER_FLAG));
+  REQUIRE(oblivion_header.getMasters().size() == 2);
+
+  REQUIRE_THROWS_AS(TesPluginHeader(dir / "a.esp", TesPluginHeader::Format::tes3), ParseError);
+  REQUIRE_THROWS_AS(TesPluginHeader(dir / "c.esp", TesPluginHeader::Format::tes5), ParseError);
+}
+
+TEST_CASE("Morrowind plugin headers are read", "[plugin_header]")
+{
+  resetStagingDir();
+  const sfs::path dir = DATA_DIR / "staging" / "plugins";
+  std::string hedr(300, '\0');
+  hedr[4] = 1;
+  hedr.replace(40, 11, "description");
+  std::string data;
+  for(const auto& [type, content] : { std::pair<std::string, std::string>{ "HEDR", hedr },
+                                      { "MAST", std::string("Morrowind.esm\0", 14) },
+                                      { "DATA", std::string(8, '\0') } })
+  {
+    const uint32_t size = content.size();
+    data += type;
+    data.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    data += content;
+  }
+  writePlugin(dir / "a.esm", "TES3", 0, data, 16);
+
+  TesPluginHeader header(dir / "a.esm", TesPluginHeader::Format::tes3);
+  REQUIRE(header.hasFlag(TesPluginHeader::MASTER_FLAG));
+  REQUIRE(header.getDescription() == "description");
+  REQUIRE_THAT(header.getMasters(),
+               Catch::Matchers::Equals(std::vector<std::string>{ "Morrowind.esm" }));
+}
@@ -0,0 +1,32 @@
+#include "../src/core/threadpool.h"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+
+
+TEST_CASE("Tasks are executed", "[threadpool]")
+{
+  std::atomic<int> sum = 0;
+  std::vector<std::future<int>> results;
+  {
+    ThreadPool pool(4);
+    REQUIRE(pool.numThreads() == 4);
+    for(int i = 0; i < 100; i++)
+      results.push_back(pool.submit(
+        [&sum, i]()
+        {
+          sum += i;
+          return i * 2;
+        }));
+    for(int i = 0; i < 100; i++)
+      REQUIRE(results[i].get() == i * 2);
+  }
+  REQUIRE(sum == 4950);
+}
+
+TEST_CASE("Task exceptions are forwarded", "[threadpool]")
+{
+  ThreadPool pool(2);
+  auto result = pool.submit([]() { throw std::runtime_error("error"); });
+  REQUIRE_THROWS_AS(result.get(), std::runtime_error);
+}
@@ -64,3 +64,34 @@ void verifyFilesAreEqual(sfs::path first_file, sfs::path second_file)
   REQUIRE(content_first_file == content_second_file);
 }
 
+void appendSubrecord(std::string& data, const std::string& type, const std::string& content)
+{
+  const uint16_t size = content.size();
+  data += type;
+  data.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  data += content;
+}
+
+void writePlugin(const sfs::path& path,
+                 const std::string& type,
+                 uint32_t flags,
+                 const std::string& data,
+                 int header_size,
+                 const std::string& records)
+{
+  sfs::create_directories(path.parent_path());
+  std::ofstream file(path, std::ios::binary);
+  const uint32_t size = data.size();
+  file << type;
+  file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  if(type == "TES3")
+  {
+    const uint32_t unknown = 0;
+    file.write(reinterpret_cast<const char*>(&unknown), sizeof(unknown));
+  }
+  file.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+  file << std::string(header_size - (type == "TES3" ? 16 : 12), '\0');
+  file << data;
+  file << "GRUP" << std::string(20, '\0');
+  file << records;
+}